@@ -0,0 +1,101 @@
+///
+/// @file MeshBenchmark.cpp
+/// @brief Times each Mesh engine on the same synthetic volume
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "Decimator.h"
+#include "Mesh.h"
+#include "PackedMesh.h"
+#include "Timer.h"
+#include "Volume.h"
+
+namespace
+{
+  // Best of _runs, in seconds
+  float TimeEngine(Mesh &_mesh, Mesh::Engine _engine, unsigned int _runs, IndexedMesh &_result)
+  {
+    _mesh.SetEngine(_engine);
+    float best = 0.0f;
+    for (unsigned int i = 0; i < _runs; ++i)
+    {
+      Timer timer;
+      _result = _mesh.MarchCubesIndexed();
+      float seconds = timer.DeltaTime();
+      best = i == 0 ? seconds : std::min(best, seconds);
+    }
+    return best;
+  }
+}
+
+// Usage: MeshBenchmark [size] [threads]
+int main(int _argc, char **_argv)
+{
+  size_t size = _argc > 1 ? std::strtoul(_argv[1], nullptr, 10) : 256;
+  unsigned int threads = _argc > 2 ? static_cast<unsigned int>(std::strtoul(_argv[2], nullptr, 10)) : 0;
+  const unsigned int runs = 5;
+
+  // Gyroid, a surface with plenty of area and every kind of cube
+  std::cout << "Building " << size << "^3 volume...\n";
+  Volume<uint8_t> volume(size, size, size);
+  for (size_t z = 0; z < size; ++z)
+  {
+    for (size_t y = 0; y < size; ++y)
+    {
+      for (size_t x = 0; x < size; ++x)
+      {
+        float scale = 12.0f / size;
+        float value = std::sin(x * scale) * std::cos(y * scale) + std::sin(y * scale) * std::cos(z * scale)
+                    + std::sin(z * scale) * std::cos(x * scale);
+        volume.At(x, y, z) = static_cast<uint8_t>(std::clamp((value + 1.5f) * 85.0f, 0.0f, 255.0f));
+      }
+    }
+  }
+
+  Mesh mesh;
+  mesh.SetThreadCount(threads);
+  mesh.SetSurfaceLevel(128);
+  mesh.Initialise(volume.View(), static_cast<unsigned int>(size), static_cast<unsigned int>(size), 1);
+
+  IndexedMesh classic;
+  IndexedMesh flying;
+  IndexedMesh net;
+  float classicTime = TimeEngine(mesh, Mesh::Engine::MarchingCubes, runs, classic);
+  float flyingTime = TimeEngine(mesh, Mesh::Engine::FlyingEdges, runs, flying);
+  float netTime = TimeEngine(mesh, Mesh::Engine::SurfaceNets, runs, net);
+
+  std::cout << "\nThreads: " << mesh.GetThreadCount() << ", best of " << runs << " runs\n"
+            << "Marching Cubes: " << classicTime * 1000.0f << " ms, " << classic.vertices.size() << " vertices, "
+            << classic.indices.size() / 3 << " triangles\n"
+            << "Flying Edges:   " << flyingTime * 1000.0f << " ms, " << flying.vertices.size() << " vertices, "
+            << flying.indices.size() / 3 << " triangles (" << classicTime / flyingTime << "x)\n"
+            << "Surface Nets:   " << netTime * 1000.0f << " ms, " << net.vertices.size() << " vertices, "
+            << net.indices.size() / 3 << " triangles (" << classicTime / netTime << "x)\n";
+
+  // Decimation runs once, it is far slower than extraction
+  Decimator decimator;
+  Timer timer;
+  IndexedMesh coarse = decimator.Simplify(classic, classic.indices.size() / 3 / 20);
+  float decimateTime = timer.DeltaTime();
+  std::cout << "Decimation:     " << decimateTime * 1000.0f << " ms to " << coarse.vertices.size() << " vertices, "
+            << coarse.indices.size() / 3 << " triangles (5%)\n";
+
+  // Vertex memory of the marching cubes mesh as floats and packed
+  std::vector<ngl::Vec3> normals = VertexNormals(classic, classic.indices.size());
+  ngl::Vec3 minimum;
+  ngl::Vec3 maximum;
+  mesh.GetBounds(minimum, maximum);
+  timer.DeltaTime();
+  PackedMesh packed = PackMesh(classic.vertices, normals, classic.indices, minimum, maximum);
+  float packTime = timer.DeltaTime();
+  size_t floatBytes = classic.vertices.size() * 2 * sizeof(ngl::Vec3);
+  size_t packedBytes = packed.vertices.size() * sizeof(PackedVertex);
+  std::cout << "Packing:        " << packTime * 1000.0f << " ms, " << floatBytes / 1024 << " KB of vertices to "
+            << packedBytes / 1024 << " KB (" << static_cast<float>(floatBytes) / packedBytes << "x smaller)\n";
+  // Flying Edges must match marching cubes exactly
+  return classic.indices.size() == flying.indices.size() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
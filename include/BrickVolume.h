@@ -0,0 +1,234 @@
+/// \file BrickVolume.h
+/// \brief Sparse bricked voxel storage with per-brick value ranges for empty-space skipping
+/// \author Josh Bailey
+/// \version 1.0
+/// \date 17/10/26 Initial version
+/// Revision History:
+///
+/// \todo
+
+#ifndef BRICK_VOLUME_H_
+#define BRICK_VOLUME_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "ThreadPool.h"
+#include "Volume.h"
+
+// Voxels along each side of a brick, a power of two so brick indices are shifts and masks
+constexpr size_t c_brickSize = 8;
+
+// Lowest and highest voxel of each c_brickSize^3 brick of _view, bricks are ordered x fastest
+// Bricks of the last row, column or layer are cut short by the edge of the view
+template <typename T>
+std::pair<T, T> BrickRange(const VolumeView<T> &_view, size_t _bx, size_t _by, size_t _bz)
+{
+  size_t x1 = std::min((_bx + 1) * c_brickSize, _view.GetWidth());
+  size_t y1 = std::min((_by + 1) * c_brickSize, _view.GetHeight());
+  size_t z1 = std::min((_bz + 1) * c_brickSize, _view.GetDepth());
+  T low = _view.At(_bx * c_brickSize, _by * c_brickSize, _bz * c_brickSize);
+  T high = low;
+  for (size_t z = _bz * c_brickSize; z < z1; ++z)
+  {
+    for (size_t y = _by * c_brickSize; y < y1; ++y)
+    {
+      for (size_t x = _bx * c_brickSize; x < x1; ++x)
+      {
+        T value = _view.At(x, y, z);
+        low = std::min(low, value);
+        high = std::max(high, value);
+      }
+    }
+  }
+  return std::make_pair(low, high);
+}
+
+// Range of every voxel the cubes starting in each brick reach
+// A brick's cubes also reach the first voxel of the next brick along each axis, so the
+// ranges of the (up to) 8 bricks sharing its far corner are merged
+template <typename T>
+std::vector<std::pair<T, T>> CubeRanges(const std::vector<std::pair<T, T>> &_ranges, size_t _bricksX, size_t _bricksY, size_t _bricksZ)
+{
+  std::vector<std::pair<T, T>> merged(_ranges.size());
+  for (size_t bz = 0; bz < _bricksZ; ++bz)
+  {
+    for (size_t by = 0; by < _bricksY; ++by)
+    {
+      for (size_t bx = 0; bx < _bricksX; ++bx)
+      {
+        std::pair<T, T> range = _ranges[(bz * _bricksY + by) * _bricksX + bx];
+        for (size_t nz = bz; nz <= std::min(bz + 1, _bricksZ - 1); ++nz)
+        {
+          for (size_t ny = by; ny <= std::min(by + 1, _bricksY - 1); ++ny)
+          {
+            for (size_t nx = bx; nx <= std::min(bx + 1, _bricksX - 1); ++nx)
+            {
+              const std::pair<T, T> &neighbour = _ranges[(nz * _bricksY + ny) * _bricksX + nx];
+              range.first = std::min(range.first, neighbour.first);
+              range.second = std::max(range.second, neighbour.second);
+            }
+          }
+        }
+        merged[(bz * _bricksY + by) * _bricksX + bx] = range;
+      }
+    }
+  }
+  return merged;
+}
+
+// Whether any cube starting in each brick can cross _level
+template <typename T>
+std::vector<char> ActiveBricks(const std::vector<std::pair<T, T>> &_ranges, size_t _bricksX, size_t _bricksY, size_t _bricksZ, int _level)
+{
+  std::vector<std::pair<T, T>> merged = CubeRanges(_ranges, _bricksX, _bricksY, _bricksZ);
+  std::vector<char> active(merged.size(), 0);
+  for (size_t i = 0; i < merged.size(); ++i)
+  {
+    // Same test as a single cube, some corner below the level and some at or above it
+    active[i] = merged[i].first < _level && merged[i].second >= _level;
+  }
+  return active;
+}
+
+// Voxels stored as c_brickSize^3 bricks, x fastest within a brick and between bricks
+// A brick holding a single value throughout keeps only that value
+template <typename T>
+class BrickVolume
+{
+  public:
+    using VoxelType = T;
+
+    BrickVolume() = default;
+
+    // Copy _view into bricks in parallel, allocating only bricks that hold more than one value
+    void Build(const VolumeView<T> &_view, ThreadPool &_pool)
+    {
+      Reset(_view.GetWidth(), _view.GetHeight(), _view.GetDepth());
+      for (size_t bz = 0; bz < m_bricksZ; ++bz)
+      {
+        VoxelBox slab;
+        slab.z = bz * c_brickSize;
+        slab.width = m_width;
+        slab.height = m_height;
+        slab.depth = std::min(c_brickSize, m_depth - slab.z);
+        AddBricks(_view.SubView(slab), bz, _pool);
+      }
+    }
+    // Start a _width x _height x _depth volume with no bricks, to be filled by AddBricks()
+    void Reset(size_t _width, size_t _height, size_t _depth)
+    {
+      Clear();
+      m_width = _width;
+      m_height = _height;
+      m_depth = _depth;
+      m_bricksX = (m_width + c_brickSize - 1) / c_brickSize;
+      m_bricksY = (m_height + c_brickSize - 1) / c_brickSize;
+      m_bricksZ = (m_depth + c_brickSize - 1) / c_brickSize;
+      m_bricks.resize(m_bricksX * m_bricksY * m_bricksZ);
+      m_ranges.resize(m_bricks.size());
+    }
+    // Copy layer _bz of bricks from _slab, which holds just their c_brickSize layers (fewer for the last)
+    // so a volume can be bricked as it is loaded, without ever being whole
+    void AddBricks(const VolumeView<T> &_slab, size_t _bz, ThreadPool &_pool)
+    {
+      // Every brick is independent, so each one is a task of its own
+      _pool.ParallelFor(m_bricksX * m_bricksY, [&](size_t _brick, unsigned int)
+      {
+        size_t bx = _brick % m_bricksX;
+        size_t by = _brick / m_bricksX;
+        size_t brick = BrickIndex(bx, by, _bz);
+        m_ranges[brick] = BrickRange(_slab, bx, by, 0);
+        if (m_ranges[brick].first == m_ranges[brick].second)
+        {
+          return;
+        }
+
+        std::vector<T> &voxels = m_bricks[brick];
+        voxels.assign(c_brickSize * c_brickSize * c_brickSize, m_ranges[brick].first);
+        for (size_t z = 0; z < _slab.GetDepth(); ++z)
+        {
+          for (size_t y = by * c_brickSize; y < std::min((by + 1) * c_brickSize, m_height); ++y)
+          {
+            for (size_t x = bx * c_brickSize; x < std::min((bx + 1) * c_brickSize, m_width); ++x)
+            {
+              voxels[Local(x, y, z)] = _slab.At(x, y, z);
+            }
+          }
+        }
+      });
+    }
+    void Clear()
+    {
+      m_bricks.clear();
+      m_ranges.clear();
+      m_width = m_height = m_depth = 0;
+      m_bricksX = m_bricksY = m_bricksZ = 0;
+    }
+
+    T At(size_t _x, size_t _y, size_t _z) const
+    {
+      size_t brick = BrickIndex(_x / c_brickSize, _y / c_brickSize, _z / c_brickSize);
+      return m_bricks[brick].empty() ? m_ranges[brick].first : m_bricks[brick][Local(_x, _y, _z)];
+    }
+    // Write layer _z densely into _out, x fastest then y
+    void CopyLayer(size_t _z, T *_out) const
+    {
+      size_t bz = _z / c_brickSize;
+      for (size_t y = 0; y < m_height; ++y)
+      {
+        for (size_t bx = 0; bx < m_bricksX; ++bx)
+        {
+          size_t brick = BrickIndex(bx, y / c_brickSize, bz);
+          size_t x0 = bx * c_brickSize;
+          size_t count = std::min(c_brickSize, m_width - x0);
+          if (m_bricks[brick].empty())
+          {
+            std::fill_n(_out + y * m_width + x0, count, m_ranges[brick].first);
+          }
+          else
+          {
+            std::copy_n(&m_bricks[brick][Local(x0, y, _z)], count, _out + y * m_width + x0);
+          }
+        }
+      }
+    }
+
+    // Lowest and highest voxel of each brick, x fastest
+    const std::vector<std::pair<T, T>> &GetRanges() const { return m_ranges; }
+
+    // Getters
+    bool Empty() const { return m_bricks.empty(); }
+    size_t GetWidth() const { return m_width; }
+    size_t GetHeight() const { return m_height; }
+    size_t GetDepth() const { return m_depth; }
+    size_t GetBricksX() const { return m_bricksX; }
+    size_t GetBricksY() const { return m_bricksY; }
+    size_t GetBricksZ() const { return m_bricksZ; }
+    size_t GetBrickCount() const { return m_bricks.size(); }
+    size_t GetAllocatedBricks() const
+    {
+      return static_cast<size_t>(std::count_if(m_bricks.begin(), m_bricks.end(), [](const std::vector<T> &_brick) { return !_brick.empty(); }));
+    }
+
+  private:
+    size_t BrickIndex(size_t _bx, size_t _by, size_t _bz) const { return (_bz * m_bricksY + _by) * m_bricksX + _bx; }
+    static size_t Local(size_t _x, size_t _y, size_t _z)
+    {
+      return ((_z % c_brickSize) * c_brickSize + (_y % c_brickSize)) * c_brickSize + (_x % c_brickSize);
+    }
+
+    // Voxels of each brick, empty when the brick is uniform
+    std::vector<std::vector<T>> m_bricks;
+    std::vector<std::pair<T, T>> m_ranges;
+    size_t m_width = 0;
+    size_t m_height = 0;
+    size_t m_depth = 0;
+    size_t m_bricksX = 0;
+    size_t m_bricksY = 0;
+    size_t m_bricksZ = 0;
+};
+
+#endif  // _BRICK_VOLUME_H_
@@ -34,6 +34,8 @@ class Camera {
     // Projection Matrix
     void SetProjectionMatrix(float _fov, int _width, int _height, float _nearPlane, float _farPlane);
     ngl::Mat4 GetProjectionMatrix() { return m_projectionMatrix; }
+    // Vertical field of view in degrees
+    float GetFov() { return m_fov; }
     void UpdateProjectionMatrix();
 
     // Movement
@@ -0,0 +1,43 @@
+/// \file CubeClassifier.h
+/// \brief Vectorised cube index classification of 8-bit voxel rows
+/// \author Josh Bailey
+/// \version 1.0
+/// \date 17/10/26 Initial version
+/// Revision History:
+///
+/// \todo
+
+#ifndef CUBE_CLASSIFIER_H_
+#define CUBE_CLASSIFIER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+class CubeClassifier
+{
+  public:
+    // Instruction sets a row can be classified with, all giving identical results
+    enum class Path
+    {
+      Scalar,
+      SSE2,
+      AVX2
+    };
+
+    // Fastest path the CPU supports, detected once
+    static Path Best();
+    static bool Supported(Path _path);
+
+    // Cube index (bit n set when corner n is at or above _level) of every cube between two rows of two layers
+    // _rows are layer A row y, layer A row y + 1, layer B row y, layer B row y + 1, each _width voxels
+    // Only cubes the surface passes through are kept, their x in _x and index in _index, each _width - 1 long
+    // Returns the number of cubes kept
+    static size_t ClassifyRow(const uint8_t *const _rows[4], size_t _width, int _level, uint32_t *_x, uint8_t *_index, Path _path = Best());
+
+  private:
+    static size_t ClassifyScalar(const uint8_t *const _rows[4], size_t _first, size_t _width, uint8_t _level, uint32_t *_x, uint8_t *_index);
+    static size_t ClassifySSE2(const uint8_t *const _rows[4], size_t &_first, size_t _width, uint8_t _level, uint32_t *_x, uint8_t *_index);
+    static size_t ClassifyAVX2(const uint8_t *const _rows[4], size_t &_first, size_t _width, uint8_t _level, uint32_t *_x, uint8_t *_index);
+};
+
+#endif  // _CUBE_CLASSIFIER_H_
@@ -0,0 +1,125 @@
+/// \file Decimator.h
+/// \brief Quadric error edge collapse simplification of indexed meshes
+/// \author Josh Bailey
+/// \version 1.0
+/// \date 17/10/26 Initial version
+/// Revision History:
+///
+/// \todo
+
+#ifndef DECIMATOR_H_
+#define DECIMATOR_H_
+
+#include <ngl/Vec3.h>
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "Mesh.h"
+#include "ThreadPool.h"
+
+// Symmetric 4x4 matrix giving the summed, weighted squared distance of a point to a set of planes
+struct Quadric
+{
+  float xx = 0.0f, xy = 0.0f, xz = 0.0f, xw = 0.0f;
+  float yy = 0.0f, yz = 0.0f, yw = 0.0f;
+  float zz = 0.0f, zw = 0.0f;
+  float ww = 0.0f;
+
+  // Plane through _point with unit normal _normal
+  static Quadric Plane(const ngl::Vec3 &_normal, const ngl::Vec3 &_point, float _weight);
+  Quadric &operator+=(const Quadric &_other);
+  Quadric operator+(const Quadric &_other) const;
+  float Error(const ngl::Vec3 &_point) const;
+  // Point of least error, false when the planes do not pin one down (flat or cylindrical patches)
+  bool Minimum(ngl::Vec3 &_point) const;
+};
+
+// Garland and Heckbert's quadric error edge collapses (1997)
+// Triangles are kept as a compact half-edge structure: half-edge 3t + i leaves corner i of triangle t,
+// so only each half-edge's origin and opposite half-edge are stored
+// Triangles are sorted into spatial blocks which are simplified in parallel, with the vertices blocks
+// share held still, before a last pass over the whole mesh takes in the seams
+class Decimator
+{
+  public:
+    Decimator() = default;
+
+    // Collapse the cheapest edges of _mesh until at most _targetTriangles remain
+    // _maxError stops sooner, as the furthest a collapse may move the surface, in mesh units
+    // Edges on the mesh boundary are kept in place and non-manifold parts are left untouched
+    // Normals, when the mesh has them, stay with the vertices that are kept
+    IndexedMesh Simplify(const IndexedMesh &_mesh, size_t _targetTriangles, float _maxError = std::numeric_limits<float>::max());
+
+    // Setters and getters
+    void SetThreadCount(unsigned int _threads) { m_pool.SetThreadCount(_threads); }
+    unsigned int GetThreadCount() { return m_pool.GetThreadCount(); }
+    size_t GetCollapseCount() const { return m_collapses; }
+
+  private:
+    void Build(const IndexedMesh &_mesh);
+    // Surviving vertices keep the normals in _normals, when there is one per vertex
+    IndexedMesh Compact(const std::vector<ngl::Vec3> &_normals) const;
+    void Clear();
+
+    // Collapse edges of triangles [_first, _last) until _target of the _triangles still there remain,
+    // or none can go within _maxCost. Vertices flagged with any of _held stay put, returns the collapses made
+    size_t SimplifyRange(uint32_t _first, uint32_t _last, size_t &_triangles, size_t _target, float _maxCost, uint8_t _held);
+    // Error of collapsing _edge into _position, the best place for the merged vertex
+    float CollapseCost(uint32_t _edge, ngl::Vec3 &_position) const;
+    // Whether collapsing _edge keeps the surface a manifold without folding any triangle over
+    // _rings is scratch space for the neighbours of both ends
+    bool CanCollapse(uint32_t _edge, const ngl::Vec3 &_position, uint8_t _held, std::vector<uint32_t> &_rings) const;
+    // Merge the end of _edge into its start, then move the start to _position
+    // Returns a half-edge of each edge joined across a removed triangle, c_none where there is none
+    std::array<uint32_t, 2> CollapseEdge(uint32_t _edge, const ngl::Vec3 &_position);
+    // Join the triangle's two other edges across it, returning a half-edge of the joined edge
+    uint32_t RemoveTriangle(uint32_t _edge);
+
+    // Call _visit with each half-edge leaving _vertex, returns false if the vertex is on a boundary
+    template <typename Visit>
+    bool VisitOutgoing(uint32_t _vertex, Visit _visit) const;
+
+    uint32_t Origin(uint32_t _edge) const { return m_edges[_edge].origin; }
+    uint32_t Target(uint32_t _edge) const { return m_edges[Next(_edge)].origin; }
+    static uint32_t Next(uint32_t _edge) { return _edge % 3 == 2 ? _edge - 2 : _edge + 1; }
+    static uint32_t Prev(uint32_t _edge) { return _edge % 3 == 0 ? _edge + 2 : _edge - 1; }
+    bool Removed(uint32_t _edge) const { return m_edges[_edge].origin == c_none; }
+
+    static constexpr uint32_t c_none = std::numeric_limits<uint32_t>::max();
+    // Vertex flags
+    static constexpr uint8_t c_locked = 1;
+    static constexpr uint8_t c_removedVertex = 2;
+    // Used by triangles of more than one block
+    static constexpr uint8_t c_seam = 4;
+
+    // Each collapse reads a half-edge's origin with its opposite and a vertex's position with its quadric,
+    // so each pair shares a cache line
+    struct HalfEdge
+    {
+      uint32_t origin;
+      uint32_t twin;
+    };
+    struct Vertex
+    {
+      // Scaled into the unit cube, so float quadrics keep their precision
+      ngl::Vec3 position;
+      Quadric quadric;
+    };
+
+    std::vector<HalfEdge> m_edges;
+    std::vector<Vertex> m_vertices;
+    std::vector<uint32_t> m_outgoing;
+    std::vector<uint8_t> m_flags;
+    // First triangle of each block, then the triangle count
+    std::vector<uint32_t> m_blocks;
+
+    ngl::Vec3 m_minimum;
+    float m_scale = 1.0f;
+    size_t m_collapses = 0;
+    ThreadPool m_pool;
+};
+
+#endif  // _DECIMATOR_H_
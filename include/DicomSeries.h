@@ -0,0 +1,77 @@
+/// \file DicomSeries.h
+/// \brief Reading uncompressed DICOM series into a 16-bit volume
+/// \author Josh Bailey
+/// \version 1.0
+/// \date 17/10/26 Initial version
+/// Revision History:
+///
+/// \todo
+
+#ifndef DICOM_SERIES_H_
+#define DICOM_SERIES_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ThreadPool.h"
+#include "Volume.h"
+
+class DicomSeries
+{
+  public:
+    DicomSeries() = default;
+
+    // Whether _path starts with a DICOM preamble or has a .dcm extension
+    static bool IsDicomFile(const std::string &_path);
+
+    // Parse every file's tags in parallel and order the slices along the patient axis
+    bool ReadHeaders(const std::vector<std::string> &_files, ThreadPool &_pool);
+    // Load and rescale every _sliceStep'th slice's pixels into the volume
+    bool LoadVoxels(ThreadPool &_pool, unsigned int _sliceStep = 1);
+    void Clear();
+
+    // Voxels in rescaled units (Hounsfield units for CT)
+    const Volume<int16_t> &GetVolume() const { return m_volume; }
+
+    // Getters
+    bool IsRead() const { return !m_slices.empty(); }
+    size_t GetWidth() const { return m_width; }
+    size_t GetHeight() const { return m_height; }
+    size_t GetDepth() const { return m_slices.size(); }
+    // Path of each slice, in patient order
+    std::vector<std::string> GetSlicePaths() const;
+    const std::string &GetError() const { return m_error; }
+
+  private:
+    struct Slice
+    {
+      std::string path;
+      unsigned int rows = 0;
+      unsigned int columns = 0;
+      unsigned int bitsAllocated = 0;
+      unsigned int samplesPerPixel = 1;
+      bool isSigned = false;
+      double slope = 1.0;
+      double intercept = 0.0;
+      double position[3] = {0.0, 0.0, 0.0};
+      double orientation[6] = {1.0, 0.0, 0.0, 0.0, 1.0, 0.0};
+      bool hasPosition = false;
+      int instanceNumber = 0;
+      size_t pixelOffset = 0;
+      size_t pixelLength = 0;
+      // Empty when the file was parsed successfully
+      std::string error;
+    };
+
+    static Slice ParseHeader(const std::string &_path);
+    bool LoadSlice(const Slice &_slice, int16_t *_voxels) const;
+
+    std::vector<Slice> m_slices;
+    size_t m_width = 0;
+    size_t m_height = 0;
+    Volume<int16_t> m_volume;
+    std::string m_error;
+};
+
+#endif  // _DICOM_SERIES_H_
@@ -10,42 +10,167 @@
 #ifndef IMAGE_STACK_H_
 #define IMAGE_STACK_H_
 
+#include <QImage>
+
+#include <cstdint>
+#include <filesystem>
+#include <functional>
 #include <sstream>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "BrickVolume.h"
+#include "DicomSeries.h"
+#include "OiioStack.h"
+#include "RawVolume.h"
+#include "SliceReader.h"
+#include "ThreadPool.h"
+#include "Volume.h"
+#include "VolumeCache.h"
+#include "VolumePyramid.h"
+
 class ImageStack
 {
   public:
     ImageStack() = default;
 
     // Read and write image paths from a directory to m_images
+    // A .nrrd, .nhdr, .mhd or .mha path is memory mapped as a raw volume instead
+    // A directory of DICOM files is read as a 16-bit series
+    // TIFF or EXR images (or a single multi-page TIFF) are read through OpenImageIO, keeping 16-bit data
     void ReadImages(const std::string _imageDirectory);
     // Check all images have the same dimensions
     void CheckDimensions();
     // Sample each images colour data to store in m_sampledPoints
     void SampleImages();
+    // Decode and sample checked images in order, handing each layer to _consumer as it is ready
+    // Decoding runs ahead on the workers while _consumer runs on the calling thread
+    // Only two layers per worker are held at once, m_sampledPoints is left untouched
+    bool StreamImages(const std::function<void(const VolumeView<uint8_t> &)> &_consumer);
+    // Whether StreamImages() can be used, raw volumes and DICOM series are already resident or mapped
+    bool CanStream() { return m_checkedDimensions && !m_rawVolume.IsOpen() && !m_dicomSeries && !m_oiioSeries; }
 
     // Setters and getters
     void SetSampleResolution(int _resolution);
+    void SetThreadCount(unsigned int _threads);
+    // Most memory OpenImageIO may hold in decoded tiles, in megabytes
+    void SetImageCacheMemory(float _megabytes) { m_oiio.SetMemoryCap(_megabytes); }
+    // Where sampled images are cached between sessions, an empty path (the default) disables caching
+    void SetCacheDirectory(const std::string &_directory) { m_cache.SetDirectory(_directory); }
+    unsigned int GetThreadCount() { return m_pool.GetThreadCount(); }
     unsigned int GetSampleResolution() { return m_sampleResolution; }
     unsigned int GetImageWidth() { return m_imageWidth; }
     unsigned int GetImageHeight() { return m_imageHeight; }
+    unsigned int GetImageDepth() { return m_imageDepth; }
+    // Number of points sampled along each axis at the current resolution
+    unsigned int GetSampledWidth() { return (m_imageWidth + m_sampleResolution - 1) / m_sampleResolution; }
+    unsigned int GetSampledHeight() { return (m_imageHeight + m_sampleResolution - 1) / m_sampleResolution; }
+    unsigned int GetSampledDepth() { return (m_imageDepth + m_sampleResolution - 1) / m_sampleResolution; }
     bool CheckSampledImages() { return m_sampledImages; }
+    // Only sample pixels and slices inside _region (images are indexed by z), an empty box samples everything
+    // Takes effect the next time images are sampled
+    void SetRegionOfInterest(const VoxelBox &_region) { m_regionOfInterest = _region; }
+    // Crop sampled data to the voxels at or above _threshold, plus a one voxel border
+    void SetAutoCrop(bool _enabled, int _threshold = 0);
+    // Hold sampled images as bricks, keeping a single value for any brick without detail
+    // Takes effect the next time images are sampled, and skips the pyramid
+    void SetSparseStorage(bool _enabled) { m_sparse = _enabled; }
+    // Sampled images held as bricks, nullptr unless sparse storage was on when they were sampled
+    const BrickVolume<uint8_t> *GetBricks() const { return m_bricks.Empty() ? nullptr : &m_bricks; }
+    // Pixels and slices of the stack covered by GetVolume(), placing cropped data within the whole stack
+    VoxelBox GetVolumeBox() const;
+    // Pixels the first point of GetVolume() lies past the corner of GetVolumeBox() along each axis
+    // Non zero for pyramid levels, whose points are centred within the blocks they average
+    float GetSampleOffset() const;
+    // Sampled data to march, borrowed from this stack
+    // For images, power of two multiples of the sampled resolution (up to 8x) come from the pyramid
+    // Empty when the samples are held as bricks, see GetBricks()
+    AnyVolumeView GetVolume() const;
+    // Smallest and largest value the sampled data can hold
+    std::pair<int, int> GetValueRange() const { return VoxelRange(GetVolume()); }
 
     // Store the paths of all images
     std::vector<std::string> m_images;
-    // Store the colour value of each point, within each image
-    std::vector<std::vector<int>> m_sampledPoints;
+    // Store the colour value of each point, within each image (one layer per image)
+    // Left empty when the sampled points were mapped from the cache instead, see GetVolume()
+    Volume<uint8_t> m_sampledPoints;
 
   private:
+    // Directory the images were read from
+    std::string m_imageDirectory;
     // Image dimensions
     unsigned int m_imageWidth;
     unsigned int m_imageHeight;
+    unsigned int m_imageDepth = 0;
+
+    // Raw volume read in place of a directory of images
+    RawVolume m_rawVolume;
+    // DICOM series read in place of a directory of images
+    DicomSeries m_dicom;
+    bool m_dicomSeries = false;
+    // TIFF or EXR stack read in place of decoding images with Qt
+    OiioStack m_oiio;
+    bool m_oiioSeries = false;
 
     // The frequency of which colour values are read from each image
     unsigned int m_sampleResolution = 1;
 
+    // Header data of an image, cached until the file changes
+    struct ImageInfo
+    {
+      unsigned int width = 0;
+      unsigned int height = 0;
+      std::uintmax_t fileSize = 0;
+      std::filesystem::file_time_type modified;
+      bool readable = false;
+    };
+    std::unordered_map<std::string, ImageInfo> m_imageInfo;
+    // Read the dimensions of an image without decoding it
+    ImageInfo ReadImageInfo(const std::string &_path) const;
+
+    // Resolution m_sampledPoints (or the cache) was sampled at
+    unsigned int m_sampledResolution = 1;
+    // Box filtered levels of the sampled points, so coarser multiples need no resampling
+    VolumePyramid m_pyramid;
+    // Region of interest in pixels and slices, empty for the whole stack
+    VoxelBox m_regionOfInterest;
+    bool m_autoCrop = false;
+    int m_autoCropThreshold = 0;
+    // Pixels and slices the sampled data covers after cropping, empty for the whole stack
+    VoxelBox m_crop;
+    // Sample points of the stack at _resolution inside _pixels, all of them when _pixels is empty
+    VoxelBox SampledRegion(const VoxelBox &_pixels, unsigned int _resolution) const;
+    // Pixels and slices spanned by sample points _samples at _resolution
+    static VoxelBox PixelRegion(const VoxelBox &_samples, unsigned int _resolution);
+    // Set m_crop for data that is cropped by view rather than as it is sampled
+    void CropVolume();
+    // Sampled data before any crop
+    AnyVolumeView UncroppedVolume() const;
+
+    // Sampled points as bricks, replacing m_sampledPoints and the cache mapping when sparse
+    bool m_sparse = false;
+    BrickVolume<uint8_t> m_bricks;
+    void MakeSparse();
+
+    // Sampled points at m_sampledResolution, whether decoded or mapped from the cache
+    VolumeView<uint8_t> SampledBase() const { return m_cache.IsOpen() ? m_cache.View() : m_sampledPoints.View(); }
+
+    // Sampled images from previous sessions, keyed by directory contents and sample resolution
+    VolumeCache m_cache;
+
+    // Workers that decode and sample images in parallel
+    ThreadPool m_pool;
+    // One decode buffer per worker, reused between images
+    std::vector<QImage> m_decodeBuffers;
+    // Sample the rows and columns of _region (in sample points) of a decoded image into the layer starting at _points
+    void SampleImage(const QImage &_img, uint8_t *_points, const VoxelBox &_region);
+    // Decode and sample layers _first onwards of _region into every layer of _out, in parallel
+    // Reports the first image that could not be read and returns false
+    bool DecodeLayers(const VoxelBox &_region, size_t _first, Volume<uint8_t> &_out);
+    // As SampleImages() with sparse storage, bricking a few layers of bricks at a time as they are decoded
+    bool SampleSparse(const VoxelBox &_region);
+
     // Function checks
     bool m_directoryChecked = false;
     bool m_correctDimensions = false;
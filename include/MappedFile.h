@@ -0,0 +1,46 @@
+/// \file MappedFile.h
+/// \brief Read only memory mapping of a file
+/// \author Josh Bailey
+/// \version 1.0
+/// \date 17/10/26 Initial version
+/// Revision History:
+///
+/// \todo
+
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Pages are only read from disk the first time they are touched
+class MappedFile
+{
+  public:
+    MappedFile() = default;
+    ~MappedFile();
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    // Map the whole of _path, returns false if it cannot be opened
+    bool Open(const std::string &_path);
+    void Close();
+    // Hint that the mapping will be read front to back
+    void AdviseSequential();
+
+    // Getters
+    const uint8_t *Data() const { return m_data; }
+    size_t Size() const { return m_size; }
+    bool IsOpen() const { return m_data != nullptr; }
+
+  private:
+    const uint8_t *m_data = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    void *m_file = nullptr;
+    void *m_mapping = nullptr;
+#endif
+};
+
+#endif  // _MAPPED_FILE_H_
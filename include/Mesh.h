@@ -12,25 +12,298 @@
 
 #include <ngl/Vec3.h>
 
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <string>
+#include <utility>
 #include <vector>
 
+#include "BrickVolume.h"
 #include "Table.h"
+#include "ThreadPool.h"
+#include "Volume.h"
+
+// Vertices shared between triangles, three indices per triangle
+struct IndexedMesh
+{
+  std::vector<ngl::Vec3> vertices;
+  std::vector<uint32_t> indices;
+  // Unit normal of each vertex when marched with gradient normals, empty otherwise
+  std::vector<ngl::Vec3> normals;
+};
+
+// Unit normal of each vertex, the average of the normals of the triangles in the first _indexCount indices
+// Normals point out of the surface, as ngl::calcNormal
+std::vector<ngl::Vec3> VertexNormals(const IndexedMesh &_mesh, size_t _indexCount);
+
+// Central difference gradient of _source at point _point, one sided at the first and _last points along each axis
+template <typename Source>
+ngl::Vec3 CentralDifference(const Source &_source, const std::array<unsigned int, 3> &_point, const std::array<unsigned int, 3> &_last)
+{
+  std::array<float, 3> gradient;
+  for (unsigned int axis = 0; axis < 3; ++axis)
+  {
+    std::array<unsigned int, 3> low = _point;
+    std::array<unsigned int, 3> high = _point;
+    low[axis] = _point[axis] > 0 ? _point[axis] - 1 : 0;
+    high[axis] = std::min(_point[axis] + 1, _last[axis]);
+    gradient[axis] = (static_cast<float>(_source.At(high[0], high[1], high[2])) - static_cast<float>(_source.At(low[0], low[1], low[2])))
+                   / static_cast<float>(high[axis] - low[axis]);
+  }
+  return ngl::Vec3(gradient[0], gradient[1], gradient[2]);
+}
+
+// Normal of the surface at _level where it crosses the lattice edge from point _a to point _b, facing out,
+// against the average of the central difference gradients at both ends
+// _source is read by At(x, y, z), so a window holding just the points around the edge will do
+template <typename Source>
+ngl::Vec3 CrossingNormal(const Source &_source, const std::array<unsigned int, 3> &_a, const std::array<unsigned int, 3> &_b,
+                         const std::array<unsigned int, 3> &_last, int _level)
+{
+  // The inside holds the higher values, so the gradient points in, and the same scale on every axis
+  // in mesh space leaves its direction alone
+  ngl::Vec3 normal = (CentralDifference(_source, _a, _last) + CentralDifference(_source, _b, _last)) * -1.0f;
+  if (normal.length() > 0.0f)
+  {
+    normal.normalize();
+    return normal;
+  }
+  // Differences that cancel out, point along the edge out of the end that is inside
+  ngl::Vec3 along(static_cast<ngl::Real>(_b[0]) - _a[0], static_cast<ngl::Real>(_b[1]) - _a[1], static_cast<ngl::Real>(_b[2]) - _a[2]);
+  along.normalize();
+  return _source.At(_a[0], _a[1], _a[2]) >= _level ? along : along * -1.0f;
+}
+
+// One level of detail of a chunk, the surface followed by a skirt hung inwards from its open edges
+// so that a gap to a neighbouring chunk at another level is covered
+struct ChunkLevel
+{
+  IndexedMesh mesh;
+  std::vector<ngl::Vec3> normals;
+  // Indices of the surface, the skirt's come after them
+  size_t surfaceIndices = 0;
+  // Roughly how far the level strays from the full resolution surface, in mesh units
+  float error = 0.0f;
+};
+
+// Block of the volume marched at every level of detail, drawn at whichever level its distance needs
+struct MeshChunk
+{
+  ngl::Vec3 centre;
+  float radius = 0.0f;
+  std::vector<ChunkLevel> levels;
+};
 
 class Mesh
 {
   public:
+    // Algorithm used by MarchCubes() and MarchCubesIndexed()
+    // Surface Nets gives roughly half the vertices and triangles, but its vertices are not on the cube edges
+    enum class Engine
+    {
+      MarchingCubes,
+      // Flying Edges (Schroeder et al. 2015), see FlyingEdges.cpp
+      FlyingEdges,
+      // Naive Surface Nets, a vertex per cell the surface passes through joined by quads
+      SurfaceNets
+    };
+
     Mesh() = default;
-    void Initialise(std::vector<std::vector<int>> _pointData, unsigned int _imageWidth, unsigned int _imageHeight, unsigned int _sampleResolution);
-    // Perform Marching Cubes algorithm
+    // _pointData is borrowed, not copied, so it must outlive MarchCubes()
+    void Initialise(AnyVolumeView _pointData, unsigned int _imageWidth, unsigned int _imageHeight, unsigned int _sampleResolution);
+    // As above for sparse 8-bit data, _bricks is borrowed in the same way
+    void Initialise(const BrickVolume<uint8_t> &_bricks, unsigned int _imageWidth, unsigned int _imageHeight, unsigned int _sampleResolution);
+    // Perform Marching Cubes algorithm, the vertices are moved out rather than kept
+    // With gradient normals on, a normal per vertex follows all the vertices in the same buffer
     std::vector<ngl::Vec3> MarchCubes();
+    // As MarchCubes(), but each vertex is made once and shared by every triangle that meets it
+    IndexedMesh MarchCubesIndexed();
+    // As MarchCubesIndexed(), but the mesh is kept per brick so that after SetSurfaceLevel() only
+    // bricks holding a value between the old and new level are marched again
+    // Vertices on brick faces are welded as the bricks are joined, Initialise() discards the kept mesh
+    IndexedMesh MarchCubesIncremental();
+    // Marching cubes over chunks of c_chunkSize cubes along each side, each marched c_chunkLevels times
+    // with level n sampling every 2^n'th point, so its points are also points of every finer level
+    // Chunks the surface does not pass through are left out
+    // Chunks are kept as MarchCubesIncremental() keeps bricks, so after SetSurfaceLevel() only chunks
+    // holding a value between the old and new level are marched again
+    std::vector<MeshChunk> MarchChunks();
+
+    // Cubes along each side of a chunk, a multiple of c_brickSize and of the coarsest level's step
+    static constexpr unsigned int c_chunkSize = 32;
+    static constexpr unsigned int c_chunkLevels = 4;
+
+    // Streaming alternative to Initialise() and MarchCubes() for 8-bit data
+    // Only two layers are held at once, each slab is marched as soon as its second layer arrives
+    void BeginStream(unsigned int _pointsPerRow, unsigned int _columns, unsigned int _layers,
+                     unsigned int _imageWidth, unsigned int _imageHeight, unsigned int _sampleResolution);
+    // Copy in the next layer (z order) and march the slab it completes
+    void StreamLayer(const VolumeView<uint8_t> &_layer);
+    // Hand back the vertices of every slab streamed since BeginStream(), then their normals as MarchCubes()
+    std::vector<ngl::Vec3> EndStream();
 
     // Setters and getters
+    // Place cropped data at pixel (_x, _y, _z) of a stack _totalLayers sampled layers deep
+    // Fractions of a pixel place data whose points are centred between pixels, such as pyramid levels
+    // Must follow Initialise() or BeginStream(), which reset it to the whole stack
+    void SetOrigin(float _x, float _y, float _z, unsigned int _totalLayers);
     void SetSurfaceLevel(int _surfaceLevel);
+    // Threads slabs are marched on, 0 uses every hardware thread
+    void SetThreadCount(unsigned int _threads);
+    unsigned int GetThreadCount() { return m_pool.GetThreadCount(); }
     int GetSurfaceLevel() { return m_surfaceLevel; }
+    void SetEngine(Engine _engine) { m_engine = _engine; }
+    Engine GetEngine() { return m_engine; }
+    // Give every vertex a normal from the volume's gradient, found as the vertex is made
+    // A change discards the meshes kept by MarchCubesIncremental() and MarchChunks(), which have the other kind
+    void SetGradientNormals(bool _normals);
+    bool GetGradientNormals() { return m_gradientNormals; }
+    // Mesh space box every vertex marched from the current data lies in, chunk skirts included
+    void GetBounds(ngl::Vec3 &_minimum, ngl::Vec3 &_maximum) const;
+    // Limits of SetSurfaceLevel, follows the voxel type being marched (0 to 255 by default)
+    void SetSurfaceLevelRange(int _minimum, int _maximum);
+    int GetMinSurfaceLevel() { return m_minSurfaceLevel; }
+    int GetMaxSurfaceLevel() { return m_maxSurfaceLevel; }
 
   private:
-    std::vector<std::vector<int>> m_pointData;
-    int m_surfaceLevel;
+    // Mesh of one brick, see m_brickMeshes
+    struct BrickMesh;
+
+    // Marching Cubes over one voxel type
+    // Both march into m_vertexData when _indexed is null
+    template <typename T>
+    void MarchVolume(const VolumeView<T> &_pointData, IndexedMesh *_indexed);
+    // Marching Cubes over sparse bricks, unpacking two layers per slab
+    template <typename T>
+    void MarchBricks(const BrickVolume<T> &_bricks, IndexedMesh *_indexed);
+    // March every slab, _layers(z, worker) giving the layers either side of slab z and a window of those
+    // around them for gradients, both already loaded by the worker
+    template <typename T, typename Layers>
+    void MarchLayers(const Layers &_layers, IndexedMesh *_indexed);
+    // Indexed march of runs of slabs in parallel, caching the vertex on each edge, then welding the runs together
+    template <typename T, typename Layers>
+    void MarchIndexed(const Layers &_layers, IndexedMesh &_mesh);
+    // Re-march the bricks whose cubes can change since the last call, returning how many were marched
+    template <typename Source>
+    size_t RemarchBricks(const Source &_source);
+    // Indexed mesh of the cubes starting in brick _brick, sharing vertices within the brick
+    template <typename Source>
+    void MarchBrick(const Source &_source, size_t _brick, BrickMesh &_out) const;
+    // Re-march every level of the chunks whose cubes can change since the last call, returning how many were marched
+    template <typename Source>
+    size_t RemarchChunks(const Source &_source);
+    // Level _level of the chunk whose first point is _first, _cache is scratch space for its edge vertices
+    template <typename Source>
+    void MarchChunk(const Source &_source, const std::array<unsigned int, 3> &_first, unsigned int _level,
+                    std::vector<uint32_t> &_cache, ChunkLevel &_out) const;
+    // Hang a strip _depth deep from each open edge of _level's surface, against its normals
+    static void AddSkirt(ChunkLevel &_level, float _depth);
+    // Mesh space position of (_x, _y, _z), in sampled points
+    ngl::Vec3 LatticePosition(float _x, float _y, float _z) const;
+    // Flying Edges into _mesh, the vertex on every crossed edge is made once and shared
+    void MarchFlyingEdges(IndexedMesh &_mesh);
+    // First pass, the case of each x edge of every row of layer _z and the part of the row the surface crosses
+    template <typename T>
+    void ClassifyEdgeRows(const VolumeView<T> &_layer, unsigned int _z);
+    // Second pass, how many edges row _row owns that the surface crosses and the triangles of the cubes it starts
+    void CountEdgeRow(size_t _row, unsigned int _y, unsigned int _z);
+    // Last pass, write the vertices and triangles counted by CountEdgeRow() into _mesh
+    // Gradient normals read _source, which must hold the layers either side of _z
+    template <typename Source>
+    void GenerateEdgeRow(const Source &_source, size_t _row, unsigned int _y, unsigned int _z, IndexedMesh &_mesh) const;
+    // Whether point _x of row _row is inside the surface
+    bool EdgeRowInside(size_t _row, unsigned int _x) const;
+    // Cubes [first, second) the surface can pass through between the given rows
+    template <size_t N>
+    std::pair<unsigned int, unsigned int> TrimEdgeRows(const std::array<size_t, N> &_rows) const;
+    // Surface Nets over runs of slabs in parallel, as MarchIndexed()
+    template <typename T, typename Layers>
+    void MarchSurfaceNets(const Layers &_layers, IndexedMesh &_mesh);
+    // Quads Surface Nets makes for the crossed edges at the first point of cell (_x, _y, _z), between 0 and 3
+    unsigned int NetQuads(unsigned int _x, unsigned int _y, unsigned int _z, unsigned int _cubeIndex) const;
+    // Surface Nets vertex of a cell, the average of the midpoints of its crossed edges
+    ngl::Vec3 NetVertex(unsigned int _x, unsigned int _y, unsigned int _z, unsigned int _cubeIndex) const;
+    // Whether any brick in the layer of bricks holding slab _z may cross the surface
+    bool SlabActive(unsigned int _z) const;
+    // Call _emit(x, y, cubeIndex) for each cube between two neighbouring layers that the surface passes through
+    template <typename T, typename Emit>
+    void ClassifySlab(const VolumeView<T> &_layerA, const VolumeView<T> &_layerB, unsigned int _z, Emit &&_emit) const;
+    // One row of ClassifySlab(), _rows being rows y and y + 1 of layer A then of layer B
+    // UnitStride drops the multiply by each layer's stride along x, so adjacent voxels are read straight along the rows
+    template <bool UnitStride, typename T, typename Emit>
+    void ClassifyRow(const std::array<const T *, 4> &_rows, size_t _strideA, size_t _strideB, unsigned int _y, const char *_activeRow, Emit &_emit) const;
+    // Number of vertices MarchSlab() writes for the same slab
+    template <typename T>
+    size_t CountSlab(const VolumeView<T> &_layerA, const VolumeView<T> &_layerB, unsigned int _z) const;
+    // Marching Cubes between two neighbouring layers, _z being the index of _layerA
+    // Writes CountSlab() vertices from _vertices onwards, and their normals from _normals unless it is null
+    // Normals are read from _around, which holds the layers either side of the slab as well
+    template <typename T, typename Source>
+    void MarchSlab(const VolumeView<T> &_layerA, const VolumeView<T> &_layerB, unsigned int _z, const Source &_around,
+                   ngl::Vec3 *_vertices, ngl::Vec3 *_normals) const;
+    // Write the triangles of cube (_x, _y, _z) with index _cubeIndex from _vertices, returning the end of them
+    ngl::Vec3 *EmitCube(unsigned int _x, unsigned int _y, unsigned int _z, unsigned int _cubeIndex, ngl::Vec3 *_vertices) const;
+    // Cube index of the cube whose first point is (_x, _y, _z)
+    template <typename Source>
+    unsigned int CubeIndex(const Source &_source, unsigned int _x, unsigned int _y, unsigned int _z) const;
+    // Midpoint of edge _edge of cube (_x, _y, _z) in mesh space, cropped data's origin included
+    ngl::Vec3 EdgeVertex(unsigned int _x, unsigned int _y, unsigned int _z, unsigned int _edge) const;
+    // Normal of the surface where it crosses edge _edge of cube (_x, _y, _z), from the points of _source
+    template <typename Source>
+    ngl::Vec3 EdgeNormal(const Source &_source, unsigned int _x, unsigned int _y, unsigned int _z, unsigned int _edge) const;
+    // Surface Nets normal of a cell, the average of the normals of its crossed edges
+    template <typename Source>
+    ngl::Vec3 NetNormal(const Source &_source, unsigned int _x, unsigned int _y, unsigned int _z, unsigned int _cubeIndex) const;
+
+    AnyVolumeView m_pointData;
+    // Used instead of m_pointData when set
+    const BrickVolume<uint8_t> *m_bricks = nullptr;
+    // Per brick flag of whether its cubes may cross the surface, empty marches every cube
+    std::vector<char> m_activeBricks;
+    unsigned int m_bricksX = 0;
+    unsigned int m_bricksY = 0;
+    // Kept by MarchCubesIncremental(), the mesh of each brick at m_incrementalLevel
+    // and the range of the voxels each brick's cubes reach
+    struct BrickMesh
+    {
+      IndexedMesh mesh;
+      // (edge, vertex) of the vertices on a face the brick shares with another, sorted by edge
+      // Edges are numbered by their first point's index in the volume, times 3, plus their axis
+      std::vector<std::pair<size_t, uint32_t>> seam;
+    };
+    std::vector<BrickMesh> m_brickMeshes;
+    std::vector<std::pair<float, float>> m_brickSpans;
+    int m_incrementalLevel = 0;
+    // Kept by MarchChunks() in the same way, every chunk of the volume at m_chunkLevel (without levels
+    // when the surface misses it), where it starts and the range of the voxels its cubes reach
+    std::vector<MeshChunk> m_chunkMeshes;
+    std::vector<std::array<unsigned int, 3>> m_chunkFirsts;
+    std::vector<std::pair<float, float>> m_chunkSpans;
+    int m_chunkLevel = 0;
+    int m_surfaceLevel = 0;
+    Engine m_engine = Engine::MarchingCubes;
+
+    // Flying Edges state of each row of points (y, z), kept so repeated marches reuse the memory
+    struct EdgeRow
+    {
+      // First and one past the last x edge the surface crosses
+      unsigned int xMin = 0;
+      unsigned int xMax = 0;
+      // Crossed edges the row owns, along x and towards the next row in y and in z
+      size_t xEdges = 0;
+      size_t yEdges = 0;
+      size_t zEdges = 0;
+      // Triangles of the cubes whose first point is on the row
+      size_t triangles = 0;
+      size_t firstVertex = 0;
+      size_t firstTriangle = 0;
+    };
+    std::vector<EdgeRow> m_edgeRows;
+    // Bit 0 set when the start of the edge is inside the surface, bit 1 the end, (m_pointsPerRow - 1) per row
+    std::vector<uint8_t> m_edgeCases;
+    int m_minSurfaceLevel = 0;
+    int m_maxSurfaceLevel = 255;
 
     // Image dimensions
     unsigned int m_imageWidth;
@@ -42,14 +315,32 @@ class Mesh
     // See MarchCubes() in Mesh.cpp for explanation and implementation
     unsigned int m_pointsPerRow;
     unsigned int m_columns;
+    unsigned int m_layers;
     unsigned int m_totalSquares;
+    // Layers of the whole stack, which the mesh is centred on even when cropped
+    unsigned int m_centreLayers;
+    // Shift of cropped data from the start of the stack, in mesh space
+    ngl::Vec3 m_originOffset;
 
-    Table m_table;
     // Midpoint offset of each edge
     float m_offset;
+    // Mesh space coordinate of each point along x, y and z, and of the midpoint of the edge after it
+    // Filled by SetOrigin(), so EdgeVertex() only looks coordinates up
+    std::array<std::vector<float>, 3> m_pointCoordinates;
+    std::array<std::vector<float>, 3> m_midpointCoordinates;
     // Stores vertex data of triangles to draw
     std::vector<ngl::Vec3> m_vertexData;
 
+    // Four layer ring used while streaming, layer n lives in slot n % 4
+    // Slab z is marched once layer z + 2 arrives, so the gradient can see a layer either side of it
+    Volume<uint8_t> m_streamLayers;
+    unsigned int m_streamedLayers = 0;
+    std::vector<ngl::Vec3> m_streamNormals;
+    bool m_gradientNormals = false;
+
+    // Workers that march slabs in parallel
+    ThreadPool m_pool;
+
     // Scale of mesh from pixel to coordinate space
     float m_meshScale = 0.1f;
 
@@ -22,8 +22,10 @@
 #include <QSet>
 
 #include "Camera.h"
+#include "Decimator.h"
 #include "ImageStack.h"
 #include "Mesh.h"
+#include "PackedMesh.h"
 #include "Timer.h"
 #include "WindowParams.h"
 
@@ -56,6 +58,8 @@ class NGLScene : public QOpenGLWidget
     // Inputs
     void setSampleResolution(int _resolution);
     void setSurfaceLevel(int _level);
+    // Percentage of marched triangles kept by decimation
+    void setDecimation(int _percent);
     void setMetallicness(double _metallicness);
     void setRoughness(double _roughness);
     void setAO(double _ao);
@@ -75,9 +79,26 @@ class NGLScene : public QOpenGLWidget
     // Cameras
     void setCamera(int _camera);
 
+    // Extraction algorithm, in the order of Mesh::Engine
+    void setEngine(int _engine);
+
     // Toggles
     void toggleWireframeMode(bool _mode);
     void toggleBackFaceCull(bool _mode);
+    // March slices as they are decoded instead of sampling the whole stack first
+    void toggleStreaming(bool _mode);
+    // Crop sampled data to voxels at or above the surface level set when sampling
+    void toggleAutoCrop(bool _mode);
+    // Hold sampled images as bricks, so empty space costs almost no memory
+    void toggleSparseStorage(bool _mode);
+    // March chunks at several levels of detail along with the mesh, and draw those instead
+    void toggleChunks(bool _mode);
+    // Hold and upload marched meshes as 16-bit positions and octahedral normals
+    void toggleCompactVertices(bool _mode);
+
+  signals:
+    // Sampled data changed to a voxel type with a different value range
+    void surfaceLevelRangeChanged(int _minimum, int _maximum);
 
   private:
     void keyPressEvent(QKeyEvent *_event) override;
@@ -116,6 +137,10 @@ class NGLScene : public QOpenGLWidget
     // Toggles
     bool m_wireframe = false;
     bool m_cull = false;
+    bool m_streaming = false;
+    bool m_autoCrop = false;
+    bool m_chunked = false;
+    bool m_compactVertices = false;
 
     // Stack
     ImageStack m_stack;
@@ -125,6 +150,24 @@ class NGLScene : public QOpenGLWidget
     Mesh m_mesh;
     std::vector<ngl::Vec3> m_vertexData;
     std::vector<ngl::Vec3> m_normals;
+    // Marched data is indexed unless streamed, which fills m_vertexData instead
+    IndexedMesh m_indexedMesh;
+    // Drawn in place of m_indexedMesh when chunked, export still writes m_indexedMesh
+    std::vector<MeshChunk> m_chunks;
+    // Held in place of m_indexedMesh or m_vertexData with compact vertices on
+    PackedMesh m_packedMesh;
+    // Pack the marched mesh into m_packedMesh and release the float copy
+    void CompactMesh();
+    // Whether m_mesh still borrows the sampled data, so the surface level can re-march it
+    bool m_canRemarch = false;
+    // Surface level the sampled data was auto-cropped at, voxels below it outside the box are gone
+    bool m_cropped = false;
+    int m_cropLevel = 0;
+
+    // Decimation
+    Decimator m_decimator;
+    int m_decimation = 100;
+    void DecimateMesh();
 
     // Export
     bool m_exported = false;
@@ -134,8 +177,21 @@ class NGLScene : public QOpenGLWidget
 
     // VAO
     void BuildVAO();
+    void BuildIndexedVAO();
+    // A VAO per level of each chunk, null for a level without triangles
+    void BuildChunkVAOs();
+    void RemoveChunkVAOs();
+    // Draw each chunk at the coarsest level whose error covers at most c_maxPixelError pixels
+    void DrawChunks();
+    static std::unique_ptr<ngl::AbstractVAO> IndexedVAO(const std::vector<ngl::Vec3> &_vertices, const std::vector<ngl::Vec3> &_normals,
+                                                        const std::vector<uint32_t> &_indices);
+    // Indexed, or drawn as a triangle soup when _mesh has no indices
+    static std::unique_ptr<ngl::AbstractVAO> PackedVAO(const PackedMesh &_mesh);
+    // Tell the shader whether VAOs hold packed vertices, and the box their positions are fractions of
+    void LoadVertexFormatToShader(bool _packed, const ngl::Vec3 &_minimum = ngl::Vec3(), const ngl::Vec3 &_extent = ngl::Vec3());
     bool m_builtVAO = false;
     std::unique_ptr<ngl::AbstractVAO> m_vao;
+    std::vector<std::unique_ptr<ngl::AbstractVAO>> m_chunkVAOs;
 
     // Transformations to pass to the shader
     ngl::Mat4 m_tx;
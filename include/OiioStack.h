@@ -0,0 +1,84 @@
+/// \file OiioStack.h
+/// \brief Reading tiled and multi-page TIFF or EXR stacks through an OpenImageIO ImageCache
+/// \author Josh Bailey
+/// \version 1.0
+/// \date 17/10/26 Initial version
+/// Revision History:
+///
+/// \todo
+
+#ifndef OIIO_STACK_H_
+#define OIIO_STACK_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include <OpenImageIO/oiioversion.h>
+
+#include "ThreadPool.h"
+#include "Volume.h"
+
+OIIO_NAMESPACE_BEGIN
+class ImageCache;
+OIIO_NAMESPACE_END
+
+class OiioStack
+{
+  public:
+    OiioStack() = default;
+    ~OiioStack();
+    OiioStack(const OiioStack &) = delete;
+    OiioStack &operator=(const OiioStack &) = delete;
+
+    // Whether _path has a .tif, .tiff or .exr extension
+    static bool IsOiioFile(const std::string &_path);
+
+    // Read the header of every page of every file, each page becomes one slice
+    bool Open(const std::vector<std::string> &_files);
+    // Read channel 0 of every _resolution'th row, column and slice through the cache
+    // 8-bit files stay 8-bit, anything else is read as 16-bit (floats map 0 to 1 onto 0 to 65535)
+    bool LoadVoxels(ThreadPool &_pool, unsigned int _resolution);
+    void Clear();
+
+    // Sampled voxels, already strided by the resolution passed to LoadVoxels()
+    AnyVolumeView View() const;
+
+    // Setters and getters
+    // Most memory the cache may hold in tiles, in megabytes
+    void SetMemoryCap(float _megabytes);
+    float GetMemoryCap() const { return m_memoryCap; }
+    bool IsOpen() const { return !m_slices.empty(); }
+    size_t GetWidth() const { return m_width; }
+    size_t GetHeight() const { return m_height; }
+    size_t GetDepth() const { return m_slices.size(); }
+    const std::string &GetError() const { return m_error; }
+
+  private:
+    struct Slice
+    {
+      std::string path;
+      int subimage = 0;
+    };
+
+    struct CacheDeleter
+    {
+      void operator()(OIIO::ImageCache *_cache) const;
+    };
+
+    bool LoadSlice(const Slice &_slice, unsigned int _resolution, void *_voxels, bool _eightBit) const;
+    bool Fail(const std::string &_error);
+
+    std::unique_ptr<OIIO::ImageCache, CacheDeleter> m_cache;
+    float m_memoryCap = 1024.0f;
+    std::vector<Slice> m_slices;
+    size_t m_width = 0;
+    size_t m_height = 0;
+    bool m_eightBit = false;
+    std::variant<Volume<uint8_t>, Volume<uint16_t>> m_volume;
+    std::string m_error;
+};
+
+#endif  // _OIIO_STACK_H_
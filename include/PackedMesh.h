@@ -0,0 +1,55 @@
+/// \file PackedMesh.h
+/// \brief Quantised vertex format for holding and uploading marched meshes
+/// \author Josh Bailey
+/// \version 1.0
+/// \date 17/10/26 Initial version
+/// Revision History:
+///
+/// \todo
+
+#ifndef PACKEDMESH_H_
+#define PACKEDMESH_H_
+
+#include <ngl/Vec3.h>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// 12 bytes in place of the 24 of a float position and normal
+struct PackedVertex
+{
+  // How far across the mesh's bounds the vertex is on each axis, 0 to 65535
+  // The fourth is unused, it keeps the normal on a 4 byte boundary for the GPU
+  std::array<uint16_t, 4> position;
+  // Octahedral encoded unit normal, as signed normalised values
+  std::array<int16_t, 2> normal;
+};
+static_assert(sizeof(PackedVertex) == 12, "PackedVertex must match the VAO layout");
+
+struct PackedMesh
+{
+  std::vector<PackedVertex> vertices;
+  // Three per triangle, empty when the vertices are a triangle soup
+  std::vector<uint32_t> indices;
+  // Mesh space corner positions are measured from, and the size of the box they span
+  ngl::Vec3 minimum;
+  ngl::Vec3 extent;
+
+  // Decoded position and normal of vertex _vertex
+  ngl::Vec3 Position(size_t _vertex) const;
+  ngl::Vec3 Normal(size_t _vertex) const;
+};
+
+// Quantise a mesh into the box from _minimum to _maximum, which should hold every vertex
+// A vertex outside it is clamped to its edge, _normals must have a normal per vertex
+PackedMesh PackMesh(const std::vector<ngl::Vec3> &_vertices, const std::vector<ngl::Vec3> &_normals,
+                    const std::vector<uint32_t> &_indices, const ngl::Vec3 &_minimum, const ngl::Vec3 &_maximum);
+// As above for a triangle soup laid out as Mesh::MarchCubes() with gradient normals, vertices then normals
+PackedMesh PackSoup(const std::vector<ngl::Vec3> &_soup, const ngl::Vec3 &_minimum, const ngl::Vec3 &_maximum);
+
+// Unit normal folded onto an octahedron and flattened into a square, so two values hold any direction
+std::array<int16_t, 2> EncodeNormal(const ngl::Vec3 &_normal);
+ngl::Vec3 DecodeNormal(const std::array<int16_t, 2> &_encoded);
+
+#endif  // _PACKEDMESH_H_
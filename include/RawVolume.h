@@ -0,0 +1,69 @@
+/// \file RawVolume.h
+/// \brief Memory mapped raw volumes described by NRRD or MetaImage headers
+/// \author Josh Bailey
+/// \version 1.0
+/// \date 17/10/26 Initial version
+/// Revision History:
+///
+/// \todo
+
+#ifndef RAW_VOLUME_H_
+#define RAW_VOLUME_H_
+
+#include <cstdint>
+#include <istream>
+#include <string>
+
+#include "MappedFile.h"
+#include "Volume.h"
+
+class RawVolume
+{
+  public:
+    RawVolume() = default;
+
+    // Open a .nrrd, .nhdr, .mhd or .mha volume of 8 or 16-bit unsigned voxels
+    bool Open(const std::string &_headerPath);
+    void Close();
+    // Whether _path has the extension of a supported volume header
+    static bool IsVolumeFile(const std::string &_path);
+
+    // Full resolution voxels, read straight from the mapped file where possible
+    AnyVolumeView View() const;
+
+    // Getters
+    bool IsOpen() const { return m_open; }
+    size_t GetWidth() const { return m_header.width; }
+    size_t GetHeight() const { return m_header.height; }
+    size_t GetDepth() const { return m_header.depth; }
+    unsigned int GetBytesPerVoxel() const { return m_header.bytesPerVoxel; }
+    const std::string &GetError() const { return m_error; }
+
+  private:
+    struct Header
+    {
+      size_t width = 0;
+      size_t height = 0;
+      size_t depth = 0;
+      unsigned int bytesPerVoxel = 0;
+      bool bigEndian = false;
+      // Empty when the voxels follow the header in the same file
+      std::string dataFile;
+      // Byte offset of the voxels, -1 means they end the file
+      long long dataOffset = 0;
+    };
+
+    bool ParseNRRD(std::istream &_file, Header &_header);
+    bool ParseMetaImage(std::istream &_file, Header &_header);
+    bool Fail(const std::string &_error);
+
+    Header m_header;
+    MappedFile m_file;
+    const uint8_t *m_voxels = nullptr;
+    // Used instead of the mapping when voxels need their bytes swapping or are misaligned
+    Volume<uint16_t> m_converted;
+    bool m_open = false;
+    std::string m_error;
+};
+
+#endif  // _RAW_VOLUME_H_
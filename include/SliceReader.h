@@ -0,0 +1,77 @@
+/// \file SliceReader.h
+/// \brief Decodes slices ahead of their consumer through a bounded queue
+/// \author Josh Bailey
+/// \version 1.0
+/// \date 17/10/26 Initial version
+/// Revision History:
+///
+/// \todo
+
+#ifndef SLICE_READER_H_
+#define SLICE_READER_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "ThreadPool.h"
+#include "Volume.h"
+
+// Workers decode layers in order into a ring of slots while the consumer takes them in order
+// A worker waits for a slot to be released before it decodes further ahead (back-pressure)
+class SliceReader
+{
+  public:
+    // Decode layer _layer into _points on worker _worker, returns false if it cannot be read
+    using Decoder = std::function<bool(size_t _layer, uint8_t *_points, unsigned int _worker)>;
+
+    explicit SliceReader(ThreadPool &_pool) : m_pool(_pool) {}
+    ~SliceReader();
+    SliceReader(const SliceReader &) = delete;
+    SliceReader &operator=(const SliceReader &) = delete;
+
+    // Start decoding _layers layers of _width * _height points, holding at most _queueDepth at once
+    void Start(size_t _layers, size_t _width, size_t _height, size_t _queueDepth, Decoder _decoder);
+    // Wait for the next layer in order, releasing the layer handed out before it
+    // Returns false once every layer has been handed out, or when the next layer failed to decode
+    bool Next(VolumeView<uint8_t> &_layer);
+    // Stop decoding ahead and wait for the workers to finish
+    void Stop();
+
+    // Getters
+    // Index of the layer that failed to decode, only valid once Next() has returned false early
+    size_t GetFailedLayer() const { return m_failedLayer; }
+    bool Failed() const { return m_failed; }
+
+  private:
+    // Run on each pool worker until every layer is claimed or the reader stops
+    void Decode(unsigned int _worker);
+
+    ThreadPool &m_pool;
+    Decoder m_decoder;
+    // One layer per slot, layer n is decoded into slot n % depth
+    Volume<uint8_t> m_slots;
+    // Layer held in each slot plus one, 0 while the slot is empty or being decoded
+    std::vector<size_t> m_ready;
+
+    size_t m_layers = 0;
+    // Next layer a worker will decode
+    size_t m_claimed = 0;
+    // Next layer the consumer will be given
+    size_t m_next = 0;
+    // Layers the consumer has finished with, their slots are free again
+    size_t m_released = 0;
+    bool m_running = false;
+    bool m_stopping = false;
+    bool m_failed = false;
+    size_t m_failedLayer = 0;
+
+    std::mutex m_mutex;
+    std::condition_variable m_slotReleased;
+    std::condition_variable m_layerDecoded;
+};
+
+#endif  // _SLICE_READER_H_
@@ -0,0 +1,57 @@
+/// \file ThreadPool.h
+/// \brief Reusable pool of worker threads
+/// \author Josh Bailey
+/// \version 1.0
+/// \date 17/10/26 Initial version
+/// Revision History:
+///
+/// \todo
+
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+  public:
+    // A thread count of 0 uses every hardware thread available
+    explicit ThreadPool(unsigned int _threads = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Queue a task, which is passed the index of the worker that runs it
+    void Submit(std::function<void(unsigned int)> _task);
+    // Block until every queued task has finished
+    void Wait();
+    // Run _task(index, worker) for every index in [0, _count) and block until done
+    // Must not be called from inside a task running on the same pool
+    void ParallelFor(size_t _count, const std::function<void(size_t, unsigned int)> &_task);
+
+    // Setters and getters
+    void SetThreadCount(unsigned int _threads);
+    unsigned int GetThreadCount() { return static_cast<unsigned int>(m_workers.size()); }
+
+  private:
+    void Start(unsigned int _threads);
+    void Stop();
+    void WorkerLoop(unsigned int _worker);
+
+    std::vector<std::thread> m_workers;
+    std::deque<std::function<void(unsigned int)>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_taskAvailable;
+    std::condition_variable m_tasksFinished;
+    // Tasks queued or currently running
+    size_t m_pendingTasks = 0;
+    bool m_stopping = false;
+};
+
+#endif  // _THREAD_POOL_H_
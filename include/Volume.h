@@ -0,0 +1,178 @@
+/// \file Volume.h
+/// \brief Contiguous 3D voxel storage and non-owning views onto it
+/// \author Josh Bailey
+/// \version 1.0
+/// \date 17/10/26 Initial version
+/// Revision History:
+///
+/// \todo
+
+#ifndef VOLUME_H_
+#define VOLUME_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+// Axis aligned block of voxels, (x, y, z) being its first voxel
+// An empty box stands for the whole volume wherever a region is optional
+struct VoxelBox
+{
+  size_t x = 0;
+  size_t y = 0;
+  size_t z = 0;
+  size_t width = 0;
+  size_t height = 0;
+  size_t depth = 0;
+
+  bool Empty() const { return width == 0 || height == 0 || depth == 0; }
+};
+
+// Read only window onto voxel data owned elsewhere
+// Strides are in voxels, so a view can skip voxels without copying them
+template <typename T>
+class VolumeView
+{
+  public:
+    using VoxelType = T;
+
+    VolumeView() = default;
+    VolumeView(const T *_data, size_t _width, size_t _height, size_t _depth,
+               size_t _strideX, size_t _strideY, size_t _strideZ)
+      : m_data(_data), m_width(_width), m_height(_height), m_depth(_depth),
+        m_strideX(_strideX), m_strideY(_strideY), m_strideZ(_strideZ) {}
+
+    T At(size_t _x, size_t _y, size_t _z) const { return m_data[_x * m_strideX + _y * m_strideY + _z * m_strideZ]; }
+    // First voxel of layer _z
+    const T *Slice(size_t _z) const { return m_data + _z * m_strideZ; }
+    const T *Data() const { return m_data; }
+    bool Empty() const { return m_width == 0 || m_height == 0 || m_depth == 0; }
+
+    // Layer _z on its own, as a view one voxel deep
+    VolumeView Layer(size_t _z) const { return VolumeView(Slice(_z), m_width, m_height, 1, m_strideX, m_strideY, m_strideZ); }
+    // Just the voxels inside _box, which must lie within the view
+    VolumeView SubView(const VoxelBox &_box) const
+    {
+      return VolumeView(m_data + _box.x * m_strideX + _box.y * m_strideY + _box.z * m_strideZ,
+                        _box.width, _box.height, _box.depth, m_strideX, m_strideY, m_strideZ);
+    }
+    // Every _step'th voxel along each axis, still without copying
+    VolumeView Strided(size_t _step) const
+    {
+      return VolumeView(m_data, (m_width + _step - 1) / _step, (m_height + _step - 1) / _step, (m_depth + _step - 1) / _step,
+                        m_strideX * _step, m_strideY * _step, m_strideZ * _step);
+    }
+
+    // Getters
+    size_t GetWidth() const { return m_width; }
+    size_t GetHeight() const { return m_height; }
+    size_t GetDepth() const { return m_depth; }
+    size_t GetStrideX() const { return m_strideX; }
+    size_t GetStrideY() const { return m_strideY; }
+    size_t GetStrideZ() const { return m_strideZ; }
+
+  private:
+    const T *m_data = nullptr;
+    size_t m_width = 0;
+    size_t m_height = 0;
+    size_t m_depth = 0;
+    size_t m_strideX = 1;
+    size_t m_strideY = 0;
+    size_t m_strideZ = 0;
+};
+
+// View of a block copied out of a larger volume, read by positions in that volume
+// Lets a marcher read the voxels it has already loaded for a slab or brick through the same At() as the whole volume
+template <typename T>
+struct VolumeWindow
+{
+  using VoxelType = T;
+
+  VolumeView<T> voxels;
+  // Position of the view's first voxel in the larger volume
+  size_t x = 0;
+  size_t y = 0;
+  size_t z = 0;
+
+  T At(size_t _x, size_t _y, size_t _z) const { return voxels.At(_x - x, _y - y, _z - z); }
+};
+
+// Owns a width * height * depth block of voxels in a single allocation
+// Voxels are stored x fastest, then y, then z
+template <typename T>
+class Volume
+{
+  public:
+    using VoxelType = T;
+
+    Volume() = default;
+    Volume(size_t _width, size_t _height, size_t _depth) { Resize(_width, _height, _depth); }
+
+    void Resize(size_t _width, size_t _height, size_t _depth)
+    {
+      m_width = _width;
+      m_height = _height;
+      m_depth = _depth;
+      m_data.assign(_width * _height * _depth, T(0));
+    }
+    void Clear()
+    {
+      m_data.clear();
+      m_data.shrink_to_fit();
+      m_width = m_height = m_depth = 0;
+    }
+
+    T &At(size_t _x, size_t _y, size_t _z) { return m_data[_x + _y * GetStrideY() + _z * GetStrideZ()]; }
+    T At(size_t _x, size_t _y, size_t _z) const { return m_data[_x + _y * GetStrideY() + _z * GetStrideZ()]; }
+    // First voxel of layer _z
+    T *Slice(size_t _z) { return m_data.data() + _z * GetStrideZ(); }
+    const T *Slice(size_t _z) const { return m_data.data() + _z * GetStrideZ(); }
+    T *Data() { return m_data.data(); }
+    const T *Data() const { return m_data.data(); }
+    bool Empty() const { return m_data.empty(); }
+
+    // Borrow the whole volume without copying it
+    VolumeView<T> View() const { return VolumeView<T>(m_data.data(), m_width, m_height, m_depth, 1, GetStrideY(), GetStrideZ()); }
+
+    bool operator==(const Volume &_other) const
+    {
+      return m_width == _other.m_width && m_height == _other.m_height && m_depth == _other.m_depth && m_data == _other.m_data;
+    }
+    bool operator!=(const Volume &_other) const { return !(*this == _other); }
+
+    // Getters
+    size_t GetWidth() const { return m_width; }
+    size_t GetHeight() const { return m_height; }
+    size_t GetDepth() const { return m_depth; }
+    size_t GetStrideY() const { return m_width; }
+    size_t GetStrideZ() const { return m_width * m_height; }
+    size_t GetVoxelCount() const { return m_data.size(); }
+
+  private:
+    std::vector<T> m_data;
+    size_t m_width = 0;
+    size_t m_height = 0;
+    size_t m_depth = 0;
+};
+
+// Any voxel type the mesher understands
+using AnyVolumeView = std::variant<VolumeView<uint8_t>, VolumeView<uint16_t>, VolumeView<int16_t>, VolumeView<float>>;
+
+// Smallest and largest value a voxel of the view's type can hold, clamped to int
+inline std::pair<int, int> VoxelRange(const AnyVolumeView &_view)
+{
+  return std::visit([](const auto &_typed)
+  {
+    using T = typename std::decay_t<decltype(_typed)>::VoxelType;
+    long double low = std::numeric_limits<T>::lowest();
+    long double high = std::numeric_limits<T>::max();
+    return std::make_pair(static_cast<int>(std::max<long double>(low, std::numeric_limits<int>::min())),
+                          static_cast<int>(std::min<long double>(high, std::numeric_limits<int>::max())));
+  }, _view);
+}
+
+#endif  // _VOLUME_H_
@@ -0,0 +1,64 @@
+/// \file VolumeCache.h
+/// \brief On-disk cache of sampled volumes, memory mapped on a hit
+/// \author Josh Bailey
+/// \version 1.0
+/// \date 17/10/26 Initial version
+/// Revision History:
+///
+/// \todo
+
+#ifndef VOLUME_CACHE_H_
+#define VOLUME_CACHE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+#include "Volume.h"
+
+// One file per key, a small header followed by the voxels x fastest, then y, then z
+class VolumeCache
+{
+  public:
+    VolumeCache() = default;
+
+    // "marching-cubes-cache" under the system temp directory
+    static std::string DefaultDirectory();
+    // Hash of the directory path, each file's path, size and modification time, and the sample resolution
+    static uint64_t Key(const std::string &_directory, const std::vector<std::string> &_files, unsigned int _sampleResolution);
+
+    // Map the cache file for _key, returns false on a miss or a stale/corrupt file
+    bool Load(uint64_t _key);
+    // Write _volume as the cache file for _key, replacing any previous file
+    bool Store(uint64_t _key, const VolumeView<uint8_t> &_volume);
+    void Close();
+
+    // Voxels of the loaded cache file, read straight from the mapping
+    VolumeView<uint8_t> View() const;
+
+    // Setters and getters
+    // An empty directory disables the cache
+    void SetDirectory(const std::string &_directory);
+    const std::string &GetDirectory() const { return m_directory; }
+    bool IsEnabled() const { return !m_directory.empty(); }
+    bool IsOpen() const { return m_file.IsOpen(); }
+
+  private:
+    struct Header
+    {
+      char magic[8];
+      uint64_t key;
+      uint64_t width;
+      uint64_t height;
+      uint64_t depth;
+    };
+
+    std::string PathOf(uint64_t _key) const;
+
+    std::string m_directory;
+    MappedFile m_file;
+    Header m_header = {};
+};
+
+#endif  // _VOLUME_CACHE_H_
@@ -0,0 +1,53 @@
+/// \file VolumePyramid.h
+/// \brief Box filtered mip levels of a sampled volume
+/// \author Josh Bailey
+/// \version 1.0
+/// \date 17/10/26 Initial version
+/// Revision History:
+///
+/// \todo
+
+#ifndef VOLUME_PYRAMID_H_
+#define VOLUME_PYRAMID_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "ThreadPool.h"
+#include "Volume.h"
+
+// Level 0 is the base volume itself, level n has voxels 2^n base voxels apart
+class VolumePyramid
+{
+  public:
+    // Levels 1x, 2x, 4x and 8x
+    static constexpr unsigned int c_maxLevels = 4;
+
+    VolumePyramid() = default;
+
+    // Borrow _base as level 0 and filter each further level from the one before, in parallel over layers
+    // Stops early once a level would be less than 2 voxels along any axis
+    void Build(const VolumeView<uint8_t> &_base, ThreadPool &_pool, unsigned int _levels = c_maxLevels);
+    void Clear();
+
+    // Voxels of level _level, level 0 being the base
+    VolumeView<uint8_t> Level(unsigned int _level) const;
+    // Level whose voxels are _factor base voxels apart, -1 if there is none
+    int LevelForFactor(unsigned int _factor) const;
+    // Base voxels the centre of level _level's first voxel lies past base voxel 0
+    // Each level averages pairs, so its voxels sit between those of the level before
+    static float SampleOffset(unsigned int _level) { return ((1u << _level) - 1) / 2.0f; }
+    // Average each 2x2x2 block of _source around layer 2 * _z into _out, repeating edge voxels of odd sizes
+    static void DownsampleLayer(const VolumeView<uint8_t> &_source, size_t _z, uint8_t *_out);
+
+    // Getters
+    unsigned int GetLevelCount() const { return m_base.Empty() ? 0 : static_cast<unsigned int>(m_levels.size()) + 1; }
+    bool Empty() const { return m_base.Empty(); }
+
+  private:
+    VolumeView<uint8_t> m_base;
+    // Levels 1 and up
+    std::vector<Volume<uint8_t>> m_levels;
+};
+
+#endif  // _VOLUME_PYRAMID_H_
@@ -12,6 +12,11 @@ layout (location = 1) in vec3 inNormal;
 /// @brief the in uv
 layout (location = 2) in vec2 inUV;
 
+/// @brief packed vertices hold positions as fractions of a box and normals octahedral encoded in xy
+uniform int packedVertices;
+uniform vec3 boundsMinimum;
+uniform vec3 boundsExtent;
+
 out vec3 worldPos;
 out vec3 normal;
 
@@ -22,11 +27,25 @@ layout( std140) uniform TransformUBO
   mat4 M;
 }transforms;
 
+// Unfold an octahedral normal, as DecodeNormal() in PackedMesh.cpp
+vec3 decodeNormal(vec2 _encoded)
+{
+  vec3 n = vec3(_encoded, 1.0 - abs(_encoded.x) - abs(_encoded.y));
+  if (n.z < 0.0)
+  {
+    vec2 signs = vec2(n.x < 0.0 ? -1.0 : 1.0, n.y < 0.0 ? -1.0 : 1.0);
+    n.xy = (1.0 - abs(n.yx)) * signs;
+  }
+  return normalize(n);
+}
+
 void main()
 {
-  worldPos = vec3(transforms.M * vec4(inVert, 1.0f));
-  normal=normalize(mat3(transforms.normalMatrix)*inNormal);
-  gl_Position = transforms.MVP*vec4(inVert,1.0);
+  vec3 position = packedVertices != 0 ? boundsMinimum + inVert * boundsExtent : inVert;
+  vec3 objectNormal = packedVertices != 0 ? decodeNormal(inNormal.xy) : inNormal;
+  worldPos = vec3(transforms.M * vec4(position, 1.0f));
+  normal=normalize(mat3(transforms.normalMatrix)*objectNormal);
+  gl_Position = transforms.MVP*vec4(position,1.0);
 
 
 }
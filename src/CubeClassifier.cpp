@@ -0,0 +1,224 @@
+///
+/// @file CubeClassifier.cpp
+/// @brief Vectorised cube index classification of 8-bit voxel rows
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CUBE_CLASSIFIER_SSE2
+#include <emmintrin.h>
+#endif
+
+// AVX2 is compiled per function and only run when the CPU reports it
+#if defined(CUBE_CLASSIFIER_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#define CUBE_CLASSIFIER_AVX2
+#include <immintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "CubeClassifier.h"
+
+#ifdef CUBE_CLASSIFIER_SSE2
+namespace
+{
+  unsigned int LowestBit(uint32_t _mask)
+  {
+#ifdef _MSC_VER
+    unsigned long bit;
+    _BitScanForward(&bit, _mask);
+    return static_cast<unsigned int>(bit);
+#else
+    return static_cast<unsigned int>(__builtin_ctz(_mask));
+#endif
+  }
+
+  // Append the x of each set bit of _mask (offset by _first) and its index from _indices
+  size_t Compact(uint32_t _mask, size_t _first, const uint8_t *_indices, uint32_t *_x, uint8_t *_index)
+  {
+    size_t count = 0;
+    while (_mask != 0)
+    {
+      unsigned int bit = LowestBit(_mask);
+      _x[count] = static_cast<uint32_t>(_first + bit);
+      _index[count] = _indices[bit];
+      ++count;
+      _mask &= _mask - 1;
+    }
+    return count;
+  }
+}
+#endif
+
+CubeClassifier::Path CubeClassifier::Best()
+{
+  static const Path best = Supported(Path::AVX2) ? Path::AVX2 : Supported(Path::SSE2) ? Path::SSE2 : Path::Scalar;
+  return best;
+}
+
+bool CubeClassifier::Supported(Path _path)
+{
+  switch (_path)
+  {
+    case Path::SSE2:
+    {
+#ifdef CUBE_CLASSIFIER_SSE2
+      return true;
+#else
+      return false;
+#endif
+    }
+
+    case Path::AVX2:
+    {
+#ifdef CUBE_CLASSIFIER_AVX2
+      return __builtin_cpu_supports("avx2");
+#else
+      return false;
+#endif
+    }
+
+    default:
+    {
+      return true;
+    }
+  }
+}
+
+size_t CubeClassifier::ClassifyRow(const uint8_t *const _rows[4], size_t _width, int _level, uint32_t *_x, uint8_t *_index, Path _path)
+{
+  // Every voxel is inside (or outside) the surface, so no cube crosses it
+  if (_width < 2 || _level <= 0 || _level > 255)
+  {
+    return 0;
+  }
+
+  uint8_t level = static_cast<uint8_t>(_level);
+  size_t first = 0;
+  size_t count = 0;
+  if (_path == Path::AVX2 && Supported(Path::AVX2))
+  {
+    count += ClassifyAVX2(_rows, first, _width, level, _x + count, _index + count);
+  }
+  if (_path != Path::Scalar && Supported(Path::SSE2))
+  {
+    count += ClassifySSE2(_rows, first, _width, level, _x + count, _index + count);
+  }
+  return count + ClassifyScalar(_rows, first, _width, level, _x + count, _index + count);
+}
+
+size_t CubeClassifier::ClassifyScalar(const uint8_t *const _rows[4], size_t _first, size_t _width, uint8_t _level, uint32_t *_x, uint8_t *_index)
+{
+  size_t count = 0;
+  for (size_t x = _first; x + 1 < _width; ++x)
+  {
+    unsigned int cubeIndex = static_cast<unsigned int>(_rows[0][x] >= _level)
+                           | static_cast<unsigned int>(_rows[0][x + 1] >= _level) << 1
+                           | static_cast<unsigned int>(_rows[1][x + 1] >= _level) << 2
+                           | static_cast<unsigned int>(_rows[1][x] >= _level) << 3
+                           | static_cast<unsigned int>(_rows[2][x] >= _level) << 4
+                           | static_cast<unsigned int>(_rows[2][x + 1] >= _level) << 5
+                           | static_cast<unsigned int>(_rows[3][x + 1] >= _level) << 6
+                           | static_cast<unsigned int>(_rows[3][x] >= _level) << 7;
+    if (cubeIndex != 0 && cubeIndex != 255)
+    {
+      _x[count] = static_cast<uint32_t>(x);
+      _index[count] = static_cast<uint8_t>(cubeIndex);
+      ++count;
+    }
+  }
+  return count;
+}
+
+size_t CubeClassifier::ClassifySSE2(const uint8_t *const _rows[4], size_t &_first, size_t _width, uint8_t _level, uint32_t *_x, uint8_t *_index)
+{
+  size_t count = 0;
+#ifdef CUBE_CLASSIFIER_SSE2
+  const __m128i level = _mm_set1_epi8(static_cast<char>(_level));
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i full = _mm_set1_epi8(-1);
+  // Corner bits of voxel x and x + 1 of each row, in the order of the scalar path
+  const uint8_t nearBits[4] = {1, 8, 16, 128};
+  const uint8_t farBits[4] = {2, 4, 32, 64};
+  alignas(16) uint8_t indices[16];
+
+  // 16 cubes at a time, reading up to voxel x + 16
+  for (; _first + 17 <= _width; _first += 16)
+  {
+    __m128i cubeIndex = zero;
+    for (int r = 0; r < 4; ++r)
+    {
+      __m128i nearVoxels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(_rows[r] + _first));
+      __m128i farVoxels = _mm_loadu_si128(reinterpret_cast<const __m128i *>(_rows[r] + _first + 1));
+      // Unsigned v >= level is max(v, level) == v
+      __m128i nearInside = _mm_cmpeq_epi8(_mm_max_epu8(nearVoxels, level), nearVoxels);
+      __m128i farInside = _mm_cmpeq_epi8(_mm_max_epu8(farVoxels, level), farVoxels);
+      cubeIndex = _mm_or_si128(cubeIndex, _mm_and_si128(nearInside, _mm_set1_epi8(static_cast<char>(nearBits[r]))));
+      cubeIndex = _mm_or_si128(cubeIndex, _mm_and_si128(farInside, _mm_set1_epi8(static_cast<char>(farBits[r]))));
+    }
+
+    __m128i uniform = _mm_or_si128(_mm_cmpeq_epi8(cubeIndex, zero), _mm_cmpeq_epi8(cubeIndex, full));
+    uint32_t active = ~static_cast<uint32_t>(_mm_movemask_epi8(uniform)) & 0xFFFFu;
+    if (active != 0)
+    {
+      _mm_store_si128(reinterpret_cast<__m128i *>(indices), cubeIndex);
+      count += Compact(active, _first, indices, _x + count, _index + count);
+    }
+  }
+#else
+  (void)_rows;
+  (void)_first;
+  (void)_width;
+  (void)_level;
+  (void)_x;
+  (void)_index;
+#endif
+  return count;
+}
+
+#ifdef CUBE_CLASSIFIER_AVX2
+__attribute__((target("avx2")))
+#endif
+size_t CubeClassifier::ClassifyAVX2(const uint8_t *const _rows[4], size_t &_first, size_t _width, uint8_t _level, uint32_t *_x, uint8_t *_index)
+{
+  size_t count = 0;
+#ifdef CUBE_CLASSIFIER_AVX2
+  const __m256i level = _mm256_set1_epi8(static_cast<char>(_level));
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i full = _mm256_set1_epi8(-1);
+  const uint8_t nearBits[4] = {1, 8, 16, 128};
+  const uint8_t farBits[4] = {2, 4, 32, 64};
+  alignas(32) uint8_t indices[32];
+
+  // 32 cubes at a time, reading up to voxel x + 32
+  for (; _first + 33 <= _width; _first += 32)
+  {
+    __m256i cubeIndex = zero;
+    for (int r = 0; r < 4; ++r)
+    {
+      __m256i nearVoxels = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(_rows[r] + _first));
+      __m256i farVoxels = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(_rows[r] + _first + 1));
+      __m256i nearInside = _mm256_cmpeq_epi8(_mm256_max_epu8(nearVoxels, level), nearVoxels);
+      __m256i farInside = _mm256_cmpeq_epi8(_mm256_max_epu8(farVoxels, level), farVoxels);
+      cubeIndex = _mm256_or_si256(cubeIndex, _mm256_and_si256(nearInside, _mm256_set1_epi8(static_cast<char>(nearBits[r]))));
+      cubeIndex = _mm256_or_si256(cubeIndex, _mm256_and_si256(farInside, _mm256_set1_epi8(static_cast<char>(farBits[r]))));
+    }
+
+    __m256i uniform = _mm256_or_si256(_mm256_cmpeq_epi8(cubeIndex, zero), _mm256_cmpeq_epi8(cubeIndex, full));
+    uint32_t active = ~static_cast<uint32_t>(_mm256_movemask_epi8(uniform));
+    if (active != 0)
+    {
+      _mm256_store_si256(reinterpret_cast<__m256i *>(indices), cubeIndex);
+      count += Compact(active, _first, indices, _x + count, _index + count);
+    }
+  }
+#else
+  (void)_rows;
+  (void)_first;
+  (void)_width;
+  (void)_level;
+  (void)_x;
+  (void)_index;
+#endif
+  return count;
+}
@@ -0,0 +1,731 @@
+///
+/// @file Decimator.cpp
+/// @brief Quadric error edge collapses over a compact half-edge structure
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "Decimator.h"
+
+namespace
+{
+  // Boundary edges are held by a plane at right angles to their triangle, weighted well above the surface
+  constexpr float c_boundaryWeight = 16.0f;
+  // Collapses turning a remaining triangle by more than about 80 degrees are refused
+  constexpr float c_minNormalDot = 0.2f;
+  // Below this, relative to the quadric's scale, the least error point is too poorly pinned down to trust
+  constexpr double c_minDeterminant = 1e-5;
+  // Triangles per block, enough that seams are a small part of each, few enough to stay in cache
+  constexpr double c_blockTriangles = 32768.0;
+  constexpr size_t c_maxBlocks = 64;
+
+  struct Collapse
+  {
+    float cost;
+    uint32_t edge;
+  };
+
+  // Radix heap (Ahuja et al. 1990), a min-heap for keys that never drop below the last one taken
+  // Bucket i holds keys first differing from the last key taken at bit i - 1, so entries only ever move down
+  // the buckets, each in a sequential pass, rather than being chased through a tree
+  class CollapseQueue
+  {
+    public:
+      // Costs below the last one taken are raised to it, so they come out next
+      void Push(float _cost, uint32_t _edge)
+      {
+        uint32_t key = std::max(Key(_cost), m_last);
+        std::memcpy(&_cost, &key, sizeof(key));
+        m_buckets[Bucket(key)].push_back({_cost, _edge});
+        ++m_size;
+      }
+      bool Empty() const { return m_size == 0; }
+      // Cheapest entry, the queue must not be empty
+      const Collapse &Top()
+      {
+        if (m_buckets[0].empty())
+        {
+          size_t bucket = 1;
+          while (m_buckets[bucket].empty())
+          {
+            ++bucket;
+          }
+          m_last = std::numeric_limits<uint32_t>::max();
+          for (const Collapse &collapse : m_buckets[bucket])
+          {
+            m_last = std::min(m_last, Key(collapse.cost));
+          }
+          for (const Collapse &collapse : m_buckets[bucket])
+          {
+            m_buckets[Bucket(Key(collapse.cost))].push_back(collapse);
+          }
+          m_buckets[bucket].clear();
+        }
+        return m_buckets[0].back();
+      }
+      void Pop()
+      {
+        Top();
+        m_buckets[0].pop_back();
+        --m_size;
+      }
+
+    private:
+      // Non-negative floats order the same as their bits
+      static uint32_t Key(float _cost)
+      {
+        uint32_t key;
+        std::memcpy(&key, &_cost, sizeof(key));
+        return key;
+      }
+      // One more than the highest bit at which _key differs from the last key taken
+      unsigned int Bucket(uint32_t _key) const
+      {
+        uint32_t difference = _key ^ m_last;
+        if (difference == 0)
+        {
+          return 0;
+        }
+#ifdef _MSC_VER
+        unsigned long bit;
+        _BitScanReverse(&bit, difference);
+        return static_cast<unsigned int>(bit) + 1;
+#else
+        return 32 - static_cast<unsigned int>(__builtin_clz(difference));
+#endif
+      }
+
+      std::array<std::vector<Collapse>, 33> m_buckets;
+      uint32_t m_last = 0;
+      size_t m_size = 0;
+  };
+}
+
+Quadric Quadric::Plane(const ngl::Vec3 &_normal, const ngl::Vec3 &_point, float _weight)
+{
+  float d = -_normal.dot(_point);
+  Quadric q;
+  q.xx = _weight * _normal.m_x * _normal.m_x;
+  q.xy = _weight * _normal.m_x * _normal.m_y;
+  q.xz = _weight * _normal.m_x * _normal.m_z;
+  q.xw = _weight * _normal.m_x * d;
+  q.yy = _weight * _normal.m_y * _normal.m_y;
+  q.yz = _weight * _normal.m_y * _normal.m_z;
+  q.yw = _weight * _normal.m_y * d;
+  q.zz = _weight * _normal.m_z * _normal.m_z;
+  q.zw = _weight * _normal.m_z * d;
+  q.ww = _weight * d * d;
+  return q;
+}
+
+Quadric &Quadric::operator+=(const Quadric &_other)
+{
+  xx += _other.xx; xy += _other.xy; xz += _other.xz; xw += _other.xw;
+  yy += _other.yy; yz += _other.yz; yw += _other.yw;
+  zz += _other.zz; zw += _other.zw;
+  ww += _other.ww;
+  return *this;
+}
+
+Quadric Quadric::operator+(const Quadric &_other) const
+{
+  Quadric sum = *this;
+  sum += _other;
+  return sum;
+}
+
+float Quadric::Error(const ngl::Vec3 &_point) const
+{
+  double x = _point.m_x;
+  double y = _point.m_y;
+  double z = _point.m_z;
+  double error = xx * x * x + 2.0 * xy * x * y + 2.0 * xz * x * z + 2.0 * xw * x
+               + yy * y * y + 2.0 * yz * y * z + 2.0 * yw * y
+               + zz * z * z + 2.0 * zw * z
+               + ww;
+  // Rounding can take a perfect fit just below zero
+  return error > 0.0 ? static_cast<float>(error) : 0.0f;
+}
+
+bool Quadric::Minimum(ngl::Vec3 &_point) const
+{
+  // Solve A p = -b by Cramer's rule, A being the upper 3x3
+  double a00 = xx, a01 = xy, a02 = xz, a11 = yy, a12 = yz, a22 = zz;
+  double c0 = a11 * a22 - a12 * a12;
+  double c1 = a02 * a12 - a01 * a22;
+  double c2 = a01 * a12 - a02 * a11;
+  double determinant = a00 * c0 + a01 * c1 + a02 * c2;
+  double trace = a00 + a11 + a22;
+  if (std::abs(determinant) <= c_minDeterminant * trace * trace * trace)
+  {
+    return false;
+  }
+  double bx = -xw, by = -yw, bz = -zw;
+  double inverse = 1.0 / determinant;
+  _point.m_x = static_cast<float>((c0 * bx + c1 * by + c2 * bz) * inverse);
+  _point.m_y = static_cast<float>((c1 * bx + (a00 * a22 - a02 * a02) * by + (a01 * a02 - a00 * a12) * bz) * inverse);
+  _point.m_z = static_cast<float>((c2 * bx + (a01 * a02 - a00 * a12) * by + (a00 * a11 - a01 * a01) * bz) * inverse);
+  return true;
+}
+
+template <typename Visit>
+bool Decimator::VisitOutgoing(uint32_t _vertex, Visit _visit) const
+{
+  uint32_t start = m_outgoing[_vertex];
+  uint32_t edge = start;
+  // Round one way until back at the start or off a boundary
+  for (;;)
+  {
+    _visit(edge);
+    uint32_t twin = m_edges[Prev(edge)].twin;
+    if (twin == c_none)
+    {
+      break;
+    }
+    if (twin == start)
+    {
+      return true;
+    }
+    edge = twin;
+  }
+  // Then the other way, from the start to the fan's other boundary
+  edge = start;
+  for (;;)
+  {
+    uint32_t twin = m_edges[edge].twin;
+    if (twin == c_none)
+    {
+      return false;
+    }
+    edge = Next(twin);
+    _visit(edge);
+  }
+}
+
+IndexedMesh Decimator::Simplify(const IndexedMesh &_mesh, size_t _targetTriangles, float _maxError)
+{
+  m_collapses = 0;
+  if (_mesh.indices.size() / 3 <= _targetTriangles)
+  {
+    return _mesh;
+  }
+  Build(_mesh);
+  size_t triangles = m_edges.size() / 3;
+
+  // Costs are squared distances in the unit cube
+  float scaledError = _maxError * m_scale;
+  float maxCost = _maxError >= std::numeric_limits<float>::max() || scaledError * scaledError >= std::numeric_limits<float>::max()
+                  ? std::numeric_limits<float>::max() : scaledError * scaledError;
+
+  // Each block down to its share of the target, only ever touching its own triangles
+  size_t blockCount = m_blocks.size() - 1;
+  std::vector<size_t> left(blockCount);
+  std::vector<size_t> collapses(blockCount);
+  m_pool.ParallelFor(blockCount, [&](size_t _block, unsigned int)
+  {
+    uint32_t first = m_blocks[_block];
+    uint32_t last = m_blocks[_block + 1];
+    left[_block] = last - first;
+    size_t target = static_cast<size_t>(static_cast<double>(last - first) * _targetTriangles / triangles);
+    collapses[_block] = SimplifyRange(first, last, left[_block], target, maxCost, c_locked | c_seam);
+  });
+  triangles = 0;
+  for (size_t block = 0; block < blockCount; ++block)
+  {
+    triangles += left[block];
+    m_collapses += collapses[block];
+  }
+
+  // Then the seams along with everything else, seam vertices having been skipped when their fans changed
+  for (uint32_t edge = 0; edge < m_edges.size(); ++edge)
+  {
+    if (!Removed(edge) && (m_flags[Origin(edge)] & c_seam))
+    {
+      m_outgoing[Origin(edge)] = edge;
+    }
+  }
+  for (uint8_t &flags : m_flags)
+  {
+    flags &= ~c_seam;
+  }
+  m_collapses += SimplifyRange(0, static_cast<uint32_t>(m_edges.size() / 3), triangles, _targetTriangles, maxCost, c_locked);
+
+  IndexedMesh simplified = Compact(_mesh.normals);
+  Clear();
+  return simplified;
+}
+
+size_t Decimator::SimplifyRange(uint32_t _first, uint32_t _last, size_t &_triangles, size_t _target, float _maxCost, uint8_t _held)
+{
+  // Refused edges are dropped from the queue, collapses around them may free them later, so the queue is
+  // filled again from every edge until a pass collapses nothing more
+  ngl::Vec3 position;
+  std::vector<uint32_t> rings;
+  size_t collapses = 0;
+  bool exceeded = false;
+  size_t collapsed = 1;
+  while (_triangles > _target && !exceeded && collapsed != 0)
+  {
+    // One entry per edge, a boundary edge being its only half-edge
+    CollapseQueue queue;
+    for (uint32_t edge = _first * 3; edge < _last * 3; ++edge)
+    {
+      if (!Removed(edge) && (m_edges[edge].twin == c_none || edge < m_edges[edge].twin))
+      {
+        queue.Push(CollapseCost(edge, position), edge);
+      }
+    }
+
+    // Costs are brought up to date as edges reach the front rather than after every collapse nearby,
+    // which keeps the queue small: an edge that got dearer goes back in if it is no longer the cheapest
+    collapsed = 0;
+    while (_triangles > _target && !queue.Empty())
+    {
+      Collapse top = queue.Top();
+      queue.Pop();
+      if (top.cost > _maxCost)
+      {
+        exceeded = true;
+        break;
+      }
+      if (Removed(top.edge))
+      {
+        continue;
+      }
+      float cost = CollapseCost(top.edge, position);
+      if (cost > top.cost && !queue.Empty() && cost > queue.Top().cost)
+      {
+        queue.Push(cost, top.edge);
+        continue;
+      }
+      if (!CanCollapse(top.edge, position, _held, rings))
+      {
+        continue;
+      }
+      _triangles -= m_edges[top.edge].twin != c_none ? 2 : 1;
+      // Each removed triangle joins its two other edges into one, which may have lost its queued half-edge
+      for (uint32_t joined : CollapseEdge(top.edge, position))
+      {
+        if (joined != c_none)
+        {
+          queue.Push(CollapseCost(joined, position), joined);
+        }
+      }
+      ++collapsed;
+    }
+    collapses += collapsed;
+  }
+  return collapses;
+}
+
+void Decimator::Build(const IndexedMesh &_mesh)
+{
+  size_t vertexCount = _mesh.vertices.size();
+
+  // Scale into the unit cube
+  // Every component set, NGL's constructor would leave y and z at 0
+  float lowest = std::numeric_limits<float>::lowest();
+  float highest = std::numeric_limits<float>::max();
+  ngl::Vec3 maximum(lowest, lowest, lowest);
+  m_minimum = ngl::Vec3(highest, highest, highest);
+  for (const ngl::Vec3 &vertex : _mesh.vertices)
+  {
+    m_minimum = ngl::Vec3(std::min(m_minimum.m_x, vertex.m_x), std::min(m_minimum.m_y, vertex.m_y), std::min(m_minimum.m_z, vertex.m_z));
+    maximum = ngl::Vec3(std::max(maximum.m_x, vertex.m_x), std::max(maximum.m_y, vertex.m_y), std::max(maximum.m_z, vertex.m_z));
+  }
+  float extent = std::max({maximum.m_x - m_minimum.m_x, maximum.m_y - m_minimum.m_y, maximum.m_z - m_minimum.m_z});
+  m_scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+  m_vertices.assign(vertexCount, Vertex());
+  for (size_t i = 0; i < vertexCount; ++i)
+  {
+    m_vertices[i].position = (_mesh.vertices[i] - m_minimum) * m_scale;
+  }
+
+  // A surface crosses about blocks^2 of the blocks^3 cells, so this gives each block roughly c_blockTriangles
+  size_t triangleCount = _mesh.indices.size() / 3;
+  size_t blocks = std::clamp<size_t>(static_cast<size_t>(std::sqrt(static_cast<double>(triangleCount) / c_blockTriangles)), 1, c_maxBlocks);
+  auto block = [&](size_t _triangle)
+  {
+    ngl::Vec3 centre = (m_vertices[_mesh.indices[_triangle * 3]].position + m_vertices[_mesh.indices[_triangle * 3 + 1]].position
+                        + m_vertices[_mesh.indices[_triangle * 3 + 2]].position) * (1.0f / 3.0f);
+    size_t x = std::min(static_cast<size_t>(centre.m_x * blocks), blocks - 1);
+    size_t y = std::min(static_cast<size_t>(centre.m_y * blocks), blocks - 1);
+    size_t z = std::min(static_cast<size_t>(centre.m_z * blocks), blocks - 1);
+    return x + (y + z * blocks) * blocks;
+  };
+
+  // Triangles using a vertex twice have nothing to collapse, the rest are counting sorted by block
+  std::vector<uint32_t> cells(triangleCount);
+  std::vector<uint32_t> cellFirst(blocks * blocks * blocks + 1, 0);
+  for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+  {
+    uint32_t a = _mesh.indices[triangle * 3];
+    uint32_t b = _mesh.indices[triangle * 3 + 1];
+    uint32_t c = _mesh.indices[triangle * 3 + 2];
+    cells[triangle] = a != b && b != c && c != a ? static_cast<uint32_t>(block(triangle)) : c_none;
+    if (cells[triangle] != c_none)
+    {
+      ++cellFirst[cells[triangle] + 1];
+    }
+  }
+  for (size_t cell = 0; cell + 1 < cellFirst.size(); ++cell)
+  {
+    cellFirst[cell + 1] += cellFirst[cell];
+  }
+  uint32_t edgeCount = cellFirst.back() * 3;
+  m_edges.resize(edgeCount);
+  {
+    std::vector<uint32_t> cursor(cellFirst.begin(), cellFirst.end() - 1);
+    for (size_t triangle = 0; triangle < triangleCount; ++triangle)
+    {
+      if (cells[triangle] != c_none)
+      {
+        uint32_t edge = cursor[cells[triangle]]++ * 3;
+        for (uint32_t corner = 0; corner < 3; ++corner)
+        {
+          m_edges[edge + corner] = {_mesh.indices[triangle * 3 + corner], c_none};
+        }
+      }
+    }
+  }
+  // Only blocks with triangles in
+  m_blocks.clear();
+  for (uint32_t first : cellFirst)
+  {
+    if (m_blocks.empty() || first != m_blocks.back())
+    {
+      m_blocks.push_back(first);
+    }
+  }
+  if (m_blocks.size() == 1)
+  {
+    m_blocks.push_back(m_blocks.back());
+  }
+
+  // Half-edges grouped by origin, to find each one's opposite among those leaving its target
+  std::vector<uint32_t> first(vertexCount + 1, 0);
+  for (const HalfEdge &edge : m_edges)
+  {
+    ++first[edge.origin + 1];
+  }
+  for (size_t i = 0; i < vertexCount; ++i)
+  {
+    first[i + 1] += first[i];
+  }
+  std::vector<uint32_t> leaving(edgeCount);
+  {
+    std::vector<uint32_t> cursor(first.begin(), first.end() - 1);
+    for (uint32_t edge = 0; edge < edgeCount; ++edge)
+    {
+      leaving[cursor[Origin(edge)]++] = edge;
+    }
+  }
+
+  // Edges shared by more than two triangles, or by two facing opposite ways, lock both of their vertices
+  m_flags.assign(vertexCount, 0);
+  for (uint32_t edge = 0; edge < edgeCount; ++edge)
+  {
+    uint32_t from = Origin(edge);
+    uint32_t to = Target(edge);
+    uint32_t twin = c_none;
+    unsigned int opposite = 0;
+    unsigned int parallel = 0;
+    for (uint32_t i = first[to]; i < first[to + 1]; ++i)
+    {
+      if (Target(leaving[i]) == from)
+      {
+        twin = leaving[i];
+        ++opposite;
+      }
+    }
+    for (uint32_t i = first[from]; i < first[from + 1]; ++i)
+    {
+      parallel += Target(leaving[i]) == to;
+    }
+    if (opposite <= 1 && parallel == 1)
+    {
+      m_edges[edge].twin = twin;
+    }
+    else
+    {
+      m_flags[from] |= c_locked;
+      m_flags[to] |= c_locked;
+    }
+  }
+  for (uint32_t edge = 0; edge < edgeCount; ++edge)
+  {
+    if (m_edges[edge].twin != c_none && m_edges[m_edges[edge].twin].twin != edge)
+    {
+      m_edges[edge].twin = c_none;
+    }
+  }
+
+  // Vertices joining separate fans of triangles can't be walked around, so lock them too
+  m_outgoing.assign(vertexCount, c_none);
+  for (uint32_t vertex = 0; vertex < vertexCount; ++vertex)
+  {
+    if (first[vertex] == first[vertex + 1])
+    {
+      m_flags[vertex] |= c_removedVertex;
+      continue;
+    }
+    m_outgoing[vertex] = leaving[first[vertex]];
+    if (!(m_flags[vertex] & c_locked))
+    {
+      uint32_t fan = 0;
+      VisitOutgoing(vertex, [&fan](uint32_t) { ++fan; });
+      if (fan != first[vertex + 1] - first[vertex])
+      {
+        m_flags[vertex] |= c_locked;
+      }
+    }
+  }
+
+  // Vertices used by more than one block
+  {
+    std::vector<uint32_t> owner(vertexCount, c_none);
+    for (size_t i = 0; i + 1 < m_blocks.size(); ++i)
+    {
+      for (uint32_t edge = m_blocks[i] * 3; edge < m_blocks[i + 1] * 3; ++edge)
+      {
+        uint32_t &vertexOwner = owner[Origin(edge)];
+        if (vertexOwner != c_none && vertexOwner != i)
+        {
+          m_flags[Origin(edge)] |= c_seam;
+        }
+        vertexOwner = static_cast<uint32_t>(i);
+      }
+    }
+  }
+
+  // Each triangle's plane, weighted by its area, goes to its corners
+  for (uint32_t edge = 0; edge < edgeCount; edge += 3)
+  {
+    const ngl::Vec3 &p0 = m_vertices[Origin(edge)].position;
+    ngl::Vec3 normal = (m_vertices[Origin(edge + 1)].position - p0).cross(m_vertices[Origin(edge + 2)].position - p0);
+    float doubleArea = normal.length();
+    if (doubleArea <= 0.0f)
+    {
+      continue;
+    }
+    normal = normal / doubleArea;
+    Quadric plane = Quadric::Plane(normal, p0, doubleArea * 0.5f);
+    for (uint32_t corner = edge; corner < edge + 3; ++corner)
+    {
+      m_vertices[Origin(corner)].quadric += plane;
+      if (m_edges[corner].twin == c_none)
+      {
+        const ngl::Vec3 &from = m_vertices[Origin(corner)].position;
+        ngl::Vec3 along = m_vertices[Target(corner)].position - from;
+        ngl::Vec3 side = along.cross(normal);
+        float length = side.length();
+        if (length > 0.0f)
+        {
+          Quadric border = Quadric::Plane(side / length, from, c_boundaryWeight * along.lengthSquared());
+          m_vertices[Origin(corner)].quadric += border;
+          m_vertices[Target(corner)].quadric += border;
+        }
+      }
+    }
+  }
+
+}
+
+IndexedMesh Decimator::Compact(const std::vector<ngl::Vec3> &_normals) const
+{
+  // Surviving vertices keep their order, so the mesh keeps the marcher's locality
+  std::vector<uint32_t> remap(m_vertices.size(), c_none);
+  for (uint32_t edge = 0; edge < m_edges.size(); ++edge)
+  {
+    if (!Removed(edge))
+    {
+      remap[Origin(edge)] = 0;
+    }
+  }
+  IndexedMesh mesh;
+  float unscale = 1.0f / m_scale;
+  for (size_t vertex = 0; vertex < remap.size(); ++vertex)
+  {
+    if (remap[vertex] != c_none)
+    {
+      remap[vertex] = static_cast<uint32_t>(mesh.vertices.size());
+      mesh.vertices.push_back(m_vertices[vertex].position * unscale + m_minimum);
+      if (_normals.size() == m_vertices.size())
+      {
+        mesh.normals.push_back(_normals[vertex]);
+      }
+    }
+  }
+  for (uint32_t edge = 0; edge < m_edges.size(); ++edge)
+  {
+    if (!Removed(edge))
+    {
+      mesh.indices.push_back(remap[Origin(edge)]);
+    }
+  }
+  return mesh;
+}
+
+void Decimator::Clear()
+{
+  std::vector<HalfEdge>().swap(m_edges);
+  std::vector<Vertex>().swap(m_vertices);
+  std::vector<uint32_t>().swap(m_outgoing);
+  std::vector<uint8_t>().swap(m_flags);
+  std::vector<uint32_t>().swap(m_blocks);
+}
+
+float Decimator::CollapseCost(uint32_t _edge, ngl::Vec3 &_position) const
+{
+  const ngl::Vec3 &from = m_vertices[Origin(_edge)].position;
+  const ngl::Vec3 &to = m_vertices[Target(_edge)].position;
+  Quadric quadric = m_vertices[Origin(_edge)].quadric + m_vertices[Target(_edge)].quadric;
+  ngl::Vec3 middle = (from + to) * 0.5f;
+
+  // The least error point, unless it lies further from the edge than the edge is long
+  if (quadric.Minimum(_position) && (_position - middle).lengthSquared() <= (to - from).lengthSquared())
+  {
+    return quadric.Error(_position);
+  }
+  float best = quadric.Error(middle);
+  _position = middle;
+  for (const ngl::Vec3 &end : {from, to})
+  {
+    float error = quadric.Error(end);
+    if (error < best)
+    {
+      best = error;
+      _position = end;
+    }
+  }
+  return best;
+}
+
+bool Decimator::CanCollapse(uint32_t _edge, const ngl::Vec3 &_position, uint8_t _held, std::vector<uint32_t> &_rings) const
+{
+  uint32_t from = Origin(_edge);
+  uint32_t to = Target(_edge);
+  if ((m_flags[from] | m_flags[to]) & _held)
+  {
+    return false;
+  }
+  bool interior = m_edges[_edge].twin != c_none;
+
+  // Every triangle left around either end must keep facing the same way
+  bool folds = false;
+  auto visit = [&](uint32_t _end, uint32_t _other, uint32_t _corner)
+  {
+    uint32_t b = Target(_corner);
+    uint32_t c = Origin(Prev(_corner));
+    _rings.push_back(b);
+    _rings.push_back(c);
+    if (folds || b == _other || c == _other)
+    {
+      return;
+    }
+    const ngl::Vec3 &a = m_vertices[_end].position;
+    const ngl::Vec3 &pb = m_vertices[b].position;
+    const ngl::Vec3 &pc = m_vertices[c].position;
+    ngl::Vec3 before = (pb - a).cross(pc - a);
+    ngl::Vec3 after = (pb - _position).cross(pc - _position);
+    float afterLength = after.length();
+    folds = afterLength <= 0.0f || before.dot(after) < c_minNormalDot * before.length() * afterLength;
+  };
+  _rings.clear();
+  bool fromClosed = VisitOutgoing(from, [&](uint32_t _corner) { visit(from, to, _corner); });
+  if (folds)
+  {
+    return false;
+  }
+  auto middle = _rings.size();
+  bool toClosed = VisitOutgoing(to, [&](uint32_t _corner) { visit(to, from, _corner); });
+  if (folds)
+  {
+    return false;
+  }
+
+  // Link condition: the only vertices next to both ends may be the corners of the triangles being removed
+  std::sort(_rings.begin(), _rings.begin() + middle);
+  std::sort(_rings.begin() + middle, _rings.end());
+  auto fromEnd = std::unique(_rings.begin(), _rings.begin() + middle);
+  auto toEnd = std::unique(_rings.begin() + middle, _rings.end());
+  size_t fromNeighbours = fromEnd - _rings.begin();
+  size_t toNeighbours = toEnd - (_rings.begin() + middle);
+  size_t common = 0;
+  for (auto vertex = _rings.begin() + middle; vertex != toEnd; ++vertex)
+  {
+    common += *vertex != from && std::binary_search(_rings.begin(), fromEnd, *vertex);
+  }
+  if (common != (interior ? 2u : 1u))
+  {
+    return false;
+  }
+  // An inner edge joining two boundaries would pinch the surface into a bow tie,
+  // and one between two vertices of valence three would fold a tetrahedron flat
+  return !interior || ((fromClosed || toClosed) && (fromNeighbours > 3 || toNeighbours > 3));
+}
+
+std::array<uint32_t, 2> Decimator::CollapseEdge(uint32_t _edge, const ngl::Vec3 &_position)
+{
+  uint32_t from = Origin(_edge);
+  uint32_t to = Target(_edge);
+  uint32_t opposite = m_edges[_edge].twin;
+
+  // Walking only follows opposite links, so the origins can change as it goes
+  VisitOutgoing(to, [&](uint32_t _corner) { m_edges[_corner].origin = from; });
+
+  std::array<uint32_t, 2> joined = {RemoveTriangle(_edge), c_none};
+  if (opposite != c_none)
+  {
+    joined[1] = RemoveTriangle(opposite);
+  }
+  // Any half-edge left in place of a removed triangle's edges either leaves the merged vertex or ends there
+  m_flags[from] |= c_removedVertex;
+  for (uint32_t edge : joined)
+  {
+    if (edge != c_none)
+    {
+      m_outgoing[from] = Origin(edge) == from ? edge : Next(edge);
+      m_flags[from] &= ~c_removedVertex;
+    }
+  }
+  m_flags[to] |= c_removedVertex;
+  m_vertices[from].position = _position;
+  m_vertices[from].quadric += m_vertices[to].quadric;
+  return joined;
+}
+
+uint32_t Decimator::RemoveTriangle(uint32_t _edge)
+{
+  // The merged vertex starts the next edge, the triangle's third corner starts the previous one
+  uint32_t next = Next(_edge);
+  uint32_t prev = Prev(_edge);
+  uint32_t corner = Origin(prev);
+  uint32_t afterNext = m_edges[next].twin;
+  uint32_t afterPrev = m_edges[prev].twin;
+  if (afterNext != c_none)
+  {
+    m_edges[afterNext].twin = afterPrev;
+  }
+  if (afterPrev != c_none)
+  {
+    m_edges[afterPrev].twin = afterNext;
+  }
+  // afterNext leaves the third corner and afterPrev leaves the merged vertex
+  // A vertex shared with other blocks may be in their fans too, it is set again once they are done
+  if ((afterNext != c_none || afterPrev != c_none) && !(m_flags[corner] & c_seam))
+  {
+    m_outgoing[corner] = afterNext != c_none ? afterNext : Next(afterPrev);
+  }
+  for (uint32_t i : {_edge, next, prev})
+  {
+    m_edges[i].origin = c_none;
+    m_edges[i].twin = c_none;
+  }
+  return afterPrev != c_none ? afterPrev : afterNext;
+}
@@ -0,0 +1,453 @@
+///
+/// @file DicomSeries.cpp
+/// @brief Reading uncompressed DICOM series into a 16-bit volume
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <locale>
+#include <sstream>
+
+#include "DicomSeries.h"
+#include "MappedFile.h"
+
+namespace
+{
+  const uint32_t c_undefinedLength = 0xFFFFFFFF;
+  const std::string c_implicitLittleEndian = "1.2.840.10008.1.2";
+  const std::string c_explicitLittleEndian = "1.2.840.10008.1.2.1";
+
+  uint16_t ReadU16(const uint8_t *_data)
+  {
+    return static_cast<uint16_t>(_data[0] | (_data[1] << 8));
+  }
+
+  uint32_t ReadU32(const uint8_t *_data)
+  {
+    return static_cast<uint32_t>(_data[0]) | (static_cast<uint32_t>(_data[1]) << 8) |
+           (static_cast<uint32_t>(_data[2]) << 16) | (static_cast<uint32_t>(_data[3]) << 24);
+  }
+
+  // Explicit VRs that are followed by 2 reserved bytes and a 4 byte length
+  bool HasLongLength(const uint8_t *_vr)
+  {
+    static const char *longVRs[] = {"OB", "OD", "OF", "OL", "OV", "OW", "SQ", "SV", "UC", "UN", "UR", "UT", "UV"};
+    for (const char *vr : longVRs)
+    {
+      if (_vr[0] == vr[0] && _vr[1] == vr[1])
+      {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  std::string ReadString(const uint8_t *_data, size_t _length)
+  {
+    std::string value(reinterpret_cast<const char *>(_data), _length);
+    // Values are padded to an even length with a space or null
+    while (!value.empty() && (value.back() == ' ' || value.back() == '\0'))
+    {
+      value.pop_back();
+    }
+    return value;
+  }
+
+  // Decimal strings hold multiple values separated by backslashes
+  std::vector<double> ReadDecimals(const uint8_t *_data, size_t _length)
+  {
+    std::string text = ReadString(_data, _length);
+    std::replace(text.begin(), text.end(), '\\', ' ');
+    std::istringstream stream(text);
+    stream.imbue(std::locale::classic());
+    std::vector<double> values;
+    double value;
+    while (stream >> value)
+    {
+      values.push_back(value);
+    }
+    return values;
+  }
+}
+
+bool DicomSeries::IsDicomFile(const std::string &_path)
+{
+  std::string extension = std::filesystem::path(_path).extension().string();
+  std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char _c) { return std::tolower(_c); });
+  if (extension == ".dcm" || extension == ".dicom")
+  {
+    return true;
+  }
+
+  MappedFile file;
+  return file.Open(_path) && file.Size() >= 132 && std::memcmp(file.Data() + 128, "DICM", 4) == 0;
+}
+
+DicomSeries::Slice DicomSeries::ParseHeader(const std::string &_path)
+{
+  Slice slice;
+  slice.path = _path;
+
+  MappedFile file;
+  if (!file.Open(_path))
+  {
+    slice.error = "could not be opened.";
+    return slice;
+  }
+  const uint8_t *data = file.Data();
+  size_t size = file.Size();
+
+  // Files without a preamble are a bare implicit VR little endian data set
+  size_t pos = 0;
+  bool inMetaGroup = false;
+  if (size >= 132 && std::memcmp(data + 128, "DICM", 4) == 0)
+  {
+    pos = 132;
+    inMetaGroup = true;
+  }
+  std::string transferSyntax = c_implicitLittleEndian;
+  bool explicitVR = false;
+  // Tags nested inside sequences are ignored
+  int depth = 0;
+
+  while (pos + 8 <= size)
+  {
+    uint16_t group = ReadU16(data + pos);
+    uint16_t element = ReadU16(data + pos + 2);
+
+    // The meta group is always explicit VR little endian, the transfer syntax covers the rest
+    if (inMetaGroup && group != 0x0002)
+    {
+      inMetaGroup = false;
+      if (transferSyntax == c_explicitLittleEndian)
+      {
+        explicitVR = true;
+      }
+      else if (transferSyntax != c_implicitLittleEndian)
+      {
+        slice.error = "uses an unsupported (compressed or big endian) transfer syntax: " + transferSyntax;
+        return slice;
+      }
+    }
+
+    uint32_t length;
+    if (group == 0xFFFE)
+    {
+      // Item and delimitation tags never have a VR
+      length = ReadU32(data + pos + 4);
+      pos += 8;
+    }
+    else if (inMetaGroup || explicitVR)
+    {
+      if (HasLongLength(data + pos + 4))
+      {
+        if (pos + 12 > size)
+        {
+          break;
+        }
+        length = ReadU32(data + pos + 8);
+        pos += 12;
+      }
+      else
+      {
+        length = ReadU16(data + pos + 6);
+        pos += 8;
+      }
+    }
+    else
+    {
+      length = ReadU32(data + pos + 4);
+      pos += 8;
+    }
+
+    if (group == 0xFFFE)
+    {
+      // Skip whole items of known length, walk into items of undefined length
+      if (element == 0xE000 && length != c_undefinedLength)
+      {
+        pos += length;
+      }
+      else if (element == 0xE0DD)
+      {
+        depth = std::max(0, depth - 1);
+      }
+      continue;
+    }
+
+    if (length == c_undefinedLength)
+    {
+      if (group == 0x7FE0 && element == 0x0010 && depth == 0)
+      {
+        slice.error = "has compressed pixel data, which is not supported.";
+        return slice;
+      }
+      // A sequence of undefined length, closed by a sequence delimitation item
+      ++depth;
+      continue;
+    }
+
+    if (pos + length > size)
+    {
+      slice.error = "is truncated.";
+      return slice;
+    }
+
+    const uint8_t *value = data + pos;
+    if (depth == 0)
+    {
+      switch ((static_cast<uint32_t>(group) << 16) | element)
+      {
+        case 0x00020010:
+        {
+          transferSyntax = ReadString(value, length);
+          break;
+        }
+
+        case 0x00200013:
+        {
+          slice.instanceNumber = std::atoi(ReadString(value, length).c_str());
+          break;
+        }
+
+        case 0x00280002:
+        {
+          slice.samplesPerPixel = ReadU16(value);
+          break;
+        }
+
+        case 0x00280010:
+        {
+          slice.rows = ReadU16(value);
+          break;
+        }
+
+        case 0x00280011:
+        {
+          slice.columns = ReadU16(value);
+          break;
+        }
+
+        case 0x00280100:
+        {
+          slice.bitsAllocated = ReadU16(value);
+          break;
+        }
+
+        case 0x00280103:
+        {
+          slice.isSigned = ReadU16(value) == 1;
+          break;
+        }
+
+        case 0x00200032:
+        {
+          std::vector<double> position = ReadDecimals(value, length);
+          if (position.size() == 3)
+          {
+            std::copy(position.begin(), position.end(), slice.position);
+            slice.hasPosition = true;
+          }
+          break;
+        }
+
+        case 0x00200037:
+        {
+          std::vector<double> orientation = ReadDecimals(value, length);
+          if (orientation.size() == 6)
+          {
+            std::copy(orientation.begin(), orientation.end(), slice.orientation);
+          }
+          break;
+        }
+
+        case 0x00281052:
+        {
+          std::vector<double> intercept = ReadDecimals(value, length);
+          slice.intercept = intercept.empty() ? 0.0 : intercept[0];
+          break;
+        }
+
+        case 0x00281053:
+        {
+          std::vector<double> slope = ReadDecimals(value, length);
+          slice.slope = slope.empty() ? 1.0 : slope[0];
+          break;
+        }
+
+        case 0x7FE00010:
+        {
+          slice.pixelOffset = pos;
+          slice.pixelLength = length;
+
+          if (slice.rows == 0 || slice.columns == 0)
+          {
+            slice.error = "has no image dimensions.";
+          }
+          else if (slice.samplesPerPixel != 1)
+          {
+            slice.error = "is not a greyscale image.";
+          }
+          else if (slice.bitsAllocated != 8 && slice.bitsAllocated != 16)
+          {
+            slice.error = "must have 8 or 16 bits allocated per pixel.";
+          }
+          else if (slice.pixelLength < static_cast<size_t>(slice.rows) * slice.columns * (slice.bitsAllocated / 8))
+          {
+            slice.error = "has less pixel data than its dimensions describe.";
+          }
+          return slice;
+        }
+
+        default:
+        {
+          break;
+        }
+      }
+    }
+    pos += length;
+  }
+
+  slice.error = "has no pixel data.";
+  return slice;
+}
+
+bool DicomSeries::ReadHeaders(const std::vector<std::string> &_files, ThreadPool &_pool)
+{
+  Clear();
+
+  std::vector<Slice> slices(_files.size());
+  _pool.ParallelFor(_files.size(), [&](size_t _file, unsigned int)
+  {
+    slices[_file] = ParseHeader(_files[_file]);
+  });
+
+  for (const Slice &slice : slices)
+  {
+    if (!slice.error.empty())
+    {
+      m_error = slice.path + " " + slice.error;
+      return false;
+    }
+    if (slice.columns != slices[0].columns || slice.rows != slices[0].rows)
+    {
+      m_error = slice.path + " has different dimensions!";
+      return false;
+    }
+  }
+  if (slices.empty())
+  {
+    m_error = "No DICOM files to read.";
+    return false;
+  }
+
+  // Order slices by their distance along the normal of the image plane
+  bool positioned = std::all_of(slices.begin(), slices.end(), [](const Slice &_slice) { return _slice.hasPosition; });
+  if (positioned)
+  {
+    const double *o = slices[0].orientation;
+    const double normal[3] = {o[1] * o[5] - o[2] * o[4], o[2] * o[3] - o[0] * o[5], o[0] * o[4] - o[1] * o[3]};
+    auto distance = [&normal](const Slice &_slice)
+    {
+      return _slice.position[0] * normal[0] + _slice.position[1] * normal[1] + _slice.position[2] * normal[2];
+    };
+    std::stable_sort(slices.begin(), slices.end(), [&](const Slice &_a, const Slice &_b) { return distance(_a) < distance(_b); });
+  }
+  else
+  {
+    std::stable_sort(slices.begin(), slices.end(), [](const Slice &_a, const Slice &_b) { return _a.instanceNumber < _b.instanceNumber; });
+  }
+
+  m_slices = std::move(slices);
+  m_width = m_slices[0].columns;
+  m_height = m_slices[0].rows;
+  return true;
+}
+
+bool DicomSeries::LoadVoxels(ThreadPool &_pool, unsigned int _sliceStep)
+{
+  size_t layers = (m_slices.size() + _sliceStep - 1) / _sliceStep;
+  m_volume.Resize(m_width, m_height, layers);
+
+  std::vector<char> loaded(layers, 0);
+  _pool.ParallelFor(layers, [&](size_t _layer, unsigned int)
+  {
+    loaded[_layer] = LoadSlice(m_slices[_layer * _sliceStep], m_volume.Slice(_layer));
+  });
+
+  for (size_t i = 0; i < layers; ++i)
+  {
+    if (!loaded[i])
+    {
+      m_error = m_slices[i * _sliceStep].path + " could not be loaded.";
+      m_volume.Clear();
+      return false;
+    }
+  }
+  return true;
+}
+
+bool DicomSeries::LoadSlice(const Slice &_slice, int16_t *_voxels) const
+{
+  MappedFile file;
+  if (!file.Open(_slice.path) || _slice.pixelOffset + _slice.pixelLength > file.Size())
+  {
+    return false;
+  }
+
+  const uint8_t *pixels = file.Data() + _slice.pixelOffset;
+  size_t count = static_cast<size_t>(_slice.rows) * _slice.columns;
+  auto stored = [&](size_t _i) -> int
+  {
+    if (_slice.bitsAllocated == 16)
+    {
+      uint16_t raw = ReadU16(pixels + _i * 2);
+      return _slice.isSigned ? static_cast<int16_t>(raw) : raw;
+    }
+    return _slice.isSigned ? static_cast<int8_t>(pixels[_i]) : pixels[_i];
+  };
+  auto clamp = [](double _value)
+  {
+    return static_cast<int16_t>(std::clamp(_value, static_cast<double>(std::numeric_limits<int16_t>::min()),
+                                                   static_cast<double>(std::numeric_limits<int16_t>::max())));
+  };
+
+  // Integer rescales (nearly all CT) avoid floating point per voxel
+  if (_slice.slope == 1.0 && _slice.intercept == std::floor(_slice.intercept))
+  {
+    int intercept = static_cast<int>(_slice.intercept);
+    for (size_t i = 0; i < count; ++i)
+    {
+      _voxels[i] = clamp(stored(i) + intercept);
+    }
+  }
+  else
+  {
+    for (size_t i = 0; i < count; ++i)
+    {
+      _voxels[i] = clamp(std::round(stored(i) * _slice.slope + _slice.intercept));
+    }
+  }
+  return true;
+}
+
+std::vector<std::string> DicomSeries::GetSlicePaths() const
+{
+  std::vector<std::string> paths;
+  for (const Slice &slice : m_slices)
+  {
+    paths.push_back(slice.path);
+  }
+  return paths;
+}
+
+void DicomSeries::Clear()
+{
+  m_slices.clear();
+  m_width = 0;
+  m_height = 0;
+  m_volume.Clear();
+  m_error.clear();
+}
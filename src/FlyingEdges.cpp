@@ -0,0 +1,483 @@
+///
+/// @file FlyingEdges.cpp
+/// @brief Flying Edges engine of Mesh, after Schroeder, Maynard and Geveci (2015)
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <variant>
+
+#include "Mesh.h"
+
+namespace
+{
+  constexpr uint64_t c_lowBits = 0x0101010101010101ull;
+
+  // Eight edge cases as one word, the tests on words do not depend on byte order
+  uint64_t LoadCases(const uint8_t *_cases)
+  {
+    uint64_t word;
+    std::memcpy(&word, _cases, sizeof(word));
+    return word;
+  }
+
+  // Low bit of each byte set where the edge crosses the surface (cases 1 and 2)
+  uint64_t CrossedEdges(uint64_t _cases)
+  {
+    return (_cases ^ (_cases >> 1)) & c_lowBits;
+  }
+
+  // Sum of a word's bytes when each is 0 or 1
+  size_t SumBytes(uint64_t _bits)
+  {
+    return static_cast<size_t>((_bits * c_lowBits) >> 56);
+  }
+
+  // Whether the eight cubes from _x between four rows of cases all have every corner alike
+  bool UniformCubes(const uint8_t *const _cases[4], unsigned int _x)
+  {
+    uint64_t first = LoadCases(_cases[0] + _x);
+    uint64_t differ = (first ^ LoadCases(_cases[1] + _x)) | (first ^ LoadCases(_cases[2] + _x)) | (first ^ LoadCases(_cases[3] + _x));
+    return differ == 0 && CrossedEdges(first) == 0;
+  }
+
+  // Whether point _x differs between two rows of edge cases, _last being the final point of a row
+  bool PointsDiffer(const uint8_t *_casesA, const uint8_t *_casesB, unsigned int _x, unsigned int _last)
+  {
+    return _x < _last ? ((_casesA[_x] ^ _casesB[_x]) & 1) : ((_casesA[_x - 1] ^ _casesB[_x - 1]) >> 1);
+  }
+
+  // Call _visit(x) in order for each point in [_trim.first, _trim.second] that differs between two rows
+  template <typename Visit>
+  void VisitDiffering(const uint8_t *_casesA, const uint8_t *_casesB, std::pair<unsigned int, unsigned int> _trim, unsigned int _last, Visit &&_visit)
+  {
+    if (_trim.first >= _trim.second)
+    {
+      return;
+    }
+    for (unsigned int block = _trim.first; block < _trim.second; block += 8)
+    {
+      if (block + 8 <= _trim.second && ((LoadCases(_casesA + block) ^ LoadCases(_casesB + block)) & c_lowBits) == 0)
+      {
+        continue;
+      }
+      for (unsigned int x = block; x < std::min(block + 8, _trim.second); ++x)
+      {
+        if ((_casesA[x] ^ _casesB[x]) & 1)
+        {
+          _visit(x);
+        }
+      }
+    }
+    if (PointsDiffer(_casesA, _casesB, _trim.second, _last))
+    {
+      _visit(_trim.second);
+    }
+  }
+
+  // Number of points VisitDiffering() would visit
+  size_t CountDiffering(const uint8_t *_casesA, const uint8_t *_casesB, std::pair<unsigned int, unsigned int> _trim, unsigned int _last)
+  {
+    if (_trim.first >= _trim.second)
+    {
+      return 0;
+    }
+    size_t count = PointsDiffer(_casesA, _casesB, _trim.second, _last);
+    unsigned int x = _trim.first;
+    for (; x + 8 <= _trim.second; x += 8)
+    {
+      count += SumBytes((LoadCases(_casesA + x) ^ LoadCases(_casesB + x)) & c_lowBits);
+    }
+    for (; x < _trim.second; ++x)
+    {
+      count += (_casesA[x] ^ _casesB[x]) & 1;
+    }
+    return count;
+  }
+}
+
+// Flying Edges works along rows of points (fixed y and z) rather than cube by cube
+//   1. Classify every x edge of every row, noting the first and last edge the surface crosses
+//   2. Count the crossed x, y and z edges each row owns and the triangles of the cubes it starts,
+//      only looking between the trimmed ends of the rows involved
+//   3. Prefix sum the counts, so each row knows where its vertices and triangles go
+//   4. Write every row's vertices and triangles straight into the final buffers
+// Voxels are only read by the first pass and each edge is tested once, after which the passes
+// only look at the edge cases. Rows are independent within a pass, so each pass runs in parallel
+
+void Mesh::MarchFlyingEdges(IndexedMesh &_mesh)
+{
+  _mesh.vertices.clear();
+  _mesh.normals.clear();
+  _mesh.indices.clear();
+  if (m_pointsPerRow < 2 || m_columns < 2 || m_layers < 2)
+  {
+    return;
+  }
+
+  size_t rows = static_cast<size_t>(m_columns) * m_layers;
+  m_edgeRows.assign(rows, EdgeRow());
+  m_edgeCases.resize(rows * (m_pointsPerRow - 1));
+
+  // Pass 1
+  if (m_bricks != nullptr)
+  {
+    std::vector<Volume<uint8_t>> scratch(m_pool.GetThreadCount());
+    m_pool.ParallelFor(m_layers, [&](size_t _z, unsigned int _worker)
+    {
+      Volume<uint8_t> &layer = scratch[_worker];
+      if (layer.Empty())
+      {
+        layer.Resize(m_pointsPerRow, m_columns, 1);
+      }
+      m_bricks->CopyLayer(_z, layer.Slice(0));
+      ClassifyEdgeRows(layer.View(), static_cast<unsigned int>(_z));
+    });
+  }
+  else
+  {
+    std::visit([this](const auto &_view)
+    {
+      m_pool.ParallelFor(m_layers, [&](size_t _z, unsigned int)
+      {
+        ClassifyEdgeRows(_view.Layer(_z), static_cast<unsigned int>(_z));
+      });
+    }, m_pointData);
+  }
+
+  // Pass 2, a layer's cubes also need the edge cases of the layer above, so this waits for all of pass 1
+  m_pool.ParallelFor(m_layers, [&](size_t _z, unsigned int)
+  {
+    for (unsigned int y = 0; y < m_columns; ++y)
+    {
+      CountEdgeRow(_z * m_columns + y, y, static_cast<unsigned int>(_z));
+    }
+  });
+
+  // Pass 3
+  size_t vertexCount = 0;
+  size_t triangleCount = 0;
+  for (EdgeRow &row : m_edgeRows)
+  {
+    row.firstVertex = vertexCount;
+    row.firstTriangle = triangleCount;
+    vertexCount += row.xEdges + row.yEdges + row.zEdges;
+    triangleCount += row.triangles;
+  }
+
+  // Pass 4
+  _mesh.vertices.resize(vertexCount);
+  _mesh.normals.resize(m_gradientNormals ? vertexCount : 0);
+  _mesh.indices.resize(triangleCount * 3);
+  // Gradient normals read the layer either side of each layer's edges, dense data is read in place
+  // and bricks are unpacked a few layers at a time as in pass 1
+  if (m_bricks != nullptr)
+  {
+    std::vector<Volume<uint8_t>> scratch(m_pool.GetThreadCount());
+    m_pool.ParallelFor(m_layers, [&](size_t _z, unsigned int _worker)
+    {
+      unsigned int z = static_cast<unsigned int>(_z);
+      unsigned int first = m_gradientNormals && z > 0 ? z - 1 : z;
+      unsigned int last = m_gradientNormals ? std::min(z + 2, m_layers - 1) : z;
+      Volume<uint8_t> &layers = scratch[_worker];
+      if (m_gradientNormals)
+      {
+        if (layers.Empty())
+        {
+          layers.Resize(m_pointsPerRow, m_columns, 4);
+        }
+        for (unsigned int layer = first; layer <= last; ++layer)
+        {
+          m_bricks->CopyLayer(layer, layers.Slice(layer - first));
+        }
+      }
+      VolumeWindow<uint8_t> window{layers.View(), 0, 0, first};
+      for (unsigned int y = 0; y < m_columns; ++y)
+      {
+        GenerateEdgeRow(window, _z * m_columns + y, y, z, _mesh);
+      }
+    });
+  }
+  else
+  {
+    std::visit([&](const auto &_view)
+    {
+      m_pool.ParallelFor(m_layers, [&](size_t _z, unsigned int)
+      {
+        for (unsigned int y = 0; y < m_columns; ++y)
+        {
+          GenerateEdgeRow(_view, _z * m_columns + y, y, static_cast<unsigned int>(_z), _mesh);
+        }
+      });
+    }, m_pointData);
+  }
+}
+
+template <typename T>
+void Mesh::ClassifyEdgeRows(const VolumeView<T> &_layer, unsigned int _z)
+{
+  // Held locally, as writes through the uint8_t cases could otherwise alias any member
+  const int level = m_surfaceLevel;
+  const unsigned int edges = m_pointsPerRow - 1;
+  for (unsigned int y = 0; y < m_columns; ++y)
+  {
+    size_t r = static_cast<size_t>(_z) * m_columns + y;
+    uint8_t *cases = &m_edgeCases[r * edges];
+
+    if (_layer.GetStrideX() == 1)
+    {
+      // Contiguous rows classify without branches, which the compiler can vectorise
+      const T *points = _layer.Slice(0) + y * _layer.GetStrideY();
+      for (unsigned int x = 0; x < edges; ++x)
+      {
+        cases[x] = static_cast<uint8_t>((points[x] >= level) | (points[x + 1] >= level) << 1);
+      }
+    }
+    else
+    {
+      for (unsigned int x = 0; x < edges; ++x)
+      {
+        cases[x] = static_cast<uint8_t>((_layer.At(x, y, 0) >= level) | (_layer.At(x + 1, y, 0) >= level) << 1);
+      }
+    }
+
+    // Cases 1 and 2 cross the surface
+    size_t crossed = 0;
+    unsigned int x = 0;
+    for (; x + 8 <= edges; x += 8)
+    {
+      crossed += SumBytes(CrossedEdges(LoadCases(cases + x)));
+    }
+    for (; x < edges; ++x)
+    {
+      crossed += (cases[x] ^ (cases[x] >> 1)) & 1;
+    }
+    unsigned int first = edges;
+    unsigned int last = 0;
+    if (crossed > 0)
+    {
+      first = 0;
+      while (cases[first] == 0 || cases[first] == 3)
+      {
+        ++first;
+      }
+      last = edges;
+      while (cases[last - 1] == 0 || cases[last - 1] == 3)
+      {
+        --last;
+      }
+    }
+    EdgeRow &row = m_edgeRows[r];
+    row.xEdges = crossed;
+    row.xMin = first;
+    row.xMax = last;
+  }
+}
+
+bool Mesh::EdgeRowInside(size_t _row, unsigned int _x) const
+{
+  const uint8_t *cases = &m_edgeCases[_row * (m_pointsPerRow - 1)];
+  return _x + 1 < m_pointsPerRow ? (cases[_x] & 1) : (cases[_x - 1] >> 1);
+}
+
+template <size_t N>
+std::pair<unsigned int, unsigned int> Mesh::TrimEdgeRows(const std::array<size_t, N> &_rows) const
+{
+  unsigned int left = m_pointsPerRow - 1;
+  unsigned int right = 0;
+  for (size_t r : _rows)
+  {
+    left = std::min(left, m_edgeRows[r].xMin);
+    right = std::max(right, m_edgeRows[r].xMax);
+  }
+
+  // Beyond the trimmed ends each row holds one value, the surface still passes between rows that disagree
+  auto disagree = [&](unsigned int _x)
+  {
+    bool first = EdgeRowInside(_rows[0], _x);
+    for (size_t i = 1; i < N; ++i)
+    {
+      if (EdgeRowInside(_rows[i], _x) != first)
+      {
+        return true;
+      }
+    }
+    return false;
+  };
+  if (left > 0 && disagree(left))
+  {
+    left = 0;
+  }
+  if (right < m_pointsPerRow - 1 && disagree(right))
+  {
+    right = m_pointsPerRow - 1;
+  }
+  return std::make_pair(left, right);
+}
+
+void Mesh::CountEdgeRow(size_t _row, unsigned int _y, unsigned int _z)
+{
+  EdgeRow &row = m_edgeRows[_row];
+  const uint8_t *rowCases = &m_edgeCases[_row * (m_pointsPerRow - 1)];
+  size_t layerCases = static_cast<size_t>(m_columns) * (m_pointsPerRow - 1);
+  if (_y + 1 < m_columns)
+  {
+    std::pair<unsigned int, unsigned int> trim = TrimEdgeRows(std::array<size_t, 2>{_row, _row + 1});
+    row.yEdges = CountDiffering(rowCases, rowCases + m_pointsPerRow - 1, trim, m_pointsPerRow - 1);
+  }
+  if (_z + 1 < m_layers)
+  {
+    std::pair<unsigned int, unsigned int> trim = TrimEdgeRows(std::array<size_t, 2>{_row, _row + m_columns});
+    row.zEdges = CountDiffering(rowCases, rowCases + layerCases, trim, m_pointsPerRow - 1);
+  }
+  if (_y + 1 < m_columns && _z + 1 < m_layers)
+  {
+    std::array<size_t, 4> cube = {_row, _row + 1, _row + m_columns, _row + m_columns + 1};
+    std::pair<unsigned int, unsigned int> trim = TrimEdgeRows(cube);
+    const uint8_t *cases[4];
+    for (size_t i = 0; i < 4; ++i)
+    {
+      cases[i] = &m_edgeCases[cube[i] * (m_pointsPerRow - 1)];
+    }
+    size_t triangles = 0;
+    for (unsigned int block = trim.first; block < trim.second; block += 8)
+    {
+      // Eight cubes with every corner alike have no triangles
+      if (block + 8 <= trim.second && UniformCubes(cases, block))
+      {
+        continue;
+      }
+      for (unsigned int x = block; x < std::min(block + 8, trim.second); ++x)
+      {
+        // Bourke's corner order, see ClassifySlab() in Mesh.cpp
+        unsigned int cubeIndex = cases[0][x] | (cases[1][x] >> 1) << 2 | (cases[1][x] & 1) << 3
+                               | cases[2][x] << 4 | (cases[3][x] >> 1) << 6 | (cases[3][x] & 1) << 7;
+        triangles += Table::TriangleCount(cubeIndex);
+      }
+    }
+    row.triangles = triangles;
+  }
+}
+
+template <typename Source>
+void Mesh::GenerateEdgeRow(const Source &_source, size_t _row, unsigned int _y, unsigned int _z, IndexedMesh &_mesh) const
+{
+  const EdgeRow &row = m_edgeRows[_row];
+  const uint8_t *rowCases = &m_edgeCases[_row * (m_pointsPerRow - 1)];
+  size_t layerCases = static_cast<size_t>(m_columns) * (m_pointsPerRow - 1);
+
+  // Vertices, x edges then y edges then z edges, each in x order
+  ngl::Vec3 *vertex = _mesh.vertices.data() + row.firstVertex;
+  ngl::Vec3 *normal = m_gradientNormals ? _mesh.normals.data() + row.firstVertex : nullptr;
+  std::array<unsigned int, 3> last = {m_pointsPerRow - 1, m_columns - 1, m_layers - 1};
+  // Edges 0, 3 and 8 run from point (_x, _y, _z) along x, y and z
+  auto emit = [&](unsigned int _x, unsigned int _edge)
+  {
+    *vertex++ = EdgeVertex(_x, _y, _z, _edge);
+    if (normal != nullptr)
+    {
+      std::array<unsigned int, 3> a = {_x, _y, _z};
+      std::array<unsigned int, 3> b = a;
+      ++b[_edge == 0 ? 0 : _edge == 3 ? 1 : 2];
+      *normal++ = CrossingNormal(_source, a, b, last, m_surfaceLevel);
+    }
+  };
+  for (unsigned int block = row.xMin; block < row.xMax; block += 8)
+  {
+    if (block + 8 <= row.xMax && CrossedEdges(LoadCases(rowCases + block)) == 0)
+    {
+      continue;
+    }
+    for (unsigned int x = block; x < std::min(block + 8, row.xMax); ++x)
+    {
+      if (rowCases[x] == 1 || rowCases[x] == 2)
+      {
+        emit(x, 0);
+      }
+    }
+  }
+  if (_y + 1 < m_columns)
+  {
+    std::pair<unsigned int, unsigned int> trim = TrimEdgeRows(std::array<size_t, 2>{_row, _row + 1});
+    VisitDiffering(rowCases, rowCases + m_pointsPerRow - 1, trim, m_pointsPerRow - 1, [&](unsigned int _x)
+    {
+      emit(_x, 3);
+    });
+  }
+  if (_z + 1 < m_layers)
+  {
+    std::pair<unsigned int, unsigned int> trim = TrimEdgeRows(std::array<size_t, 2>{_row, _row + m_columns});
+    VisitDiffering(rowCases, rowCases + layerCases, trim, m_pointsPerRow - 1, [&](unsigned int _x)
+    {
+      emit(_x, 8);
+    });
+  }
+  if (row.triangles == 0)
+  {
+    return;
+  }
+
+  // Triangles, the four rows around the cubes are swept together
+  // The next vertex along each of their edges is counted as the sweep goes, nothing crosses before the trim
+  std::array<size_t, 4> cube = {_row, _row + 1, _row + m_columns, _row + m_columns + 1};
+  const uint8_t *cases[4];
+  size_t xIds[4];
+  for (size_t i = 0; i < 4; ++i)
+  {
+    cases[i] = &m_edgeCases[cube[i] * (m_pointsPerRow - 1)];
+    xIds[i] = m_edgeRows[cube[i]].firstVertex;
+  }
+  // y edges of the bottom (z) and top (z + 1) rows, z edges of the near (y) and far (y + 1) rows
+  size_t yIds[2] = {m_edgeRows[cube[0]].firstVertex + m_edgeRows[cube[0]].xEdges,
+                    m_edgeRows[cube[2]].firstVertex + m_edgeRows[cube[2]].xEdges};
+  size_t zIds[2] = {m_edgeRows[cube[0]].firstVertex + m_edgeRows[cube[0]].xEdges + m_edgeRows[cube[0]].yEdges,
+                    m_edgeRows[cube[1]].firstVertex + m_edgeRows[cube[1]].xEdges + m_edgeRows[cube[1]].yEdges};
+
+  uint32_t *index = _mesh.indices.data() + row.firstTriangle * 3;
+  std::pair<unsigned int, unsigned int> trim = TrimEdgeRows(cube);
+  for (unsigned int block = trim.first; block < trim.second; block += 8)
+  {
+    if (block + 8 <= trim.second && UniformCubes(cases, block))
+    {
+      continue;
+    }
+    for (unsigned int x = block; x < std::min(block + 8, trim.second); ++x)
+    {
+      unsigned int cubeIndex = cases[0][x] | (cases[1][x] >> 1) << 2 | (cases[1][x] & 1) << 3
+                             | cases[2][x] << 4 | (cases[3][x] >> 1) << 6 | (cases[3][x] & 1) << 7;
+      // All corners alike, so none of the cube's edges are crossed and no count moves on
+      if (cubeIndex == 0 || cubeIndex == 255)
+      {
+        continue;
+      }
+      // Whether the y and z edges at point x are crossed
+      unsigned int yCross[2] = {static_cast<unsigned int>((cases[0][x] ^ cases[1][x]) & 1),
+                                static_cast<unsigned int>((cases[2][x] ^ cases[3][x]) & 1)};
+      unsigned int zCross[2] = {static_cast<unsigned int>((cases[0][x] ^ cases[2][x]) & 1),
+                                static_cast<unsigned int>((cases[1][x] ^ cases[3][x]) & 1)};
+
+      unsigned int triangles = Table::TriangleCount(cubeIndex);
+      if (triangles > 0)
+      {
+        // Vertex on each of Bourke's edges, those at x + 1 being the next along their row
+        size_t ids[12] = {xIds[0], yIds[0] + yCross[0], xIds[1], yIds[0],
+                          xIds[2], yIds[1] + yCross[1], xIds[3], yIds[1],
+                          zIds[0], zIds[0] + zCross[0], zIds[1] + zCross[1], zIds[1]};
+        const std::array<int8_t, 16> &edges = Table::Edges(cubeIndex);
+        for (unsigned int i = 0; i < triangles * 3; ++i)
+        {
+          *index++ = static_cast<uint32_t>(ids[edges[i]]);
+        }
+      }
+
+      for (size_t i = 0; i < 4; ++i)
+      {
+        xIds[i] += cases[i][x] == 1 || cases[i][x] == 2;
+      }
+      yIds[0] += yCross[0];
+      yIds[1] += yCross[1];
+      zIds[0] += zCross[0];
+      zIds[1] += zCross[1];
+    }
+  }
+}
@@ -2,15 +2,86 @@
 /// @file ImageStack.cpp
 /// @brief Reading in and checking image data
 
-#include <QColor>
 #include <QImage>
+#include <QImageReader>
 
 #include <algorithm>
+#include <cmath>
 #include <filesystem>
 #include <iostream>
+#include <limits>
 
 #include "ImageStack.h"
 
+namespace
+{
+  // Tightest box around every voxel at or above _threshold, plus a one voxel border so
+  // cubes straddling the surface are kept, empty if no voxel reaches _threshold
+  template <typename T>
+  VoxelBox BoundingBox(const VolumeView<T> &_view, int _threshold, ThreadPool &_pool)
+  {
+    struct Extent
+    {
+      size_t x0 = std::numeric_limits<size_t>::max();
+      size_t y0 = std::numeric_limits<size_t>::max();
+      size_t x1 = 0;
+      size_t y1 = 0;
+      bool found = false;
+    };
+
+    // One extent per layer, so workers never share one
+    std::vector<Extent> extents(_view.GetDepth());
+    _pool.ParallelFor(_view.GetDepth(), [&](size_t _z, unsigned int)
+    {
+      Extent &extent = extents[_z];
+      for (size_t y = 0; y < _view.GetHeight(); ++y)
+      {
+        for (size_t x = 0; x < _view.GetWidth(); ++x)
+        {
+          if (_view.At(x, y, _z) >= _threshold)
+          {
+            extent.x0 = std::min(extent.x0, x);
+            extent.x1 = std::max(extent.x1, x);
+            extent.y0 = std::min(extent.y0, y);
+            extent.y1 = std::max(extent.y1, y);
+            extent.found = true;
+          }
+        }
+      }
+    });
+
+    Extent total;
+    size_t z0 = std::numeric_limits<size_t>::max();
+    size_t z1 = 0;
+    for (size_t z = 0; z < extents.size(); ++z)
+    {
+      if (extents[z].found)
+      {
+        total.x0 = std::min(total.x0, extents[z].x0);
+        total.x1 = std::max(total.x1, extents[z].x1);
+        total.y0 = std::min(total.y0, extents[z].y0);
+        total.y1 = std::max(total.y1, extents[z].y1);
+        z0 = std::min(z0, z);
+        z1 = z;
+        total.found = true;
+      }
+    }
+    if (!total.found)
+    {
+      return VoxelBox();
+    }
+
+    VoxelBox box;
+    box.x = total.x0 > 0 ? total.x0 - 1 : 0;
+    box.y = total.y0 > 0 ? total.y0 - 1 : 0;
+    box.z = z0 > 0 ? z0 - 1 : 0;
+    box.width = std::min(total.x1 + 2, _view.GetWidth()) - box.x;
+    box.height = std::min(total.y1 + 2, _view.GetHeight()) - box.y;
+    box.depth = std::min(z1 + 2, _view.GetDepth()) - box.z;
+    return box;
+  }
+}
+
 void ImageStack::ReadImages(const std::string _imageDirectory)
 {
   // The following function is adapted from:
@@ -21,6 +92,16 @@ void ImageStack::ReadImages(const std::string _imageDirectory)
   std::cout << "Reading images...\n";
   // Clear previous data
   m_images.clear();
+  m_imageDirectory = _imageDirectory;
+  m_pyramid.Clear();
+  m_bricks.Clear();
+  m_cache.Close();
+  m_rawVolume.Close();
+  m_dicom.Clear();
+  m_dicomSeries = false;
+  m_oiio.Clear();
+  m_oiioSeries = false;
+  m_crop = VoxelBox();
   m_directoryChecked = false;
   m_correctDimensions = false;
   m_checkedDimensions = false;
@@ -36,7 +117,28 @@ void ImageStack::ReadImages(const std::string _imageDirectory)
   }
   else
   {
-    if (std::filesystem::is_directory(directoryPath))
+    if (RawVolume::IsVolumeFile(_imageDirectory) && std::filesystem::is_regular_file(directoryPath))
+    {
+      // Voxels stay on disk until the march touches them
+      if (m_rawVolume.Open(_imageDirectory))
+      {
+        std::cout << "Volume found!" << "\n";
+        m_directoryChecked = true;
+      }
+      else
+      {
+        ErrorMessage("VOLUME ERROR", m_rawVolume.GetError());
+      }
+    }
+    else if (OiioStack::IsOiioFile(_imageDirectory) && std::filesystem::is_regular_file(directoryPath))
+    {
+      // A single multi-page file, each page is a slice
+      std::cout << "Image stack found!" << "\n";
+      m_images.push_back(_imageDirectory);
+      m_oiioSeries = true;
+      m_directoryChecked = true;
+    }
+    else if (std::filesystem::is_directory(directoryPath))
     {
       std::cout << "Directory found!" << "\n";
 
@@ -67,9 +169,16 @@ void ImageStack::ReadImages(const std::string _imageDirectory)
         m_output = _imageDirectory + " is empty!";
         ErrorMessage("DIRECTORY ERROR", m_output);
       }
-      else if (m_images.size() > 1)
+      // A lone multi-page TIFF can still hold a whole stack
+      else if (m_images.size() > 1 || OiioStack::IsOiioFile(m_images[0]))
       {
         m_directoryChecked = true;
+        m_dicomSeries = DicomSeries::IsDicomFile(m_images[0]);
+        m_oiioSeries = !m_dicomSeries && OiioStack::IsOiioFile(m_images[0]);
+        if (m_dicomSeries)
+        {
+          std::cout << "DICOM series found!" << "\n";
+        }
       }
       else
       {
@@ -91,27 +200,97 @@ void ImageStack::CheckDimensions()
   // Clear previous data
   m_imageWidth = 0;
   m_imageHeight = 0;
+  m_imageDepth = 0;
   
-  if (m_directoryChecked)
+  if (m_directoryChecked && m_rawVolume.IsOpen())
+  {
+    // Dimensions come from the volume header
+    m_directoryChecked = false;
+    m_imageWidth = static_cast<unsigned int>(m_rawVolume.GetWidth());
+    m_imageHeight = static_cast<unsigned int>(m_rawVolume.GetHeight());
+    m_imageDepth = static_cast<unsigned int>(m_rawVolume.GetDepth());
+    m_correctDimensions = true;
+    m_checkedDimensions = true;
+    std::cout << "Volume dimensions checked!\n";
+  }
+  else if (m_directoryChecked && m_dicomSeries)
+  {
+    std::cout << "Checking DICOM series..." << "\n";
+    m_directoryChecked = false;
+
+    if (!m_dicom.ReadHeaders(m_images, m_pool))
+    {
+      ErrorMessage("IMAGE CHECK ERROR", m_dicom.GetError(), "Only uncompressed greyscale DICOM series are supported.");
+      m_correctDimensions = false;
+      m_checkedDimensions = false;
+      return;
+    }
+
+    // Slices are now in patient order rather than file name order
+    m_images = m_dicom.GetSlicePaths();
+    m_imageWidth = static_cast<unsigned int>(m_dicom.GetWidth());
+    m_imageHeight = static_cast<unsigned int>(m_dicom.GetHeight());
+    m_imageDepth = static_cast<unsigned int>(m_dicom.GetDepth());
+    m_correctDimensions = true;
+    m_checkedDimensions = true;
+    std::cout << "DICOM series checked!\n";
+  }
+  else if (m_directoryChecked && m_oiioSeries)
+  {
+    std::cout << "Checking image stack..." << "\n";
+    m_directoryChecked = false;
+
+    // Only headers are read, pixels stay on disk until they are sampled
+    if (!m_oiio.Open(m_images))
+    {
+      ErrorMessage("IMAGE CHECK ERROR", m_oiio.GetError(), "Please ensure all images are the same width and height.");
+      m_correctDimensions = false;
+      m_checkedDimensions = false;
+      return;
+    }
+
+    m_imageWidth = static_cast<unsigned int>(m_oiio.GetWidth());
+    m_imageHeight = static_cast<unsigned int>(m_oiio.GetHeight());
+    m_imageDepth = static_cast<unsigned int>(m_oiio.GetDepth());
+    m_correctDimensions = true;
+    m_checkedDimensions = true;
+    std::cout << "Image stack checked!\n";
+  }
+  else if (m_directoryChecked)
   {
     std::cout << "Checking image dimensions..." << "\n";
     m_directoryChecked = false;
 
+    // Read every image header in parallel, decoding nothing
+    std::vector<ImageInfo> info(m_images.size());
+    m_pool.ParallelFor(m_images.size(), [&](size_t _image, unsigned int)
+    {
+      info[_image] = ReadImageInfo(m_images[_image]);
+    });
+
     // For each image
-    for (int i = 0; i < m_images.size(); ++i)
+    for (size_t i = 0; i < m_images.size(); ++i)
     {
-      QImage img(m_images[i].c_str());
-      
+      m_imageInfo[m_images[i]] = info[i];
+
+      if (!info[i].readable)
+      {
+        m_output = m_images[i] + " could not be read.";
+        ErrorMessage("IMAGE CHECK ERROR", m_output, "Please ensure the directory only contains images.");
+        m_correctDimensions = false;
+        m_checkedDimensions = false;
+        return;
+      }
 
       // Get dimensions of first image
       if (m_imageWidth == 0 && m_imageHeight == 0)
       {
-        m_imageWidth = img.width();
-        m_imageHeight = img.height();
+        m_imageWidth = info[i].width;
+        m_imageHeight = info[i].height;
       }
 
       // Check all images have the same dimensions
-      if (img.width() != m_imageWidth || img.height() != m_imageHeight)
+      if (info[i].width != m_imageWidth || info[i].height != m_imageHeight)
       {
         m_ss << m_images[i];
         m_ss >> m_s;
@@ -125,6 +304,7 @@ void ImageStack::CheckDimensions()
       }
       std::cout << m_images[i] << " checked!" << "\n";
     }
+    m_imageDepth = static_cast<unsigned int>(m_images.size());
     m_correctDimensions = true;
     m_checkedDimensions = true;
     std::cout << "Image dimensions checked!\n";
@@ -139,43 +319,199 @@ void ImageStack::CheckDimensions()
   }
 }
 
+ImageStack::ImageInfo ImageStack::ReadImageInfo(const std::string &_path) const
+{
+  ImageInfo info;
+  std::error_code error;
+  info.fileSize = std::filesystem::file_size(_path, error);
+  if (error)
+  {
+    return info;
+  }
+  info.modified = std::filesystem::last_write_time(_path, error);
+  if (error)
+  {
+    return info;
+  }
+
+  // Reuse the cached header while the file is unchanged
+  // m_imageInfo is only written between parallel sections, so reading it here is safe
+  auto cached = m_imageInfo.find(_path);
+  if (cached != m_imageInfo.end() && cached->second.readable &&
+      cached->second.fileSize == info.fileSize && cached->second.modified == info.modified)
+  {
+    return cached->second;
+  }
+
+  QImageReader reader(QString::fromStdString(_path));
+  QSize size = reader.size();
+
+  // Not every format stores its size in the header, fall back to decoding
+  if (!size.isValid())
+  {
+    QImage img;
+    if (reader.read(&img))
+    {
+      size = img.size();
+    }
+  }
+
+  if (size.isValid())
+  {
+    info.width = size.width();
+    info.height = size.height();
+    info.readable = true;
+  }
+  return info;
+}
+
 void ImageStack::SampleImages()
 {
-  if (m_correctDimensions)
+  if (m_correctDimensions && m_rawVolume.IsOpen())
+  {
+    // Sampling a mapped volume is just a strided view, see GetVolume()
+    m_sampledPoints.Clear();
+    m_correctDimensions = false;
+    m_sampledImages = true;
+    CropVolume();
+    std::cout << "Volume sampled!\n";
+  }
+  else if (m_correctDimensions && m_dicomSeries)
+  {
+    std::cout << "Loading DICOM series..." << "\n";
+    m_sampledPoints.Clear();
+    m_correctDimensions = false;
+
+    // Only every m_sampleResolution'th slice is loaded, rows and columns are strided by GetVolume()
+    if (!m_dicom.LoadVoxels(m_pool, m_sampleResolution))
+    {
+      ErrorMessage("IMAGE SAMPLE ERROR", m_dicom.GetError());
+      m_sampledImages = false;
+      return;
+    }
+    m_sampledResolution = m_sampleResolution;
+    m_sampledImages = true;
+    CropVolume();
+    std::cout << "DICOM series sampled!\n";
+  }
+  else if (m_correctDimensions && m_oiioSeries)
+  {
+    std::cout << "Loading image stack..." << "\n";
+    m_sampledPoints.Clear();
+    m_correctDimensions = false;
+
+    if (!m_oiio.LoadVoxels(m_pool, m_sampleResolution))
+    {
+      ErrorMessage("IMAGE SAMPLE ERROR", m_oiio.GetError());
+      m_sampledImages = false;
+      return;
+    }
+    m_sampledResolution = m_sampleResolution;
+    m_sampledImages = true;
+    CropVolume();
+    std::cout << "Image stack sampled!\n";
+  }
+  else if (m_correctDimensions)
   {
     std::cout << "Sampling images..." << "\n";
     // Clear previous data
-    m_sampledPoints.clear();
+    m_pyramid.Clear();
+    m_bricks.Clear();
+    m_sampledPoints.Clear();
+    m_cache.Close();
     
     m_correctDimensions = false;
     m_sampledImages = true;
-    // For each image (sampled at m_sampleResolution, not every layer)
-    for (int i = 0; i < m_images.size(); i += m_sampleResolution)
-    {
-      QImage img(m_images[i].c_str());
-      std::vector<int> points;
 
-      // Loop image
-      for (unsigned int y = 0; y < m_imageHeight; y += m_sampleResolution)
+    // Map an unchanged directory's samples rather than decoding it all again
+    // Cropped samples are not cached, as their placement in the stack is not stored
+    bool cropping = !m_regionOfInterest.Empty() || m_autoCrop;
+    uint64_t cacheKey = 0;
+    if (m_cache.IsEnabled() && !cropping)
+    {
+      cacheKey = VolumeCache::Key(m_imageDirectory, m_images, m_sampleResolution);
+      if (m_cache.Load(cacheKey))
       {
-        for (unsigned int x = 0; x < m_imageWidth; x += m_sampleResolution)
+        m_crop = VoxelBox();
+        m_sampledResolution = m_sampleResolution;
+        if (m_sparse)
         {
-          QColor col(img.pixel(x, y));
-
-          // Sample one colour channel (all channels have equal values)
-          int r;
-          r = col.red();
-          points.push_back(r);
+          MakeSparse();
+        }
+        else
+        {
+          m_pyramid.Build(SampledBase(), m_pool);
         }
+        std::cout << "Images sampled from cache!\n";
+        return;
       }
-      m_sampledPoints.push_back(points);
-      std::cout << m_images[i] << " sampled!\n";
+    }
+
+    // Every m_sampleResolution'th image is sampled, not every layer, and only inside the region of interest
+    VoxelBox region = SampledRegion(m_regionOfInterest, m_sampleResolution);
 
-      // Avoid overflow
-      if (i + m_sampleResolution >= m_images.size())
+    // Auto-crop and the cache both need every sample at once, so only then is a sparse stack held dense first
+    if (m_sparse && !m_autoCrop && !m_cache.IsEnabled())
+    {
+      if (!SampleSparse(region))
       {
-        break;
+        m_bricks.Clear();
+        m_sampledImages = false;
+        return;
       }
+      m_crop = PixelRegion(region, m_sampleResolution);
+      m_sampledResolution = m_sampleResolution;
+      std::cout << m_bricks.GetAllocatedBricks() << " of " << m_bricks.GetBrickCount() << " bricks stored.\n";
+      std::cout << "Images sampled!\n";
+      return;
+    }
+
+    m_sampledPoints.Resize(region.width, region.height, region.depth);
+    if (!DecodeLayers(region, 0, m_sampledPoints))
+    {
+      m_sampledPoints.Clear();
+      m_sampledImages = false;
+      return;
+    }
+
+    // Drop the background around the data, keeping only the tight box in memory
+    if (m_autoCrop)
+    {
+      VoxelBox tight = BoundingBox(m_sampledPoints.View(), m_autoCropThreshold, m_pool);
+      if (!tight.Empty())
+      {
+        VolumeView<uint8_t> inside = m_sampledPoints.View().SubView(tight);
+        Volume<uint8_t> cropped(tight.width, tight.height, tight.depth);
+        for (size_t z = 0; z < tight.depth; ++z)
+        {
+          for (size_t y = 0; y < tight.height; ++y)
+          {
+            std::copy_n(inside.Slice(z) + y * inside.GetStrideY(), tight.width, cropped.Slice(z) + y * cropped.GetStrideY());
+          }
+        }
+        m_sampledPoints = std::move(cropped);
+        region.x += tight.x;
+        region.y += tight.y;
+        region.z += tight.z;
+        region.width = tight.width;
+        region.height = tight.height;
+        region.depth = tight.depth;
+      }
+    }
+    m_crop = PixelRegion(region, m_sampleResolution);
+
+    if (m_cache.IsEnabled() && !cropping && !m_cache.Store(cacheKey, m_sampledPoints.View()))
+    {
+      ErrorMessage("IMAGE CACHE ERROR", "Sampled images could not be cached in:", m_cache.GetDirectory());
+    }
+    m_sampledResolution = m_sampleResolution;
+    if (m_sparse)
+    {
+      MakeSparse();
+    }
+    else
+    {
+      m_pyramid.Build(SampledBase(), m_pool);
     }
     std::cout << "Images sampled!\n";
   }
@@ -189,11 +525,301 @@ void ImageStack::SampleImages()
   }
 }
 
+bool ImageStack::DecodeLayers(const VoxelBox &_region, size_t _first, Volume<uint8_t> &_out)
+{
+  m_decodeBuffers.resize(m_pool.GetThreadCount());
+  std::vector<char> decoded(_out.GetDepth(), 0);
+
+  // Each worker writes straight into its own layer, so the output order is unchanged
+  m_pool.ParallelFor(_out.GetDepth(), [&](size_t _layer, unsigned int _worker)
+  {
+    QImage &img = m_decodeBuffers[_worker];
+    QImageReader reader(QString::fromStdString(m_images[(_region.z + _first + _layer) * m_sampleResolution]));
+    decoded[_layer] = reader.read(&img);
+    if (decoded[_layer])
+    {
+      SampleImage(img, _out.Slice(_layer), _region);
+    }
+  });
+
+  for (size_t i = 0; i < _out.GetDepth(); ++i)
+  {
+    const std::string &image = m_images[(_region.z + _first + i) * m_sampleResolution];
+    if (!decoded[i])
+    {
+      m_output = image + " could not be read.";
+      ErrorMessage("IMAGE SAMPLE ERROR", m_output);
+      return false;
+    }
+    std::cout << image << " sampled!\n";
+  }
+  return true;
+}
+
+bool ImageStack::SampleSparse(const VoxelBox &_region)
+{
+  m_bricks.Reset(_region.width, _region.height, _region.depth);
+  // Enough layers of bricks to give every worker an image, only these are ever held dense
+  size_t slabBricks = std::max<size_t>(1, m_pool.GetThreadCount() / c_brickSize);
+  Volume<uint8_t> slab;
+  for (size_t bz = 0; bz < m_bricks.GetBricksZ(); bz += slabBricks)
+  {
+    size_t first = bz * c_brickSize;
+    slab.Resize(_region.width, _region.height, std::min(slabBricks * c_brickSize, _region.depth - first));
+    if (!DecodeLayers(_region, first, slab))
+    {
+      return false;
+    }
+    for (size_t layer = 0; layer < slab.GetDepth(); layer += c_brickSize)
+    {
+      VoxelBox bricks;
+      bricks.z = layer;
+      bricks.width = slab.GetWidth();
+      bricks.height = slab.GetHeight();
+      bricks.depth = std::min(c_brickSize, slab.GetDepth() - layer);
+      m_bricks.AddBricks(slab.View().SubView(bricks), bz + layer / c_brickSize, m_pool);
+    }
+  }
+  return true;
+}
+
+bool ImageStack::StreamImages(const std::function<void(const VolumeView<uint8_t> &)> &_consumer)
+{
+  if (!CanStream())
+  {
+    ErrorMessage("IMAGE STREAM ERROR", "Images cannot be streamed.", "Please check the dimensions of a directory of images first.");
+    return false;
+  }
+
+  std::cout << "Streaming images..." << "\n";
+  m_decodeBuffers.resize(m_pool.GetThreadCount());
+
+  // Workers decode up to two layers each ahead of the consumer, which marches on this thread
+  SliceReader reader(m_pool);
+  reader.Start(GetSampledDepth(), GetSampledWidth(), GetSampledHeight(), m_pool.GetThreadCount() * 2,
+               [this](size_t _layer, uint8_t *_points, unsigned int _worker)
+  {
+    QImage &img = m_decodeBuffers[_worker];
+    QImageReader imageReader(QString::fromStdString(m_images[_layer * m_sampleResolution]));
+    if (!imageReader.read(&img))
+    {
+      return false;
+    }
+    SampleImage(img, _points, SampledRegion(VoxelBox(), m_sampleResolution));
+    return true;
+  });
+
+  VolumeView<uint8_t> layer;
+  while (reader.Next(layer))
+  {
+    _consumer(layer);
+  }
+  reader.Stop();
+
+  m_decodeBuffers.clear();
+
+  if (reader.Failed())
+  {
+    m_output = m_images[reader.GetFailedLayer() * m_sampleResolution] + " could not be read.";
+    ErrorMessage("IMAGE STREAM ERROR", m_output);
+    return false;
+  }
+  std::cout << "Images streamed!\n";
+  return true;
+}
+
+void ImageStack::SampleImage(const QImage &_img, uint8_t *_points, const VoxelBox &_region)
+{
+  size_t x0 = _region.x * m_sampleResolution;
+  size_t x1 = (_region.x + _region.width) * m_sampleResolution;
+
+  // Loop the rows of the region
+  for (size_t row = _region.y; row < _region.y + _region.height; ++row)
+  {
+    int y = static_cast<int>(row * m_sampleResolution);
+    // Sample one colour channel (all channels have equal values)
+    // Read common formats straight from the scanline rather than per pixel
+    switch (_img.format())
+    {
+      case QImage::Format_RGB32:
+      case QImage::Format_ARGB32:
+      {
+        const QRgb *line = reinterpret_cast<const QRgb *>(_img.constScanLine(y));
+        for (size_t x = x0; x < x1; x += m_sampleResolution)
+        {
+          *_points++ = static_cast<uint8_t>(qRed(line[x]));
+        }
+        break;
+      }
+
+      case QImage::Format_Grayscale8:
+      {
+        const uchar *line = _img.constScanLine(y);
+        for (size_t x = x0; x < x1; x += m_sampleResolution)
+        {
+          *_points++ = line[x];
+        }
+        break;
+      }
+
+      default:
+      {
+        for (size_t x = x0; x < x1; x += m_sampleResolution)
+        {
+          *_points++ = static_cast<uint8_t>(qRed(_img.pixel(static_cast<int>(x), y)));
+        }
+        break;
+      }
+    }
+  }
+}
+
+VoxelBox ImageStack::SampledRegion(const VoxelBox &_pixels, unsigned int _resolution) const
+{
+  size_t width = (m_imageWidth + _resolution - 1) / _resolution;
+  size_t height = (m_imageHeight + _resolution - 1) / _resolution;
+  size_t depth = (m_imageDepth + _resolution - 1) / _resolution;
+  VoxelBox region;
+  if (_pixels.Empty())
+  {
+    region.width = width;
+    region.height = height;
+    region.depth = depth;
+    return region;
+  }
+
+  // First and one past the last sample point inside the pixels, clamped to the stack
+  auto range = [_resolution](size_t _start, size_t _length, size_t _limit, size_t _samples, size_t &_first, size_t &_count)
+  {
+    _first = std::min((_start + _resolution - 1) / _resolution, _samples);
+    size_t end = (std::min(_start + _length, _limit) + _resolution - 1) / _resolution;
+    _count = end > _first ? end - _first : 0;
+  };
+  range(_pixels.x, _pixels.width, m_imageWidth, width, region.x, region.width);
+  range(_pixels.y, _pixels.height, m_imageHeight, height, region.y, region.height);
+  range(_pixels.z, _pixels.depth, m_imageDepth, depth, region.z, region.depth);
+  return region;
+}
+
+VoxelBox ImageStack::PixelRegion(const VoxelBox &_samples, unsigned int _resolution)
+{
+  VoxelBox pixels;
+  pixels.x = _samples.x * _resolution;
+  pixels.y = _samples.y * _resolution;
+  pixels.z = _samples.z * _resolution;
+  pixels.width = _samples.width * _resolution;
+  pixels.height = _samples.height * _resolution;
+  pixels.depth = _samples.depth * _resolution;
+  return pixels;
+}
+
+void ImageStack::CropVolume()
+{
+  // Raw volumes, DICOM and OpenImageIO stacks are whole in memory (or mapped), so they are cropped by view
+  m_crop = m_regionOfInterest;
+  if (!m_autoCrop)
+  {
+    return;
+  }
+
+  VoxelBox region = SampledRegion(m_regionOfInterest, m_sampleResolution);
+  VoxelBox tight = std::visit([&](const auto &_view) { return BoundingBox(_view.SubView(region), m_autoCropThreshold, m_pool); },
+                              UncroppedVolume());
+  if (!tight.Empty())
+  {
+    tight.x += region.x;
+    tight.y += region.y;
+    tight.z += region.z;
+    m_crop = PixelRegion(tight, m_sampleResolution);
+  }
+}
+
+void ImageStack::MakeSparse()
+{
+  m_bricks.Build(SampledBase(), m_pool);
+  m_sampledPoints.Clear();
+  m_cache.Close();
+  std::cout << m_bricks.GetAllocatedBricks() << " of " << m_bricks.GetBrickCount() << " bricks stored.\n";
+}
+
+AnyVolumeView ImageStack::GetVolume() const
+{
+  if (m_sampledImages && (m_rawVolume.IsOpen() || m_dicomSeries || m_oiioSeries))
+  {
+    VoxelBox region = SampledRegion(m_crop, m_sampleResolution);
+    return std::visit([&](const auto &_view) -> AnyVolumeView { return _view.SubView(region); }, UncroppedVolume());
+  }
+  return UncroppedVolume();
+}
+
+VoxelBox ImageStack::GetVolumeBox() const
+{
+  // Image stacks are cropped as they are sampled, so their box is already known
+  if (m_rawVolume.IsOpen() || m_dicomSeries || m_oiioSeries)
+  {
+    return PixelRegion(SampledRegion(m_crop, m_sampleResolution), m_sampleResolution);
+  }
+  return m_crop;
+}
+
+float ImageStack::GetSampleOffset() const
+{
+  if (m_rawVolume.IsOpen() || m_dicomSeries || m_oiioSeries || !m_sampledImages)
+  {
+    return 0.0f;
+  }
+  // As UncroppedVolume()
+  unsigned int factor = std::max(1u, m_sampleResolution / m_sampledResolution);
+  int level = m_pyramid.LevelForFactor(factor);
+  return level > 0 ? VolumePyramid::SampleOffset(static_cast<unsigned int>(level)) * m_sampledResolution : 0.0f;
+}
+
+void ImageStack::SetAutoCrop(bool _enabled, int _threshold)
+{
+  m_autoCrop = _enabled;
+  m_autoCropThreshold = _threshold;
+}
+
+AnyVolumeView ImageStack::UncroppedVolume() const
+{
+  if (m_rawVolume.IsOpen())
+  {
+    return std::visit([this](const auto &_view) -> AnyVolumeView { return _view.Strided(m_sampleResolution); }, m_rawVolume.View());
+  }
+  if (m_oiioSeries)
+  {
+    return m_oiio.View();
+  }
+  if (m_dicomSeries)
+  {
+    const Volume<int16_t> &volume = m_dicom.GetVolume();
+    return VolumeView<int16_t>(volume.Data(),
+                               (volume.GetWidth() + m_sampleResolution - 1) / m_sampleResolution,
+                               (volume.GetHeight() + m_sampleResolution - 1) / m_sampleResolution,
+                               volume.GetDepth(),
+                               m_sampleResolution, volume.GetStrideY() * m_sampleResolution, volume.GetStrideZ());
+  }
+
+  // Resolution is always a multiple of m_sampledResolution here, see SetSampleResolution()
+  unsigned int factor = std::max(1u, m_sampleResolution / m_sampledResolution);
+  int level = m_pyramid.LevelForFactor(factor);
+  if (level >= 0)
+  {
+    return m_pyramid.Level(static_cast<unsigned int>(level));
+  }
+  return SampledBase().Strided(factor);
+}
+
+void ImageStack::SetThreadCount(unsigned int _threads)
+{
+  m_pool.SetThreadCount(_threads);
+}
+
 void ImageStack::SetSampleResolution(int _resolution)
 {
   if (m_checkedDimensions)
   {
-    std::vector<size_t> data = {m_imageWidth, m_imageHeight, m_images.size()};
+    std::vector<size_t> data = {m_imageWidth, m_imageHeight, m_imageDepth};
     std::sort(data.begin(), data.end());
 
     // Maximum resolution is 10% of the smallest value
@@ -209,6 +835,19 @@ void ImageStack::SetSampleResolution(int _resolution)
     else
     {
       m_sampleResolution = _resolution;
+
+      // Coarser multiples are served from the pyramid, anything else needs sampling again
+      // Stacks read through OpenImageIO are sampled as they are read, so every change needs sampling again
+      // As do DICOM series, which only load the slices of the resolution they were sampled at, and bricks, which have no pyramid
+      bool imageStack = !m_rawVolume.IsOpen() && !m_dicomSeries && !m_oiioSeries;
+      bool loadedAtResolution = m_oiioSeries || m_dicomSeries || !m_bricks.Empty();
+      bool resample = loadedAtResolution ? m_sampleResolution != m_sampledResolution : m_sampleResolution % m_sampledResolution != 0;
+      if ((imageStack || m_oiioSeries || m_dicomSeries) && m_sampledImages && resample)
+      {
+        std::cout << "Images must be sampled again at this resolution." << "\n";
+        m_sampledImages = false;
+        m_correctDimensions = true;
+      }
     }
   }
   else
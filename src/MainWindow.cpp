@@ -17,6 +17,10 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), m_ui(new Ui::Main
   connect(m_ui->m_readImages_btn, SIGNAL(clicked()), m_gl, SLOT(readImages()));
   connect(m_ui->m_checkImages_btn, SIGNAL(clicked()), m_gl, SLOT(checkImages()));
   connect(m_ui->m_sampleImages_btn, SIGNAL(clicked()), m_gl, SLOT(sampleImages()));
+  connect(m_ui->m_streaming_cb, SIGNAL(toggled(bool)), m_gl, SLOT(toggleStreaming(bool)));
+  connect(m_ui->m_sparse_cb, SIGNAL(toggled(bool)), m_gl, SLOT(toggleSparseStorage(bool)));
+  connect(m_ui->m_autoCrop_cb, SIGNAL(toggled(bool)), m_gl, SLOT(toggleAutoCrop(bool)));
+  connect(m_ui->m_engine_cb, SIGNAL(currentIndexChanged(int)), m_gl, SLOT(setEngine(int)));
   connect(m_ui->m_marchCubes_btn, SIGNAL(clicked()), m_gl, SLOT(marchCubes()));
   connect(m_ui->m_generateMesh_btn, SIGNAL(clicked()), m_gl, SLOT(generateMesh()));
   connect(m_ui->m_exportMesh_btn, SIGNAL(clicked()), m_gl, SLOT(exportMesh()));
@@ -27,6 +31,8 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), m_ui(new Ui::Main
   // Inputs
   connect(m_ui->m_sampleResolution_sb, SIGNAL(valueChanged(int)), m_gl, SLOT(setSampleResolution(int)));
   connect(m_ui->m_surfaceLevel_sb, SIGNAL(valueChanged(int)), m_gl, SLOT(setSurfaceLevel(int)));
+  connect(m_ui->m_decimation_sb, SIGNAL(valueChanged(int)), m_gl, SLOT(setDecimation(int)));
+  connect(m_gl, SIGNAL(surfaceLevelRangeChanged(int, int)), m_ui->m_surfaceLevel_sb, SLOT(setRange(int, int)));
   connect(m_ui->m_metallicness_sb, SIGNAL(valueChanged(double)), m_gl, SLOT(setMetallicness(double)));
   connect(m_ui->m_roughness_sb, SIGNAL(valueChanged(double)), m_gl, SLOT(setRoughness(double)));
   connect(m_ui->m_ao_sb, SIGNAL(valueChanged(double)), m_gl, SLOT(setAO(double)));
@@ -49,6 +55,8 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent), m_ui(new Ui::Main
   // Toggles
   connect(m_ui->m_wireframe_cb, SIGNAL(toggled(bool)), m_gl, SLOT(toggleWireframeMode(bool)));
   connect(m_ui->m_cull_cb, SIGNAL(toggled(bool)), m_gl, SLOT(toggleBackFaceCull(bool)));
+  connect(m_ui->m_chunks_cb, SIGNAL(toggled(bool)), m_gl, SLOT(toggleChunks(bool)));
+  connect(m_ui->m_compactVertices_cb, SIGNAL(toggled(bool)), m_gl, SLOT(toggleCompactVertices(bool)));
 }
 
 void MainWindow::on_m_readImages_btn_clicked()
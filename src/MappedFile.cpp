@@ -0,0 +1,133 @@
+///
+/// @file MappedFile.cpp
+/// @brief Read only memory mapping of a file
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "MappedFile.h"
+
+MappedFile::~MappedFile()
+{
+  Close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const std::string &_path)
+{
+  Close();
+
+  m_file = CreateFileA(_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (m_file == INVALID_HANDLE_VALUE)
+  {
+    m_file = nullptr;
+    return false;
+  }
+
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(m_file, &size) || size.QuadPart == 0)
+  {
+    Close();
+    return false;
+  }
+
+  m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (m_mapping == nullptr)
+  {
+    Close();
+    return false;
+  }
+
+  m_data = static_cast<const uint8_t *>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+  if (m_data == nullptr)
+  {
+    Close();
+    return false;
+  }
+  m_size = static_cast<size_t>(size.QuadPart);
+  return true;
+}
+
+void MappedFile::Close()
+{
+  if (m_data != nullptr)
+  {
+    UnmapViewOfFile(m_data);
+  }
+  if (m_mapping != nullptr)
+  {
+    CloseHandle(m_mapping);
+  }
+  if (m_file != nullptr)
+  {
+    CloseHandle(m_file);
+  }
+  m_data = nullptr;
+  m_mapping = nullptr;
+  m_file = nullptr;
+  m_size = 0;
+}
+
+void MappedFile::AdviseSequential()
+{
+  // FILE_FLAG_SEQUENTIAL_SCAN is already set when the file is opened
+}
+
+#else
+
+bool MappedFile::Open(const std::string &_path)
+{
+  Close();
+
+  int file = open(_path.c_str(), O_RDONLY);
+  if (file < 0)
+  {
+    return false;
+  }
+
+  struct stat info;
+  if (fstat(file, &info) != 0 || info.st_size == 0)
+  {
+    close(file);
+    return false;
+  }
+
+  // The mapping keeps its own reference to the file, so it can be closed straight away
+  void *data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, file, 0);
+  close(file);
+  if (data == MAP_FAILED)
+  {
+    return false;
+  }
+
+  m_data = static_cast<const uint8_t *>(data);
+  m_size = static_cast<size_t>(info.st_size);
+  return true;
+}
+
+void MappedFile::Close()
+{
+  if (m_data != nullptr)
+  {
+    munmap(const_cast<uint8_t *>(m_data), m_size);
+  }
+  m_data = nullptr;
+  m_size = 0;
+}
+
+void MappedFile::AdviseSequential()
+{
+  if (m_data != nullptr)
+  {
+    madvise(const_cast<uint8_t *>(m_data), m_size, MADV_SEQUENTIAL);
+  }
+}
+
+#endif
@@ -3,270 +3,1503 @@
 /// @brief Implementation of Marching Cubes algorithm / mesh generation
 
 #include <algorithm>
+#include <array>
+#include <cstdint>
 #include <iostream>
 #include <string>
+#include <type_traits>
+#include <variant>
 
+#include "CubeClassifier.h"
 #include "Mesh.h"
 
-void Mesh::Initialise(std::vector<std::vector<int>> _pointData, unsigned int _imageWidth, unsigned int _imageHeight, unsigned int _sampleResolution)
+namespace
+{
+  // Where cube edge n starts, relative to the cube's first point, and the axis it runs along (0 x, 1 y, 2 z)
+  // x and y edges lie in either the bottom (layer A) or top (layer B) layer of the slab
+  struct EdgePlace
+  {
+    unsigned int dx;
+    unsigned int dy;
+    bool top;
+    unsigned int axis;
+  };
+  constexpr std::array<EdgePlace, 12> c_edgePlaces = {{{0, 0, false, 0}, {1, 0, false, 1}, {0, 1, false, 0}, {0, 0, false, 1},
+                                                       {0, 0, true, 0}, {1, 0, true, 1}, {0, 1, true, 0}, {0, 0, true, 1},
+                                                       {0, 0, false, 2}, {1, 0, false, 2}, {1, 1, false, 2}, {0, 1, false, 2}}};
+
+  // Slabs marched by one task when indexing (and by Surface Nets), fixed so the output does not depend on the thread count
+  constexpr unsigned int c_indexedChunkSlabs = 16;
+  constexpr uint32_t c_noVertex = UINT32_MAX;
+
+  // Indexed output of a run of slabs before it is joined to the rest
+  struct IndexedChunk
+  {
+    std::vector<ngl::Vec3> vertices;
+    std::vector<ngl::Vec3> normals;
+    std::vector<uint32_t> indices;
+    // (edge, vertex) of the x and y edges on the first and last layer, sorted by edge
+    std::vector<std::pair<size_t, uint32_t>> firstLayer;
+    std::vector<std::pair<size_t, uint32_t>> lastLayer;
+    // Vertex of the previous chunk each vertex is the same as, c_noVertex when it is kept
+    std::vector<uint32_t> welded;
+    // Index of each vertex in the joined mesh
+    std::vector<uint32_t> remap;
+    size_t firstVertex = 0;
+    size_t firstIndex = 0;
+  };
+
+  // Cell the surface passes through, as found by Mesh::ClassifySlab()
+  struct NetCell
+  {
+    unsigned int x;
+    unsigned int y;
+    unsigned int cubeIndex;
+  };
+
+  // Two triangles of quad _a _b _c _d, which runs anticlockwise around the edge when _forward
+  uint32_t *EmitQuad(uint32_t _a, uint32_t _b, uint32_t _c, uint32_t _d, bool _forward, uint32_t *_indices)
+  {
+    if (!_forward)
+    {
+      std::swap(_b, _d);
+    }
+    uint32_t quad[6] = {_a, _b, _c, _a, _c, _d};
+    return std::copy(quad, quad + 6, _indices);
+  }
+
+  // Points along each side of a brick's cubes, and so edges of a brick kept by MarchBrick()
+  constexpr size_t c_brickPoints = c_brickSize + 1;
+  constexpr size_t c_brickEdges = c_brickPoints * c_brickPoints * c_brickPoints * 3;
+
+  // Per brick voxel ranges of either kind of source
+  template <typename T>
+  std::vector<std::pair<T, T>> SourceRanges(const VolumeView<T> &_view)
+  {
+    std::vector<std::pair<T, T>> ranges;
+    for (size_t bz = 0; bz < (_view.GetDepth() + c_brickSize - 1) / c_brickSize; ++bz)
+    {
+      for (size_t by = 0; by < (_view.GetHeight() + c_brickSize - 1) / c_brickSize; ++by)
+      {
+        for (size_t bx = 0; bx < (_view.GetWidth() + c_brickSize - 1) / c_brickSize; ++bx)
+        {
+          ranges.push_back(BrickRange(_view, bx, by, bz));
+        }
+      }
+    }
+    return ranges;
+  }
+  template <typename T>
+  const std::vector<std::pair<T, T>> &SourceRanges(const BrickVolume<T> &_bricks)
+  {
+    return _bricks.GetRanges();
+  }
+
+  // Corner of the cube each edge starts from and the axis it runs along, after Bourke (1994)
+  // See cube diagram at: http://paulbourke.net/geometry/polygonise/
+  struct CubeEdge
+  {
+    uint8_t x;
+    uint8_t y;
+    uint8_t z;
+    uint8_t axis;
+  };
+  constexpr std::array<CubeEdge, 12> c_cubeEdges = {{{0, 0, 0, 0}, {1, 0, 0, 1}, {0, 1, 0, 0}, {0, 0, 0, 1},
+                                                     {0, 0, 1, 0}, {1, 0, 1, 1}, {0, 1, 1, 0}, {0, 0, 1, 1},
+                                                     {0, 0, 0, 2}, {1, 0, 0, 2}, {1, 1, 0, 2}, {0, 1, 0, 2}}};
+
+  // Cube index bits of a column of four points, row n in bit n, as the first or second point of each row
+  unsigned int LeftCorners(unsigned int _column)
+  {
+    // Points 0, 3, 4 and 7
+    return (_column & 1) | (_column & 6) << 2 | (_column & 8) << 4;
+  }
+  unsigned int RightCorners(unsigned int _column)
+  {
+    // Points 1, 2, 5 and 6
+    return (_column & 3) << 1 | (_column & 12) << 3;
+  }
+
+  // Layers held while streaming, read by their z in the whole stack
+  struct StreamRing
+  {
+    VolumeView<uint8_t> layers;
+    uint8_t At(size_t _x, size_t _y, size_t _z) const { return layers.At(_x, _y, _z % 4); }
+  };
+
+  // Two layers either side of a slab, and a window of the layers around them that gradients read
+  template <typename T>
+  struct Slab
+  {
+    VolumeView<T> layerA;
+    VolumeView<T> layerB;
+    VolumeWindow<T> around;
+  };
+}
+
+std::vector<ngl::Vec3> VertexNormals(const IndexedMesh &_mesh, size_t _indexCount)
+{
+  const std::vector<ngl::Vec3> &vertices = _mesh.vertices;
+  const std::vector<uint32_t> &indices = _mesh.indices;
+  std::vector<ngl::Vec3> normals(vertices.size(), ngl::Vec3(0.0f, 0.0f, 0.0f));
+  for (size_t i = 0; i + 2 < std::min(_indexCount, indices.size()); i += 3)
+  {
+    const ngl::Vec3 &a = vertices[indices[i]];
+    // Triangles wind clockwise seen from outside
+    ngl::Vec3 normal = (vertices[indices[i + 2]] - a).cross(vertices[indices[i + 1]] - a);
+    if (normal.length() > 0.0f)
+    {
+      normal.normalize();
+    }
+    normals[indices[i]] += normal;
+    normals[indices[i + 1]] += normal;
+    normals[indices[i + 2]] += normal;
+  }
+  for (ngl::Vec3 &normal : normals)
+  {
+    if (normal.length() > 0.0f)
+    {
+      normal.normalize();
+    }
+  }
+  return normals;
+}
+
+void Mesh::Initialise(AnyVolumeView _pointData, unsigned int _imageWidth, unsigned int _imageHeight, unsigned int _sampleResolution)
 {
   m_pointData = _pointData;
+  m_bricks = nullptr;
+  // An unfinished stream no longer stands in for the data
+  m_streamLayers.Clear();
   m_imageHeight = _imageHeight;
   m_imageWidth = _imageWidth;
   m_sampleResolution = _sampleResolution;
 
-  m_pointsPerRow = m_imageWidth / m_sampleResolution;
-  m_columns = m_imageHeight / m_sampleResolution;
-  m_totalSquares = (m_pointsPerRow - 1) * (m_columns - 1);
-
+  // Sampled dimensions come from the data itself
+  std::visit([this](const auto &_view)
+  {
+    m_pointsPerRow = static_cast<unsigned int>(_view.GetWidth());
+    m_columns = static_cast<unsigned int>(_view.GetHeight());
+    m_layers = static_cast<unsigned int>(_view.GetDepth());
+  }, m_pointData);
+  m_totalSquares = m_pointsPerRow > 0 && m_columns > 0 ? (m_pointsPerRow - 1) * (m_columns - 1) : 0;
   m_offset = m_sampleResolution / 2.0f;
+  SetOrigin(0, 0, 0, m_layers);
 
   std::cout << "Mesh initialised!\n";
 }
 
+void Mesh::Initialise(const BrickVolume<uint8_t> &_bricks, unsigned int _imageWidth, unsigned int _imageHeight, unsigned int _sampleResolution)
+{
+  Initialise(VolumeView<uint8_t>(), _imageWidth, _imageHeight, _sampleResolution);
+  m_bricks = &_bricks;
+  m_pointsPerRow = static_cast<unsigned int>(_bricks.GetWidth());
+  m_columns = static_cast<unsigned int>(_bricks.GetHeight());
+  m_layers = static_cast<unsigned int>(_bricks.GetDepth());
+  m_totalSquares = m_pointsPerRow > 0 && m_columns > 0 ? (m_pointsPerRow - 1) * (m_columns - 1) : 0;
+  SetOrigin(0, 0, 0, m_layers);
+}
+
 std::vector<ngl::Vec3> Mesh::MarchCubes()
 {
   // Clear previous data
   m_vertexData.clear();
   
-  std::cout << "Marching cubes...\n";
-  // Example:
-  // m_pointData[0] = 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16
-  // The vector actually represents a 4x4 grid of sampled points...
-  //     1  2  3  4
-  //     5  6  7  8
-  //     9 10 11 12
-  //    13 14 15 16
-  // Their are 9 total squares...
-  //    1 2   2 3   3 4   5  6    6  7    7  8    9 10   10 11   11 12
-  //    5 6   6 7   7 8   9 10   10 11   11 12   13 14   14 15   15 16
-  // Parallel squares from 'z' and 'z + 1' create a cube...
-  for (int z = 0; z < m_pointData.size() - 1; ++z)
-  {
-    // Points must go clockwise so the binary conversion triangulates
-    // to match Bourkes (1994) triangulation table...
-    //    Layer A              Layer B
-    //    p0 -> p1             p4 -> p5
-    //          |            /       |
-    //          v          /         v
-    //    p3 <- p2  ... p3     p7 -> p6
-    int p0_index = -1;                  // Top left (TL)
-    int p1_index = 0;                   // Top right (TR)
-    int p2_index = 0 + m_pointsPerRow;  // Bottom right (BR)
-    int p3_index = -1 + m_pointsPerRow; // Bottom left (BL)
-    int count = 0;
-
-    for (unsigned int i = 0; i < m_totalSquares; ++i)
-    {
-      //std::cout << "Square: " << i << "\n";
-
-      // For every 3 points, skip 1. For example p0_index will be...
-      //    0, 1, 2, . 4, 5, 6, . 8,  9, 10, . 12, 13, 14, .
-      // These indexes are equivalent to the top left point of each square (listed above)...
-      //    1, 2, 3, . 5, 6, 7, . 9, 10, 11, . 13, 14, 15, .
-      if (count == m_pointsPerRow - 1)
+  if (m_engine != Engine::MarchingCubes)
+  {
+    // The other engines always share vertices, so expand their triangles
+    IndexedMesh mesh = MarchCubesIndexed();
+    size_t count = mesh.indices.size();
+    m_vertexData.resize(m_gradientNormals ? count * 2 : count);
+    for (size_t i = 0; i < count; ++i)
+    {
+      m_vertexData[i] = mesh.vertices[mesh.indices[i]];
+      if (m_gradientNormals)
       {
-        p0_index += 2;
-        p1_index += 2;
-        p2_index += 2;
-        p3_index += 2;
-        count = 0;
+        m_vertexData[count + i] = mesh.normals[mesh.indices[i]];
       }
-      else
+    }
+    std::vector<ngl::Vec3> vertices;
+    vertices.swap(m_vertexData);
+    return vertices;
+  }
+
+  std::cout << "Marching cubes...\n";
+  if (m_bricks != nullptr)
+  {
+    MarchBricks(*m_bricks, nullptr);
+  }
+  else
+  {
+    std::visit([this](const auto &_view) { MarchVolume(_view, nullptr); }, m_pointData);
+  }
+  std::cout << "Cubes marched!\n";
+  // Hand the buffer over rather than copying it
+  std::vector<ngl::Vec3> vertices;
+  vertices.swap(m_vertexData);
+  return vertices;
+}
+
+IndexedMesh Mesh::MarchCubesIndexed()
+{
+  IndexedMesh mesh;
+  std::cout << "Marching cubes (indexed)...\n";
+  if (m_engine == Engine::FlyingEdges)
+  {
+    MarchFlyingEdges(mesh);
+  }
+  else if (m_bricks != nullptr)
+  {
+    MarchBricks(*m_bricks, &mesh);
+  }
+  else
+  {
+    std::visit([&](const auto &_view) { MarchVolume(_view, &mesh); }, m_pointData);
+  }
+  std::cout << "Cubes marched! " << mesh.vertices.size() << " vertices shared by " << mesh.indices.size() / 3 << " triangles.\n";
+  return mesh;
+}
+
+IndexedMesh Mesh::MarchCubesIncremental()
+{
+  std::cout << "Marching cubes (incremental)...\n";
+  size_t marched = 0;
+  if (m_bricks != nullptr)
+  {
+    marched = RemarchBricks(*m_bricks);
+  }
+  else
+  {
+    std::visit([&](const auto &_view) { marched = RemarchBricks(_view); }, m_pointData);
+  }
+
+  // Every brick whose cubes reach an edge made the vertex on it, the earliest of them keeps it
+  // and the others are welded to that copy, as MarchIndexed() welds its runs of slabs
+  size_t bricksX = (m_pointsPerRow + c_brickSize - 1) / c_brickSize;
+  size_t bricksY = (m_columns + c_brickSize - 1) / c_brickSize;
+  size_t pointsPerLayer = static_cast<size_t>(m_pointsPerRow) * m_columns;
+  // (brick, vertex) each seam vertex is welded to, c_noVertex for a vertex that is kept
+  std::vector<std::vector<std::pair<size_t, uint32_t>>> welds(m_brickMeshes.size());
+  m_pool.ParallelFor(m_brickMeshes.size(), [&](size_t _brick, unsigned int)
+  {
+    const std::vector<std::pair<size_t, uint32_t>> &seam = m_brickMeshes[_brick].seam;
+    welds[_brick].assign(seam.size(), std::make_pair(_brick, c_noVertex));
+    for (size_t i = 0; i < seam.size(); ++i)
+    {
+      unsigned int axis = static_cast<unsigned int>(seam[i].first % 3);
+      size_t point = seam[i].first / 3;
+      std::array<size_t, 3> start = {point % m_pointsPerRow, point / m_pointsPerRow % m_columns, point / pointsPerLayer};
+      // Cubes reaching the edge start at or one point before it across each other axis
+      std::array<size_t, 3> low;
+      std::array<size_t, 3> high;
+      for (unsigned int a = 0; a < 3; ++a)
       {
-        p0_index++;
-        p1_index++;
-        p2_index++;
-        p3_index++;
+        high[a] = start[a] / c_brickSize;
+        low[a] = a != axis && start[a] > 0 ? (start[a] - 1) / c_brickSize : high[a];
       }
-      // Layer A
-      int p0 = m_pointData[z][p0_index];
-      int p1 = m_pointData[z][p1_index]; 
-      int p2 = m_pointData[z][p2_index]; 
-      int p3 = m_pointData[z][p3_index]; 
-      // Layer B
-      int p4 = m_pointData[z + 1][p0_index]; 
-      int p5 = m_pointData[z + 1][p1_index]; 
-      int p6 = m_pointData[z + 1][p2_index]; 
-      int p7 = m_pointData[z + 1][p3_index]; 
-      count++;
-
-      // Convert points into a binary string
-      std::vector<int> points = {p0, p1, p2, p3, p4, p5, p6, p7};
-      std::string binary = "";
-
-      for (size_t i = 0; i < points.size(); ++i)
+      // Bricks are visited in brick order, so the first to hold the edge is the earliest
+      bool found = false;
+      for (size_t bz = low[2]; bz <= high[2] && !found; ++bz)
       {
-        if (points[i] >= m_surfaceLevel)
-        {
-          binary += "1";
-        }
-        else
+        for (size_t by = low[1]; by <= high[1] && !found; ++by)
         {
-          binary += "0";
+          for (size_t bx = low[0]; bx <= high[0] && !found; ++bx)
+          {
+            size_t other = (bz * bricksY + by) * bricksX + bx;
+            if (other >= _brick)
+            {
+              continue;
+            }
+            const std::vector<std::pair<size_t, uint32_t>> &otherSeam = m_brickMeshes[other].seam;
+            auto match = std::lower_bound(otherSeam.begin(), otherSeam.end(), std::make_pair(seam[i].first, uint32_t(0)));
+            if (match != otherSeam.end() && match->first == seam[i].first)
+            {
+              welds[_brick][i] = std::make_pair(other, match->second);
+              found = true;
+            }
+          }
         }
       }
-      reverse(binary.begin(), binary.end());
+    }
+  });
 
-      // Return edges that need to be connected
-      std::vector<int> edges = m_table.Triangulate(binary);
+  // Bricks are written back in brick order, so the mesh does not depend on the thread count
+  std::vector<size_t> firstVertex(m_brickMeshes.size() + 1, 0);
+  std::vector<size_t> firstIndex(m_brickMeshes.size() + 1, 0);
+  for (size_t i = 0; i < m_brickMeshes.size(); ++i)
+  {
+    size_t welded = static_cast<size_t>(std::count_if(welds[i].begin(), welds[i].end(),
+                                                      [](const std::pair<size_t, uint32_t> &_weld) { return _weld.second != c_noVertex; }));
+    firstVertex[i + 1] = firstVertex[i] + m_brickMeshes[i].mesh.vertices.size() - welded;
+    firstIndex[i + 1] = firstIndex[i] + m_brickMeshes[i].mesh.indices.size();
+  }
+  IndexedMesh mesh;
+  mesh.vertices.resize(firstVertex.back());
+  mesh.normals.resize(m_gradientNormals ? firstVertex.back() : 0);
+  mesh.indices.resize(firstIndex.back());
 
-      for (size_t i = 0; i < edges.size(); ++i)
+  // Index of each brick vertex in the joined mesh
+  std::vector<std::vector<uint32_t>> remap(m_brickMeshes.size());
+  m_pool.ParallelFor(m_brickMeshes.size(), [&](size_t _brick, unsigned int)
+  {
+    const BrickMesh &brick = m_brickMeshes[_brick];
+    std::vector<char> kept(brick.mesh.vertices.size(), 1);
+    for (size_t i = 0; i < brick.seam.size(); ++i)
+    {
+      kept[brick.seam[i].second] = welds[_brick][i].second == c_noVertex;
+    }
+    remap[_brick].assign(brick.mesh.vertices.size(), c_noVertex);
+    size_t next = firstVertex[_brick];
+    for (size_t i = 0; i < brick.mesh.vertices.size(); ++i)
+    {
+      if (kept[i])
       {
-        // All edges have been read
-        if (edges[i] == -1)
+        mesh.vertices[next] = brick.mesh.vertices[i];
+        if (m_gradientNormals)
         {
-          break;
+          mesh.normals[next] = brick.mesh.normals[i];
         }
-        // Calculate coordinates of edge (at midpoint), add to vertexData vector
-        // Edge positions yet again based off of Bourkes (1994) methodology
-        // See cube diagram at: http://paulbourke.net/geometry/polygonise/
-        else
+        remap[_brick][i] = static_cast<uint32_t>(next++);
+      }
+    }
+  });
+  // Welded vertices need the earlier brick's final indices, so run once every brick is placed
+  m_pool.ParallelFor(m_brickMeshes.size(), [&](size_t _brick, unsigned int)
+  {
+    const BrickMesh &brick = m_brickMeshes[_brick];
+    for (size_t i = 0; i < brick.seam.size(); ++i)
+    {
+      if (welds[_brick][i].second != c_noVertex)
+      {
+        remap[_brick][brick.seam[i].second] = remap[welds[_brick][i].first][welds[_brick][i].second];
+      }
+    }
+    for (size_t i = 0; i < brick.mesh.indices.size(); ++i)
+    {
+      mesh.indices[firstIndex[_brick] + i] = remap[_brick][brick.mesh.indices[i]];
+    }
+  });
+  std::cout << "Cubes marched! " << marched << " of " << m_brickMeshes.size() << " bricks marched again.\n";
+  return mesh;
+}
+
+std::vector<MeshChunk> Mesh::MarchChunks()
+{
+  std::cout << "Marching chunks...\n";
+  size_t marched = 0;
+  if (m_bricks != nullptr)
+  {
+    marched = RemarchChunks(*m_bricks);
+  }
+  else
+  {
+    std::visit([&](const auto &_view) { marched = RemarchChunks(_view); }, m_pointData);
+  }
+  // Coarser points are a subset of the finest, so a chunk with no full resolution surface has none at all
+  std::vector<MeshChunk> chunks;
+  size_t triangles = 0;
+  for (const MeshChunk &chunk : m_chunkMeshes)
+  {
+    if (!chunk.levels.empty() && chunk.levels[0].surfaceIndices > 0)
+    {
+      chunks.push_back(chunk);
+      triangles += chunk.levels[0].surfaceIndices / 3;
+    }
+  }
+  std::cout << "Chunks marched! " << chunks.size() << " chunks of " << c_chunkLevels << " levels, "
+            << triangles << " triangles at full resolution, " << marched << " chunks marched again.\n";
+  return chunks;
+}
+
+void Mesh::BeginStream(unsigned int _pointsPerRow, unsigned int _columns, unsigned int _layers,
+                       unsigned int _imageWidth, unsigned int _imageHeight, unsigned int _sampleResolution)
+{
+  // Nothing is borrowed while streaming, layers are copied into the ring
+  m_pointData = VolumeView<uint8_t>();
+  m_bricks = nullptr;
+  m_imageWidth = _imageWidth;
+  m_imageHeight = _imageHeight;
+  m_sampleResolution = _sampleResolution;
+  m_pointsPerRow = _pointsPerRow;
+  m_columns = _columns;
+  // The total is still needed up front, as it centres the mesh along z
+  m_layers = _layers;
+  m_totalSquares = m_pointsPerRow > 0 && m_columns > 0 ? (m_pointsPerRow - 1) * (m_columns - 1) : 0;
+  m_offset = m_sampleResolution / 2.0f;
+  SetOrigin(0, 0, 0, m_layers);
+
+  m_streamLayers.Resize(m_pointsPerRow, m_columns, 4);
+  m_streamedLayers = 0;
+  m_vertexData.clear();
+  m_streamNormals.clear();
+
+  std::cout << "Marching cubes (streaming)...\n";
+}
+
+void Mesh::StreamLayer(const VolumeView<uint8_t> &_layer)
+{
+  if (_layer.GetWidth() != m_pointsPerRow || _layer.GetHeight() != m_columns || m_streamedLayers >= m_layers)
+  {
+    ErrorMessage("STREAM ERROR", "Layer " + std::to_string(m_streamedLayers) + " does not fit the stream.",
+                 "Expected " + std::to_string(m_layers) + " layers of " + std::to_string(m_pointsPerRow) + "x" + std::to_string(m_columns) + ".");
+    return;
+  }
+
+  // Overwrite the oldest layer, neither the slabs left nor their gradients need it
+  unsigned int slot = m_streamedLayers % 4;
+  uint8_t *points = m_streamLayers.Slice(slot);
+  for (size_t y = 0; y < _layer.GetHeight(); ++y)
+  {
+    for (size_t x = 0; x < _layer.GetWidth(); ++x)
+    {
+      *points++ = _layer.At(x, y, 0);
+    }
+  }
+
+  VolumeView<uint8_t> ring = m_streamLayers.View();
+  auto march = [&](unsigned int _z)
+  {
+    size_t first = m_vertexData.size();
+    m_vertexData.resize(first + CountSlab(ring.Layer(_z % 4), ring.Layer((_z + 1) % 4), _z));
+    m_streamNormals.resize(m_gradientNormals ? m_vertexData.size() : 0);
+    MarchSlab(ring.Layer(_z % 4), ring.Layer((_z + 1) % 4), _z, StreamRing{ring}, m_vertexData.data() + first,
+              m_gradientNormals ? m_streamNormals.data() + first : nullptr);
+  };
+  // The last layer also completes the last slab, which has no layer beyond it to wait for
+  if (m_streamedLayers >= 2)
+  {
+    march(m_streamedLayers - 2);
+  }
+  if (m_streamedLayers >= 1 && m_streamedLayers + 1 == m_layers)
+  {
+    march(m_streamedLayers - 1);
+  }
+  ++m_streamedLayers;
+}
+
+std::vector<ngl::Vec3> Mesh::EndStream()
+{
+  m_streamLayers.Clear();
+  std::cout << "Cubes marched!\n";
+  std::vector<ngl::Vec3> vertices;
+  vertices.swap(m_vertexData);
+  // Slabs were added as they arrived, so only now can the normals follow every vertex
+  if (m_gradientNormals)
+  {
+    vertices.insert(vertices.end(), m_streamNormals.begin(), m_streamNormals.end());
+  }
+  std::vector<ngl::Vec3>().swap(m_streamNormals);
+  return vertices;
+}
+
+template <typename T>
+void Mesh::MarchVolume(const VolumeView<T> &_pointData, IndexedMesh *_indexed)
+{
+  // Bricks whose cubes all lie on one side of the surface are skipped
+  size_t bricksZ = (m_layers + c_brickSize - 1) / c_brickSize;
+  m_bricksX = static_cast<unsigned int>((m_pointsPerRow + c_brickSize - 1) / c_brickSize);
+  m_bricksY = static_cast<unsigned int>((m_columns + c_brickSize - 1) / c_brickSize);
+  m_activeBricks = ActiveBricks(SourceRanges(_pointData), m_bricksX, m_bricksY, bricksZ, m_surfaceLevel);
+
+  // Parallel squares from 'z' and 'z + 1' create a cube...
+  // Gradients read the layers around the slab straight from the volume
+  auto layers = [&](unsigned int _z, unsigned int)
+  {
+    return Slab<T>{_pointData.Layer(_z), _pointData.Layer(_z + 1), VolumeWindow<T>{_pointData}};
+  };
+  MarchLayers<T>(layers, _indexed);
+  m_activeBricks.clear();
+}
+
+template <typename T>
+void Mesh::MarchBricks(const BrickVolume<T> &_bricks, IndexedMesh *_indexed)
+{
+  m_bricksX = static_cast<unsigned int>(_bricks.GetBricksX());
+  m_bricksY = static_cast<unsigned int>(_bricks.GetBricksY());
+  m_activeBricks = ActiveBricks(_bricks.GetRanges(), _bricks.GetBricksX(), _bricks.GetBricksY(), _bricks.GetBricksZ(), m_surfaceLevel);
+
+  // Each worker unpacks the two layers of its slab into its own scratch, with gradient normals
+  // also the layer either side of them, so the gradients read the same scratch rather than the bricks
+  std::vector<Volume<T>> scratch(m_pool.GetThreadCount());
+  auto layers = [&](unsigned int _z, unsigned int _worker)
+  {
+    Volume<T> &slab = scratch[_worker];
+    if (slab.Empty())
+    {
+      slab.Resize(m_pointsPerRow, m_columns, m_gradientNormals ? 4 : 2);
+    }
+    unsigned int first = m_gradientNormals && _z > 0 ? _z - 1 : _z;
+    unsigned int last = m_gradientNormals ? std::min(_z + 2, m_layers - 1) : _z + 1;
+    for (unsigned int z = first; z <= last; ++z)
+    {
+      _bricks.CopyLayer(z, slab.Slice(z - first));
+    }
+    VolumeView<T> view = slab.View();
+    VoxelBox loaded;
+    loaded.width = m_pointsPerRow;
+    loaded.height = m_columns;
+    loaded.depth = last - first + 1;
+    return Slab<T>{view.Layer(_z - first), view.Layer(_z + 1 - first), VolumeWindow<T>{view.SubView(loaded), 0, 0, first}};
+  };
+  MarchLayers<T>(layers, _indexed);
+  m_activeBricks.clear();
+}
+
+template <typename T, typename Layers>
+void Mesh::MarchLayers(const Layers &_layers, IndexedMesh *_indexed)
+{
+  if (_indexed != nullptr && m_engine == Engine::SurfaceNets)
+  {
+    MarchSurfaceNets<T>(_layers, *_indexed);
+    return;
+  }
+  if (_indexed != nullptr)
+  {
+    MarchIndexed<T>(_layers, *_indexed);
+    return;
+  }
+
+  // Count pass, so every slab's vertices can be written straight into one buffer of the final size
+  unsigned int slabs = m_layers > 1 ? m_layers - 1 : 0;
+  std::vector<size_t> offsets(slabs + 1, 0);
+  m_pool.ParallelFor(slabs, [&](size_t _z, unsigned int _worker)
+  {
+    unsigned int z = static_cast<unsigned int>(_z);
+    if (SlabActive(z))
+    {
+      Slab<T> slab = _layers(z, _worker);
+      offsets[z + 1] = CountSlab(slab.layerA, slab.layerB, z);
+    }
+  });
+  for (unsigned int z = 0; z < slabs; ++z)
+  {
+    offsets[z + 1] += offsets[z];
+  }
+
+  // Fill pass, slabs land in z order so the mesh does not depend on the thread count
+  // Normals go after every vertex, in the same buffer
+  m_vertexData.resize(m_gradientNormals ? offsets[slabs] * 2 : offsets[slabs]);
+  m_pool.ParallelFor(slabs, [&](size_t _z, unsigned int _worker)
+  {
+    unsigned int z = static_cast<unsigned int>(_z);
+    if (offsets[z + 1] != offsets[z])
+    {
+      Slab<T> slab = _layers(z, _worker);
+      MarchSlab(slab.layerA, slab.layerB, z, slab.around, m_vertexData.data() + offsets[z],
+                m_gradientNormals ? m_vertexData.data() + offsets[slabs] + offsets[z] : nullptr);
+    }
+  });
+}
+
+template <typename T, typename Layers>
+void Mesh::MarchIndexed(const Layers &_layers, IndexedMesh &_mesh)
+{
+  unsigned int slabs = m_layers > 1 ? m_layers - 1 : 0;
+  std::vector<IndexedChunk> chunks((slabs + c_indexedChunkSlabs - 1) / c_indexedChunkSlabs);
+  size_t layerPoints = static_cast<size_t>(m_pointsPerRow) * m_columns;
+
+  // Each chunk marches its slabs in order, keeping the vertex made on each edge
+  // x and y edges are kept for the bottom and top layer of the current slab, z edges for the slab itself
+  m_pool.ParallelFor(chunks.size(), [&](size_t _chunk, unsigned int _worker)
+  {
+    IndexedChunk &chunk = chunks[_chunk];
+    unsigned int firstSlab = static_cast<unsigned int>(_chunk) * c_indexedChunkSlabs;
+    unsigned int lastSlab = std::min(firstSlab + c_indexedChunkSlabs, slabs) - 1;
+    std::vector<uint32_t> bottom(layerPoints * 2, c_noVertex);
+    std::vector<uint32_t> top(layerPoints * 2, c_noVertex);
+    std::vector<uint32_t> upright(layerPoints, c_noVertex);
+
+    for (unsigned int z = firstSlab; z <= lastSlab; ++z)
+    {
+      if (SlabActive(z))
+      {
+        Slab<T> slab = _layers(z, _worker);
+        ClassifySlab(slab.layerA, slab.layerB, z, [&](unsigned int _x, unsigned int _y, unsigned int _cubeIndex)
         {
-          switch(edges[i])
+          const std::array<int8_t, 16> &edges = Table::Edges(_cubeIndex);
+          unsigned int edgeCount = Table::TriangleCount(_cubeIndex) * 3;
+          for (unsigned int i = 0; i < edgeCount; ++i)
           {
-            case 0:
+            const EdgePlace &place = c_edgePlaces[edges[i]];
+            size_t point = static_cast<size_t>(_y + place.dy) * m_pointsPerRow + _x + place.dx;
+            uint32_t &vertex = place.axis == 2 ? upright[point] : (place.top ? top : bottom)[point * 2 + place.axis];
+            if (vertex == c_noVertex)
             {
-              ngl::Vec3 e0 = {static_cast<ngl::Real>(((p0_index % m_pointsPerRow) * m_sampleResolution) + m_offset) - m_imageWidth / 2.0f,
-                              static_cast<ngl::Real>((p0_index / m_pointsPerRow) * m_sampleResolution) - m_imageHeight / 2.0f,
-                              static_cast<ngl::Real>(z * m_sampleResolution) - (m_pointData.size() * (m_sampleResolution / 2.0f))};
-              e0 *= m_meshScale;
-              m_vertexData.push_back(e0);
-              break;
+              vertex = static_cast<uint32_t>(chunk.vertices.size());
+              chunk.vertices.push_back(EdgeVertex(_x, _y, z, static_cast<unsigned int>(edges[i])));
+              if (m_gradientNormals)
+              {
+                chunk.normals.push_back(EdgeNormal(slab.around, _x, _y, z, static_cast<unsigned int>(edges[i])));
+              }
+              // Vertices on the chunk's outer layers are welded to the neighbouring chunks afterwards
+              if (place.axis != 2 && !place.top && z == firstSlab)
+              {
+                chunk.firstLayer.emplace_back(point * 2 + place.axis, vertex);
+              }
+              else if (place.axis != 2 && place.top && z == lastSlab)
+              {
+                chunk.lastLayer.emplace_back(point * 2 + place.axis, vertex);
+              }
             }
+            chunk.indices.push_back(vertex);
+          }
+        });
+      }
+      // The top layer of this slab is the bottom of the next
+      std::swap(bottom, top);
+      std::fill(top.begin(), top.end(), c_noVertex);
+      std::fill(upright.begin(), upright.end(), c_noVertex);
+    }
+    std::sort(chunk.firstLayer.begin(), chunk.firstLayer.end());
+    std::sort(chunk.lastLayer.begin(), chunk.lastLayer.end());
+  });
 
-            case 1:
-            {
-              ngl::Vec3 e1 = {static_cast<ngl::Real>((p1_index % m_pointsPerRow) * m_sampleResolution) - m_imageWidth / 2.0f,
-                              static_cast<ngl::Real>(((p1_index / m_pointsPerRow) * m_sampleResolution) + m_offset) - m_imageHeight / 2.0f,
-                              static_cast<ngl::Real>(z * m_sampleResolution) - (m_pointData.size() * (m_sampleResolution / 2.0f))};
-              e1 *= m_meshScale;
-              m_vertexData.push_back(e1);
-              break;
-            }
+  // A chunk's first layer is the previous chunk's last, so both made the same vertices there
+  // The previous chunk keeps them and this chunk's copies are dropped
+  m_pool.ParallelFor(chunks.size(), [&](size_t _chunk, unsigned int)
+  {
+    IndexedChunk &chunk = chunks[_chunk];
+    chunk.welded.assign(chunk.vertices.size(), c_noVertex);
+    if (_chunk == 0)
+    {
+      return;
+    }
+    const std::vector<std::pair<size_t, uint32_t>> &previous = chunks[_chunk - 1].lastLayer;
+    auto match = previous.begin();
+    for (const std::pair<size_t, uint32_t> &edge : chunk.firstLayer)
+    {
+      match = std::lower_bound(match, previous.end(), std::make_pair(edge.first, uint32_t(0)));
+      if (match != previous.end() && match->first == edge.first)
+      {
+        chunk.welded[edge.second] = match->second;
+      }
+    }
+  });
 
-            case 2:
-            {
-              ngl::Vec3 e2 = {static_cast<ngl::Real>(((p3_index % m_pointsPerRow) * m_sampleResolution) + m_offset) - m_imageWidth / 2.0f,
-                              static_cast<ngl::Real>((p3_index / m_pointsPerRow) * m_sampleResolution) - m_imageHeight / 2.0f,
-                              static_cast<ngl::Real>(z * m_sampleResolution) - (m_pointData.size() * (m_sampleResolution / 2.0f))};
-              e2 *= m_meshScale;
-              m_vertexData.push_back(e2);
-              break;
-            }
+  // Chunks are written back in z order, so the mesh does not depend on the thread count
+  size_t vertexCount = 0;
+  size_t indexCount = 0;
+  for (IndexedChunk &chunk : chunks)
+  {
+    chunk.firstVertex = vertexCount;
+    chunk.firstIndex = indexCount;
+    vertexCount += static_cast<size_t>(std::count(chunk.welded.begin(), chunk.welded.end(), c_noVertex));
+    indexCount += chunk.indices.size();
+  }
+  _mesh.vertices.resize(vertexCount);
+  _mesh.normals.resize(m_gradientNormals ? vertexCount : 0);
+  _mesh.indices.resize(indexCount);
 
-            case 3:
-            {
-              ngl::Vec3 e3 = {static_cast<ngl::Real>((p0_index % m_pointsPerRow) * m_sampleResolution) - m_imageWidth / 2.0f,
-                              static_cast<ngl::Real>(((p0_index / m_pointsPerRow) * m_sampleResolution) + m_offset) - m_imageHeight / 2.0f,
-                              static_cast<ngl::Real>(z * m_sampleResolution) - (m_pointData.size() * (m_sampleResolution / 2.0f))};
-              e3 *= m_meshScale;
-              m_vertexData.push_back(e3);
-              break;
-            }
+  m_pool.ParallelFor(chunks.size(), [&](size_t _chunk, unsigned int)
+  {
+    IndexedChunk &chunk = chunks[_chunk];
+    chunk.remap.assign(chunk.vertices.size(), c_noVertex);
+    size_t next = chunk.firstVertex;
+    for (size_t i = 0; i < chunk.vertices.size(); ++i)
+    {
+      if (chunk.welded[i] == c_noVertex)
+      {
+        _mesh.vertices[next] = chunk.vertices[i];
+        if (m_gradientNormals)
+        {
+          _mesh.normals[next] = chunk.normals[i];
+        }
+        chunk.remap[i] = static_cast<uint32_t>(next++);
+      }
+    }
+  });
+  // Welded vertices need the previous chunk's final indices, so run once every chunk is placed
+  m_pool.ParallelFor(chunks.size(), [&](size_t _chunk, unsigned int)
+  {
+    IndexedChunk &chunk = chunks[_chunk];
+    for (size_t i = 0; i < chunk.vertices.size(); ++i)
+    {
+      if (chunk.welded[i] != c_noVertex)
+      {
+        chunk.remap[i] = chunks[_chunk - 1].remap[chunk.welded[i]];
+      }
+    }
+    for (size_t i = 0; i < chunk.indices.size(); ++i)
+    {
+      _mesh.indices[chunk.firstIndex + i] = chunk.remap[chunk.indices[i]];
+    }
+  });
+}
 
-            case 4:
-            {
-              ngl::Vec3 e4 = {static_cast<ngl::Real>(((p0_index % m_pointsPerRow) * m_sampleResolution) + m_offset) - m_imageWidth / 2.0f,
-                              static_cast<ngl::Real>((p0_index / m_pointsPerRow) * m_sampleResolution) - m_imageHeight / 2.0f,
-                              static_cast<ngl::Real>((z + 1) * m_sampleResolution) - (m_pointData.size() * (m_sampleResolution / 2.0f))};
-              e4 *= m_meshScale;
-              m_vertexData.push_back(e4);
-              break;
-            }
+template <typename Source>
+size_t Mesh::RemarchBricks(const Source &_source)
+{
+  size_t bricksX = (m_pointsPerRow + c_brickSize - 1) / c_brickSize;
+  size_t bricksY = (m_columns + c_brickSize - 1) / c_brickSize;
+  size_t bricksZ = (m_layers + c_brickSize - 1) / c_brickSize;
+  std::vector<size_t> changed;
+  if (m_brickMeshes.empty())
+  {
+    // First march, the brick ranges stand in for a span space index of the cubes
+    auto spans = CubeRanges(SourceRanges(_source), bricksX, bricksY, bricksZ);
+    m_brickSpans.resize(spans.size());
+    m_brickMeshes.resize(spans.size());
+    for (size_t i = 0; i < spans.size(); ++i)
+    {
+      m_brickSpans[i] = std::make_pair(static_cast<float>(spans[i].first), static_cast<float>(spans[i].second));
+      if (m_brickSpans[i].first < m_surfaceLevel && m_brickSpans[i].second >= m_surfaceLevel)
+      {
+        changed.push_back(i);
+      }
+    }
+  }
+  else if (m_incrementalLevel != m_surfaceLevel)
+  {
+    // A cube changes only when a corner lies in [low, high), so a brick without such a value keeps its mesh
+    float low = static_cast<float>(std::min(m_incrementalLevel, m_surfaceLevel));
+    float high = static_cast<float>(std::max(m_incrementalLevel, m_surfaceLevel));
+    for (size_t i = 0; i < m_brickSpans.size(); ++i)
+    {
+      if (m_brickSpans[i].first < high && m_brickSpans[i].second >= low)
+      {
+        changed.push_back(i);
+      }
+    }
+  }
+  m_incrementalLevel = m_surfaceLevel;
 
-            case 5:
-            {
-              ngl::Vec3 e5 = {static_cast<ngl::Real>((p1_index % m_pointsPerRow) * m_sampleResolution) - m_imageWidth / 2.0f,
-                              static_cast<ngl::Real>(((p1_index / m_pointsPerRow) * m_sampleResolution) + m_offset) - m_imageHeight / 2.0f,
-                              static_cast<ngl::Real>((z + 1) * m_sampleResolution) - (m_pointData.size() * (m_sampleResolution / 2.0f))};
-              e5 *= m_meshScale;
-              m_vertexData.push_back(e5);
-              break;
-            }
+  m_pool.ParallelFor(changed.size(), [&](size_t _i, unsigned int)
+  {
+    MarchBrick(_source, changed[_i], m_brickMeshes[changed[_i]]);
+  });
+  return changed.size();
+}
 
-            case 6:
-            {
-              ngl::Vec3 e6 = {static_cast<ngl::Real>(((p3_index % m_pointsPerRow) * m_sampleResolution) + m_offset) - m_imageWidth / 2.0f,
-                              static_cast<ngl::Real>((p3_index / m_pointsPerRow) * m_sampleResolution) - m_imageHeight / 2.0f,
-                              static_cast<ngl::Real>((z + 1) * m_sampleResolution) - (m_pointData.size() * (m_sampleResolution / 2.0f))};
-              e6 *= m_meshScale;
-              m_vertexData.push_back(e6);
-              break;
-            }
+template <typename Source>
+void Mesh::MarchBrick(const Source &_source, size_t _brick, BrickMesh &_out) const
+{
+  IndexedMesh &mesh = _out.mesh;
+  mesh.vertices.clear();
+  mesh.normals.clear();
+  mesh.indices.clear();
+  _out.seam.clear();
+  if (!(m_brickSpans[_brick].first < m_surfaceLevel && m_brickSpans[_brick].second >= m_surfaceLevel))
+  {
+    return;
+  }
 
-            case 7:
-            {
-              ngl::Vec3 e7 = {static_cast<ngl::Real>((p0_index % m_pointsPerRow) * m_sampleResolution) - m_imageWidth / 2.0f,
-                              static_cast<ngl::Real>(((p0_index / m_pointsPerRow) * m_sampleResolution) + m_offset) - m_imageHeight / 2.0f,
-                              static_cast<ngl::Real>((z + 1) * m_sampleResolution) - (m_pointData.size() * (m_sampleResolution / 2.0f))};
-              e7 *= m_meshScale;
-              m_vertexData.push_back(e7);
-              break;
-            }
+  size_t bricksX = (m_pointsPerRow + c_brickSize - 1) / c_brickSize;
+  size_t bricksY = (m_columns + c_brickSize - 1) / c_brickSize;
+  unsigned int x0 = static_cast<unsigned int>(_brick % bricksX * c_brickSize);
+  unsigned int y0 = static_cast<unsigned int>(_brick / bricksX % bricksY * c_brickSize);
+  unsigned int z0 = static_cast<unsigned int>(_brick / (bricksX * bricksY) * c_brickSize);
+  // Cubes start on every point but the last along each axis
+  unsigned int x1 = std::min(x0 + static_cast<unsigned int>(c_brickSize), m_pointsPerRow - 1);
+  unsigned int y1 = std::min(y0 + static_cast<unsigned int>(c_brickSize), m_columns - 1);
+  unsigned int z1 = std::min(z0 + static_cast<unsigned int>(c_brickSize), m_layers - 1);
+
+  // The brick's points are copied out once, then its cubes and gradients all read the copy
+  // Gradients also reach the point either side of the brick's cubes
+  using T = typename Source::VoxelType;
+  std::array<unsigned int, 3> first = {x0, y0, z0};
+  std::array<unsigned int, 3> last = {x1, y1, z1};
+  if (m_gradientNormals)
+  {
+    first = {x0 > 0 ? x0 - 1 : 0, y0 > 0 ? y0 - 1 : 0, z0 > 0 ? z0 - 1 : 0};
+    last = {std::min(x1 + 1, m_pointsPerRow - 1), std::min(y1 + 1, m_columns - 1), std::min(z1 + 1, m_layers - 1)};
+  }
+  Volume<T> points(last[0] - first[0] + 1, last[1] - first[1] + 1, last[2] - first[2] + 1);
+  for (unsigned int z = first[2]; z <= last[2]; ++z)
+  {
+    for (unsigned int y = first[1]; y <= last[1]; ++y)
+    {
+      for (unsigned int x = first[0]; x <= last[0]; ++x)
+      {
+        points.At(x - first[0], y - first[1], z - first[2]) = _source.At(x, y, z);
+      }
+    }
+  }
+  VolumeWindow<T> window{points.View(), first[0], first[1], first[2]};
 
-            case 8:
+  // Vertex made on each edge of the brick's cubes, indexed by its first point and axis
+  std::array<uint32_t, c_brickEdges> cache;
+  cache.fill(c_noVertex);
+  for (unsigned int z = z0; z < z1; ++z)
+  {
+    for (unsigned int y = y0; y < y1; ++y)
+    {
+      for (unsigned int x = x0; x < x1; ++x)
+      {
+        unsigned int cubeIndex = CubeIndex(window, x, y, z);
+        const std::array<int8_t, 16> &edges = Table::Edges(cubeIndex);
+        unsigned int edgeCount = Table::TriangleCount(cubeIndex) * 3;
+        for (unsigned int i = 0; i < edgeCount; ++i)
+        {
+          const EdgePlace &place = c_edgePlaces[edges[i]];
+          size_t point = ((z - z0 + place.top) * c_brickPoints + y - y0 + place.dy) * c_brickPoints + x - x0 + place.dx;
+          uint32_t &vertex = cache[point * 3 + place.axis];
+          if (vertex == c_noVertex)
+          {
+            vertex = static_cast<uint32_t>(mesh.vertices.size());
+            mesh.vertices.push_back(EdgeVertex(x, y, z, static_cast<unsigned int>(edges[i])));
+            if (m_gradientNormals)
             {
-              ngl::Vec3 e8 = {static_cast<ngl::Real>((p0_index % m_pointsPerRow) * m_sampleResolution) - m_imageWidth / 2.0f,
-                              static_cast<ngl::Real>((p0_index / m_pointsPerRow) * m_sampleResolution) - m_imageHeight / 2.0f,
-                              static_cast<ngl::Real>((z * m_sampleResolution) + m_offset) - (m_pointData.size() * (m_sampleResolution / 2.0f))};
-              e8 *= m_meshScale;
-              m_vertexData.push_back(e8);
-              break;
+              mesh.normals.push_back(EdgeNormal(window, x, y, z, static_cast<unsigned int>(edges[i])));
             }
-
-            case 9:
+            // Cubes of another brick also reach an edge on a brick boundary across either other axis
+            std::array<unsigned int, 3> start = {x + place.dx, y + place.dy, z + static_cast<unsigned int>(place.top)};
+            bool shared = false;
+            for (unsigned int axis = 0; axis < 3; ++axis)
             {
-              ngl::Vec3 e9 = {static_cast<ngl::Real>((p1_index % m_pointsPerRow) * m_sampleResolution) - m_imageWidth / 2.0f,
-                              static_cast<ngl::Real>((p1_index / m_pointsPerRow) * m_sampleResolution) - m_imageHeight / 2.0f,
-                              static_cast<ngl::Real>((z * m_sampleResolution) + m_offset) - (m_pointData.size() * (m_sampleResolution / 2.0f))};
-              e9 *= m_meshScale;
-              m_vertexData.push_back(e9);
-              break;
+              shared = shared || (axis != place.axis && start[axis] % c_brickSize == 0);
             }
-
-            case 10:
+            if (shared)
             {
-              ngl::Vec3 e10 = {static_cast<ngl::Real>((p2_index % m_pointsPerRow) * m_sampleResolution) - m_imageWidth / 2.0f,
-                               static_cast<ngl::Real>((p2_index / m_pointsPerRow) * m_sampleResolution) - m_imageHeight / 2.0f,
-                               static_cast<ngl::Real>((z * m_sampleResolution) + m_offset) - (m_pointData.size() * (m_sampleResolution / 2.0f))};
-              e10 *= m_meshScale;
-              m_vertexData.push_back(e10);
-              break;
+              size_t edge = ((static_cast<size_t>(start[2]) * m_columns + start[1]) * m_pointsPerRow + start[0]) * 3 + place.axis;
+              _out.seam.emplace_back(edge, vertex);
             }
+          }
+          mesh.indices.push_back(vertex);
+        }
+      }
+    }
+  }
+  std::sort(_out.seam.begin(), _out.seam.end());
+}
+
+template <typename Source>
+size_t Mesh::RemarchChunks(const Source &_source)
+{
+  if (m_pointsPerRow < 2 || m_columns < 2 || m_layers < 2)
+  {
+    return 0;
+  }
 
-            case 11:
+  std::vector<size_t> changed;
+  if (m_chunkMeshes.empty())
+  {
+    // First march, a chunk's span is that of its bricks' cubes, as in RemarchBricks()
+    size_t bricksX = (m_pointsPerRow + c_brickSize - 1) / c_brickSize;
+    size_t bricksY = (m_columns + c_brickSize - 1) / c_brickSize;
+    size_t bricksZ = (m_layers + c_brickSize - 1) / c_brickSize;
+    auto spans = CubeRanges(SourceRanges(_source), bricksX, bricksY, bricksZ);
+    constexpr size_t chunkBricks = c_chunkSize / c_brickSize;
+    for (size_t bz = 0; bz < bricksZ; bz += chunkBricks)
+    {
+      for (size_t by = 0; by < bricksY; by += chunkBricks)
+      {
+        for (size_t bx = 0; bx < bricksX; bx += chunkBricks)
+        {
+          // The last point along an axis starts no cubes
+          std::array<unsigned int, 3> first = {static_cast<unsigned int>(bx * c_brickSize), static_cast<unsigned int>(by * c_brickSize),
+                                               static_cast<unsigned int>(bz * c_brickSize)};
+          if (first[0] + 1 >= m_pointsPerRow || first[1] + 1 >= m_columns || first[2] + 1 >= m_layers)
+          {
+            continue;
+          }
+          std::pair<float, float> span = {static_cast<float>(spans[(bz * bricksY + by) * bricksX + bx].first),
+                                          static_cast<float>(spans[(bz * bricksY + by) * bricksX + bx].second)};
+          for (size_t z = bz; z < std::min(bz + chunkBricks, bricksZ); ++z)
+          {
+            for (size_t y = by; y < std::min(by + chunkBricks, bricksY); ++y)
             {
-              ngl::Vec3 e11 = {static_cast<ngl::Real>((p3_index % m_pointsPerRow) * m_sampleResolution) - m_imageWidth / 2.0f,
-                               static_cast<ngl::Real>((p3_index / m_pointsPerRow) * m_sampleResolution) - m_imageHeight / 2.0f,
-                               static_cast<ngl::Real>((z * m_sampleResolution) + m_offset) - (m_pointData.size() * (m_sampleResolution / 2.0f))};
-              e11 *= m_meshScale;
-              m_vertexData.push_back(e11);
-              break;
+              for (size_t x = bx; x < std::min(bx + chunkBricks, bricksX); ++x)
+              {
+                const auto &brick = spans[(z * bricksY + y) * bricksX + x];
+                span.first = std::min(span.first, static_cast<float>(brick.first));
+                span.second = std::max(span.second, static_cast<float>(brick.second));
+              }
             }
+          }
+          m_chunkFirsts.push_back(first);
+          m_chunkSpans.push_back(span);
+        }
+      }
+    }
+
+    m_chunkMeshes.resize(m_chunkFirsts.size());
+    for (size_t i = 0; i < m_chunkFirsts.size(); ++i)
+    {
+      const std::array<unsigned int, 3> &first = m_chunkFirsts[i];
+      ngl::Vec3 low = LatticePosition(static_cast<float>(first[0]), static_cast<float>(first[1]), static_cast<float>(first[2]));
+      ngl::Vec3 high = LatticePosition(static_cast<float>(std::min(first[0] + c_chunkSize, m_pointsPerRow - 1)),
+                                       static_cast<float>(std::min(first[1] + c_chunkSize, m_columns - 1)),
+                                       static_cast<float>(std::min(first[2] + c_chunkSize, m_layers - 1)));
+      m_chunkMeshes[i].centre = (low + high) * 0.5f;
+      m_chunkMeshes[i].radius = (high - low).length() * 0.5f;
+      if (m_chunkSpans[i].first < m_surfaceLevel && m_chunkSpans[i].second >= m_surfaceLevel)
+      {
+        changed.push_back(i);
+      }
+    }
+  }
+  else if (m_chunkLevel != m_surfaceLevel)
+  {
+    // As RemarchBricks(), a chunk without a value in [low, high) keeps every level
+    float low = static_cast<float>(std::min(m_chunkLevel, m_surfaceLevel));
+    float high = static_cast<float>(std::max(m_chunkLevel, m_surfaceLevel));
+    for (size_t i = 0; i < m_chunkSpans.size(); ++i)
+    {
+      if (m_chunkSpans[i].first < high && m_chunkSpans[i].second >= low)
+      {
+        changed.push_back(i);
+      }
+    }
+  }
+  m_chunkLevel = m_surfaceLevel;
+
+  // A chunk the surface has left loses its levels, the rest are marched again at every level
+  for (size_t chunk : changed)
+  {
+    bool active = m_chunkSpans[chunk].first < m_surfaceLevel && m_chunkSpans[chunk].second >= m_surfaceLevel;
+    m_chunkMeshes[chunk].levels.assign(active ? c_chunkLevels : 0, ChunkLevel());
+  }
+  // Every level of every chunk is independent
+  std::vector<std::vector<uint32_t>> caches(m_pool.GetThreadCount());
+  m_pool.ParallelFor(changed.size() * c_chunkLevels, [&](size_t _task, unsigned int _worker)
+  {
+    size_t chunk = changed[_task / c_chunkLevels];
+    if (!m_chunkMeshes[chunk].levels.empty())
+    {
+      MarchChunk(_source, m_chunkFirsts[chunk], static_cast<unsigned int>(_task % c_chunkLevels), caches[_worker],
+                 m_chunkMeshes[chunk].levels[_task % c_chunkLevels]);
+    }
+  });
+  return changed.size();
+}
+
+template <typename Source>
+void Mesh::MarchChunk(const Source &_source, const std::array<unsigned int, 3> &_first, unsigned int _level,
+                      std::vector<uint32_t> &_cache, ChunkLevel &_out) const
+{
+  _out = ChunkLevel();
+  // Every step'th point of the chunk along each axis, then the chunk's last point when the step overshoots it
+  unsigned int step = 1u << _level;
+  std::array<unsigned int, 3> last = {m_pointsPerRow - 1, m_columns - 1, m_layers - 1};
+  std::array<std::vector<unsigned int>, 3> points;
+  for (unsigned int axis = 0; axis < 3; ++axis)
+  {
+    unsigned int end = std::min(_first[axis] + c_chunkSize, last[axis]);
+    for (unsigned int point = _first[axis]; point < end; point += step)
+    {
+      points[axis].push_back(point);
+    }
+    points[axis].push_back(end);
+  }
+  const std::vector<unsigned int> &xs = points[0];
+  const std::vector<unsigned int> &ys = points[1];
+  const std::vector<unsigned int> &zs = points[2];
 
-            default:
+  // Vertex made on each edge of the level's lattice, indexed by its first point and axis
+  _cache.assign(xs.size() * ys.size() * zs.size() * 3, c_noVertex);
+  for (size_t k = 0; k + 1 < zs.size(); ++k)
+  {
+    for (size_t j = 0; j + 1 < ys.size(); ++j)
+    {
+      for (size_t i = 0; i + 1 < xs.size(); ++i)
+      {
+        // Same point order and bits as CubeIndex()
+        unsigned int cubeIndex = static_cast<unsigned int>(_source.At(xs[i], ys[j], zs[k]) >= m_surfaceLevel)
+                               | static_cast<unsigned int>(_source.At(xs[i + 1], ys[j], zs[k]) >= m_surfaceLevel) << 1
+                               | static_cast<unsigned int>(_source.At(xs[i + 1], ys[j + 1], zs[k]) >= m_surfaceLevel) << 2
+                               | static_cast<unsigned int>(_source.At(xs[i], ys[j + 1], zs[k]) >= m_surfaceLevel) << 3
+                               | static_cast<unsigned int>(_source.At(xs[i], ys[j], zs[k + 1]) >= m_surfaceLevel) << 4
+                               | static_cast<unsigned int>(_source.At(xs[i + 1], ys[j], zs[k + 1]) >= m_surfaceLevel) << 5
+                               | static_cast<unsigned int>(_source.At(xs[i + 1], ys[j + 1], zs[k + 1]) >= m_surfaceLevel) << 6
+                               | static_cast<unsigned int>(_source.At(xs[i], ys[j + 1], zs[k + 1]) >= m_surfaceLevel) << 7;
+        const std::array<int8_t, 16> &edges = Table::Edges(cubeIndex);
+        unsigned int edgeCount = Table::TriangleCount(cubeIndex) * 3;
+        for (unsigned int e = 0; e < edgeCount; ++e)
+        {
+          const EdgePlace &place = c_edgePlaces[edges[e]];
+          std::array<size_t, 3> start = {i + place.dx, j + place.dy, k + place.top};
+          uint32_t &vertex = _cache[((start[2] * ys.size() + start[1]) * xs.size() + start[0]) * 3 + place.axis];
+          if (vertex == c_noVertex)
+          {
+            // Midpoint of the edge, which may be shortened by the end of the volume
+            std::array<float, 3> mid = {static_cast<float>(xs[start[0]]), static_cast<float>(ys[start[1]]), static_cast<float>(zs[start[2]])};
+            mid[place.axis] = (mid[place.axis] + points[place.axis][start[place.axis] + 1]) * 0.5f;
+            vertex = static_cast<uint32_t>(_out.mesh.vertices.size());
+            _out.mesh.vertices.push_back(LatticePosition(mid[0], mid[1], mid[2]));
+            if (m_gradientNormals)
             {
-              break;
+              std::array<unsigned int, 3> a = {xs[start[0]], ys[start[1]], zs[start[2]]};
+              std::array<unsigned int, 3> b = a;
+              b[place.axis] = points[place.axis][start[place.axis] + 1];
+              _out.normals.push_back(CrossingNormal(_source, a, b, last, m_surfaceLevel));
             }
           }
+          _out.mesh.indices.push_back(vertex);
         }
       }
     }
   }
-  std::cout << "Cubes marched!\n";
-  return m_vertexData;
+
+  // A vertex can move up to half a cell from where the full resolution puts it
+  float voxel = m_sampleResolution * m_meshScale;
+  _out.error = (step - 1) * 0.5f * voxel;
+  _out.surfaceIndices = _out.mesh.indices.size();
+  if (!m_gradientNormals)
+  {
+    _out.normals = VertexNormals(_out.mesh, _out.surfaceIndices);
+  }
+  // A neighbour one level coarser or finer puts its seam within a cell of this one
+  AddSkirt(_out, step * voxel);
+}
+
+void Mesh::AddSkirt(ChunkLevel &_level, float _depth)
+{
+  IndexedMesh &mesh = _level.mesh;
+  size_t surfaceVertices = mesh.vertices.size();
+  // An edge is open when no triangle runs along it the other way
+  std::vector<std::pair<uint32_t, uint32_t>> edges;
+  edges.reserve(_level.surfaceIndices);
+  for (size_t i = 0; i + 2 < _level.surfaceIndices; i += 3)
+  {
+    for (size_t corner = 0; corner < 3; ++corner)
+    {
+      edges.emplace_back(mesh.indices[i + corner], mesh.indices[i + (corner + 1) % 3]);
+    }
+  }
+  std::vector<std::pair<uint32_t, uint32_t>> sorted = edges;
+  std::sort(sorted.begin(), sorted.end());
+
+  std::vector<uint32_t> hanging(surfaceVertices, c_noVertex);
+  auto hang = [&](uint32_t _vertex)
+  {
+    if (hanging[_vertex] == c_noVertex)
+    {
+      hanging[_vertex] = static_cast<uint32_t>(mesh.vertices.size());
+      // Normals point out, so the skirt goes into the solid where it is hidden from the chunk's own side
+      mesh.vertices.push_back(mesh.vertices[_vertex] - _level.normals[_vertex] * _depth);
+      _level.normals.push_back(_level.normals[_vertex]);
+    }
+    return hanging[_vertex];
+  };
+  for (const std::pair<uint32_t, uint32_t> &edge : edges)
+  {
+    if (std::binary_search(sorted.begin(), sorted.end(), std::make_pair(edge.second, edge.first)))
+    {
+      continue;
+    }
+    // Quad b a a' b' runs along the edge the other way to its triangle, so it winds the same way
+    uint32_t a = edge.first;
+    uint32_t b = edge.second;
+    uint32_t lowA = hang(a);
+    uint32_t lowB = hang(b);
+    uint32_t quad[6] = {b, a, lowA, b, lowA, lowB};
+    mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+  }
+}
+
+template <typename T, typename Layers>
+void Mesh::MarchSurfaceNets(const Layers &_layers, IndexedMesh &_mesh)
+{
+  unsigned int slabs = m_layers > 1 ? m_layers - 1 : 0;
+  if (slabs == 0 || m_pointsPerRow < 2 || m_columns < 2)
+  {
+    return;
+  }
+
+  // Count pass, as for the triangle soup, so vertices and quads land straight in buffers of the final size
+  std::vector<size_t> vertexOffsets(slabs + 1, 0);
+  std::vector<size_t> quadOffsets(slabs + 1, 0);
+  m_pool.ParallelFor(slabs, [&](size_t _z, unsigned int _worker)
+  {
+    unsigned int z = static_cast<unsigned int>(_z);
+    if (SlabActive(z))
+    {
+      Slab<T> slab = _layers(z, _worker);
+      ClassifySlab(slab.layerA, slab.layerB, z, [&](unsigned int _x, unsigned int _y, unsigned int _cubeIndex)
+      {
+        ++vertexOffsets[z + 1];
+        quadOffsets[z + 1] += NetQuads(_x, _y, z, _cubeIndex);
+      });
+    }
+  });
+  for (unsigned int z = 0; z < slabs; ++z)
+  {
+    vertexOffsets[z + 1] += vertexOffsets[z];
+    quadOffsets[z + 1] += quadOffsets[z];
+  }
+  _mesh.vertices.resize(vertexOffsets[slabs]);
+  _mesh.normals.resize(m_gradientNormals ? vertexOffsets[slabs] : 0);
+  _mesh.indices.resize(quadOffsets[slabs] * 6);
+
+  // Quads join the cells around an edge, which may be in this slab and the one below
+  // Each task keeps the vertex of every cell of the slab below, starting with the previous task's last slab
+  size_t cellsPerRow = m_pointsPerRow - 1;
+  size_t cellsPerLayer = cellsPerRow * (m_columns - 1);
+  unsigned int chunks = (slabs + c_indexedChunkSlabs - 1) / c_indexedChunkSlabs;
+  m_pool.ParallelFor(chunks, [&](size_t _chunk, unsigned int _worker)
+  {
+    unsigned int firstSlab = static_cast<unsigned int>(_chunk) * c_indexedChunkSlabs;
+    unsigned int endSlab = std::min(firstSlab + c_indexedChunkSlabs, slabs);
+    std::vector<uint32_t> below(cellsPerLayer, c_noVertex);
+    std::vector<uint32_t> current(cellsPerLayer, c_noVertex);
+    std::vector<NetCell> cells;
+
+    if (firstSlab > 0 && SlabActive(firstSlab - 1))
+    {
+      uint32_t next = static_cast<uint32_t>(vertexOffsets[firstSlab - 1]);
+      Slab<T> slab = _layers(firstSlab - 1, _worker);
+      ClassifySlab(slab.layerA, slab.layerB, firstSlab - 1, [&](unsigned int _x, unsigned int _y, unsigned int)
+      {
+        below[_y * cellsPerRow + _x] = next++;
+      });
+    }
+
+    for (unsigned int z = firstSlab; z < endSlab; ++z)
+    {
+      // Cells around a crossed edge are all crossed, so an inactive slab is never needed by the next
+      if (!SlabActive(z))
+      {
+        continue;
+      }
+      cells.clear();
+      Slab<T> slab = _layers(z, _worker);
+      ClassifySlab(slab.layerA, slab.layerB, z, [&](unsigned int _x, unsigned int _y, unsigned int _cubeIndex)
+      {
+        cells.push_back({_x, _y, _cubeIndex});
+      });
+
+      uint32_t next = static_cast<uint32_t>(vertexOffsets[z]);
+      for (const NetCell &cell : cells)
+      {
+        current[cell.y * cellsPerRow + cell.x] = next;
+        if (m_gradientNormals)
+        {
+          _mesh.normals[next] = NetNormal(slab.around, cell.x, cell.y, z, cell.cubeIndex);
+        }
+        _mesh.vertices[next++] = NetVertex(cell.x, cell.y, z, cell.cubeIndex);
+      }
+
+      // Edges leaving each cell's first point (p0), towards p1 (x), p3 (y) and p4 (z)
+      // Quads wind clockwise seen from outside, as the marching cubes triangles do
+      uint32_t *indices = _mesh.indices.data() + quadOffsets[z] * 6;
+      for (const NetCell &cell : cells)
+      {
+        unsigned int x = cell.x;
+        unsigned int y = cell.y;
+        size_t c = y * cellsPerRow + x;
+        bool inside = cell.cubeIndex & 1;
+        if (y > 0 && z > 0 && ((cell.cubeIndex >> 1) & 1) != inside)
+        {
+          indices = EmitQuad(below[c - cellsPerRow], below[c], current[c], current[c - cellsPerRow], !inside, indices);
+        }
+        if (x > 0 && z > 0 && ((cell.cubeIndex >> 3) & 1) != inside)
+        {
+          indices = EmitQuad(below[c - 1], current[c - 1], current[c], below[c], !inside, indices);
+        }
+        if (x > 0 && y > 0 && ((cell.cubeIndex >> 4) & 1) != inside)
+        {
+          indices = EmitQuad(current[c - cellsPerRow - 1], current[c - cellsPerRow], current[c], current[c - 1], !inside, indices);
+        }
+      }
+      std::swap(below, current);
+    }
+  });
+}
+
+unsigned int Mesh::NetQuads(unsigned int _x, unsigned int _y, unsigned int _z, unsigned int _cubeIndex) const
+{
+  // Only edges with a cell on all four sides make a quad
+  unsigned int inside = _cubeIndex & 1;
+  return static_cast<unsigned int>(_y > 0 && _z > 0 && ((_cubeIndex >> 1) & 1) != inside)
+       + static_cast<unsigned int>(_x > 0 && _z > 0 && ((_cubeIndex >> 3) & 1) != inside)
+       + static_cast<unsigned int>(_x > 0 && _y > 0 && ((_cubeIndex >> 4) & 1) != inside);
+}
+
+ngl::Vec3 Mesh::NetVertex(unsigned int _x, unsigned int _y, unsigned int _z, unsigned int _cubeIndex) const
+{
+  ngl::Vec3 sum(0.0f, 0.0f, 0.0f);
+  unsigned int count = 0;
+  for (unsigned int edges = Table::CutEdges(_cubeIndex); edges != 0; edges &= edges - 1)
+  {
+    unsigned int edge = 0;
+    while (((edges >> edge) & 1) == 0)
+    {
+      ++edge;
+    }
+    sum += EdgeVertex(_x, _y, _z, edge);
+    ++count;
+  }
+  return sum / static_cast<ngl::Real>(count);
+}
+
+template <typename Source>
+ngl::Vec3 Mesh::NetNormal(const Source &_source, unsigned int _x, unsigned int _y, unsigned int _z, unsigned int _cubeIndex) const
+{
+  ngl::Vec3 sum(0.0f, 0.0f, 0.0f);
+  for (unsigned int edges = Table::CutEdges(_cubeIndex); edges != 0; edges &= edges - 1)
+  {
+    unsigned int edge = 0;
+    while (((edges >> edge) & 1) == 0)
+    {
+      ++edge;
+    }
+    sum += EdgeNormal(_source, _x, _y, _z, edge);
+  }
+  if (sum.length() > 0.0f)
+  {
+    sum.normalize();
+  }
+  return sum;
+}
+
+bool Mesh::SlabActive(unsigned int _z) const
+{
+  if (m_activeBricks.empty())
+  {
+    return true;
+  }
+  auto first = m_activeBricks.begin() + (_z / c_brickSize) * m_bricksX * m_bricksY;
+  return std::find(first, first + m_bricksX * m_bricksY, 1) != first + m_bricksX * m_bricksY;
+}
+
+template <typename T, typename Emit>
+void Mesh::ClassifySlab(const VolumeView<T> &_layerA, const VolumeView<T> &_layerB, unsigned int _z, Emit &&_emit) const
+{
+  // Example:
+  // _layerA = 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16
+  // The layer actually represents a 4x4 grid of sampled points...
+  //     1  2  3  4
+  //     5  6  7  8
+  //     9 10 11 12
+  //    13 14 15 16
+  // Their are 9 total squares...
+  //    1 2   2 3   3 4   5  6    6  7    7  8    9 10   10 11   11 12
+  //    5 6   6 7   7 8   9 10   10 11   11 12   13 14   14 15   15 16
+  // Parallel squares from _layerA and _layerB create a cube...
+  unsigned int z = _z;
+  // Points must go clockwise so the cube index triangulates
+  // to match Bourkes (1994) triangulation table...
+  //    Layer A              Layer B
+  //    p0 -> p1             p4 -> p5
+  //          |            /       |
+  //          v          /         v
+  //    p3 <- p2  ... p3     p7 -> p6
+  // The top left point (p0) of each square is (x, y)
+  // Rows of adjacent 8-bit voxels are classified many cubes at a time, see CubeClassifier
+  bool unitStride = _layerA.GetStrideX() == 1 && _layerB.GetStrideX() == 1;
+  bool classifyRows = std::is_same_v<T, uint8_t> && unitStride;
+  std::vector<uint32_t> cubeX(classifyRows ? m_pointsPerRow : 0);
+  std::vector<uint8_t> cubeIndices(classifyRows ? m_pointsPerRow : 0);
+
+  for (unsigned int y = 0; y + 1 < m_columns; ++y)
+  {
+    const char *activeRow = m_activeBricks.empty() ? nullptr : &m_activeBricks[((z / c_brickSize) * m_bricksY + y / c_brickSize) * m_bricksX];
+    if (activeRow != nullptr && std::find(activeRow, activeRow + m_bricksX, 1) == activeRow + m_bricksX)
+    {
+      continue;
+    }
+
+    const std::array<const T *, 4> rows = {_layerA.Slice(0) + y * _layerA.GetStrideY(), _layerA.Slice(0) + (y + 1) * _layerA.GetStrideY(),
+                                           _layerB.Slice(0) + y * _layerB.GetStrideY(), _layerB.Slice(0) + (y + 1) * _layerB.GetStrideY()};
+    if constexpr (std::is_same_v<T, uint8_t>)
+    {
+      if (classifyRows)
+      {
+        // Only cubes the surface passes through come back, so skipped bricks need no check
+        const uint8_t *rowPointers[4] = {rows[0], rows[1], rows[2], rows[3]};
+        size_t active = CubeClassifier::ClassifyRow(rowPointers, m_pointsPerRow, m_surfaceLevel, cubeX.data(), cubeIndices.data());
+        for (size_t i = 0; i < active; ++i)
+        {
+          _emit(cubeX[i], y, cubeIndices[i]);
+        }
+        continue;
+      }
+    }
+
+    if (unitStride)
+    {
+      ClassifyRow<true>(rows, 1, 1, y, activeRow, _emit);
+    }
+    else
+    {
+      ClassifyRow<false>(rows, _layerA.GetStrideX(), _layerB.GetStrideX(), y, activeRow, _emit);
+    }
+  }
+}
+
+template <bool UnitStride, typename T, typename Emit>
+void Mesh::ClassifyRow(const std::array<const T *, 4> &_rows, size_t _strideA, size_t _strideB, unsigned int _y, const char *_activeRow, Emit &_emit) const
+{
+  // Whether each of the four points at _x is inside the surface, row n in bit n
+  auto column = [&](unsigned int _x)
+  {
+    size_t offsetA = UnitStride ? _x : _x * _strideA;
+    size_t offsetB = UnitStride ? _x : _x * _strideB;
+    return static_cast<unsigned int>(_rows[0][offsetA] >= m_surfaceLevel)
+         | static_cast<unsigned int>(_rows[1][offsetA] >= m_surfaceLevel) << 1
+         | static_cast<unsigned int>(_rows[2][offsetB] >= m_surfaceLevel) << 2
+         | static_cast<unsigned int>(_rows[3][offsetB] >= m_surfaceLevel) << 3;
+  };
+
+  // Neighbouring cubes share a face, so each column of points is read once
+  unsigned int left = column(0);
+  for (unsigned int x = 0; x + 1 < m_pointsPerRow; ++x)
+  {
+    // Jump to the first cube of the next brick
+    if (_activeRow != nullptr && !_activeRow[x / c_brickSize])
+    {
+      x |= static_cast<unsigned int>(c_brickSize - 1);
+      if (x + 1 < m_pointsPerRow)
+      {
+        left = column(x + 1);
+      }
+      continue;
+    }
+
+    unsigned int right = column(x + 1);
+    _emit(x, _y, LeftCorners(left) | RightCorners(right));
+    left = right;
+  }
+}
+
+template <typename T>
+size_t Mesh::CountSlab(const VolumeView<T> &_layerA, const VolumeView<T> &_layerB, unsigned int _z) const
+{
+  size_t count = 0;
+  ClassifySlab(_layerA, _layerB, _z, [&](unsigned int, unsigned int, unsigned int _cubeIndex)
+  {
+    count += Table::TriangleCount(_cubeIndex) * 3;
+  });
+  return count;
+}
+
+template <typename T, typename Source>
+void Mesh::MarchSlab(const VolumeView<T> &_layerA, const VolumeView<T> &_layerB, unsigned int _z, const Source &_around,
+                     ngl::Vec3 *_vertices, ngl::Vec3 *_normals) const
+{
+  ngl::Vec3 *next = _vertices;
+  ClassifySlab(_layerA, _layerB, _z, [&](unsigned int _x, unsigned int _y, unsigned int _cubeIndex)
+  {
+    // Each normal is found while the cube's voxels are still in cache, from the layers the worker already holds
+    if (_normals != nullptr)
+    {
+      const std::array<int8_t, 16> &edges = Table::Edges(_cubeIndex);
+      ngl::Vec3 *normal = _normals + (next - _vertices);
+      for (unsigned int i = 0; i < Table::TriangleCount(_cubeIndex) * 3; ++i)
+      {
+        *normal++ = EdgeNormal(_around, _x, _y, _z, static_cast<unsigned int>(edges[i]));
+      }
+    }
+    next = EmitCube(_x, _y, _z, _cubeIndex, next);
+  });
+}
+
+template <typename Source>
+unsigned int Mesh::CubeIndex(const Source &_source, unsigned int _x, unsigned int _y, unsigned int _z) const
+{
+  // Same point order and bits as ClassifySlab()
+  return static_cast<unsigned int>(_source.At(_x, _y, _z) >= m_surfaceLevel)
+       | static_cast<unsigned int>(_source.At(_x + 1, _y, _z) >= m_surfaceLevel) << 1
+       | static_cast<unsigned int>(_source.At(_x + 1, _y + 1, _z) >= m_surfaceLevel) << 2
+       | static_cast<unsigned int>(_source.At(_x, _y + 1, _z) >= m_surfaceLevel) << 3
+       | static_cast<unsigned int>(_source.At(_x, _y, _z + 1) >= m_surfaceLevel) << 4
+       | static_cast<unsigned int>(_source.At(_x + 1, _y, _z + 1) >= m_surfaceLevel) << 5
+       | static_cast<unsigned int>(_source.At(_x + 1, _y + 1, _z + 1) >= m_surfaceLevel) << 6
+       | static_cast<unsigned int>(_source.At(_x, _y + 1, _z + 1) >= m_surfaceLevel) << 7;
+}
+
+ngl::Vec3 *Mesh::EmitCube(unsigned int _x, unsigned int _y, unsigned int _z, unsigned int _cubeIndex, ngl::Vec3 *_vertices) const
+{
+  // Edges that need to be connected, three per triangle
+  const std::array<int8_t, 16> &edges = Table::Edges(_cubeIndex);
+  unsigned int edgeCount = Table::TriangleCount(_cubeIndex) * 3;
+  for (unsigned int i = 0; i < edgeCount; ++i)
+  {
+    *_vertices++ = EdgeVertex(_x, _y, _z, static_cast<unsigned int>(edges[i]));
+  }
+  return _vertices;
+}
+
+ngl::Vec3 Mesh::EdgeVertex(unsigned int _x, unsigned int _y, unsigned int _z, unsigned int _edge) const
+{
+  // Each coordinate is either a point's or, along the edge's own axis, the midpoint after it
+  const CubeEdge &edge = c_cubeEdges[_edge];
+  std::array<unsigned int, 3> point = {_x + edge.x, _y + edge.y, _z + edge.z};
+  std::array<float, 3> position;
+  for (unsigned int axis = 0; axis < 3; ++axis)
+  {
+    position[axis] = axis == edge.axis ? m_midpointCoordinates[axis][point[axis]] : m_pointCoordinates[axis][point[axis]];
+  }
+  return ngl::Vec3(position[0], position[1], position[2]);
+}
+
+template <typename Source>
+ngl::Vec3 Mesh::EdgeNormal(const Source &_source, unsigned int _x, unsigned int _y, unsigned int _z, unsigned int _edge) const
+{
+  const EdgePlace &place = c_edgePlaces[_edge];
+  std::array<unsigned int, 3> a = {_x + place.dx, _y + place.dy, _z + static_cast<unsigned int>(place.top)};
+  std::array<unsigned int, 3> b = a;
+  ++b[place.axis];
+  return CrossingNormal(_source, a, b, {m_pointsPerRow - 1, m_columns - 1, m_layers - 1}, m_surfaceLevel);
+}
+
+ngl::Vec3 Mesh::LatticePosition(float _x, float _y, float _z) const
+{
+  // As EdgeVertex(), which puts the point (x, y, z) at these coordinates before the midpoint offset
+  ngl::Vec3 position = {_x * m_sampleResolution - m_imageWidth / 2.0f,
+                        _y * m_sampleResolution - m_imageHeight / 2.0f,
+                        _z * m_sampleResolution - (m_centreLayers * (m_sampleResolution / 2.0f))};
+  return position * m_meshScale + m_originOffset;
+}
+
+void Mesh::GetBounds(ngl::Vec3 &_minimum, ngl::Vec3 &_maximum) const
+{
+  // Skirts of the coarsest chunk level hang one of its cells past the lattice
+  float skirt = (1u << (c_chunkLevels - 1)) * m_sampleResolution * m_meshScale;
+  ngl::Vec3 margin(skirt, skirt, skirt);
+  _minimum = LatticePosition(0.0f, 0.0f, 0.0f) - margin;
+  _maximum = LatticePosition(static_cast<float>(m_pointsPerRow - 1), static_cast<float>(m_columns - 1),
+                             static_cast<float>(m_layers - 1)) + margin;
+}
+
+void Mesh::SetOrigin(float _x, float _y, float _z, unsigned int _totalLayers)
+{
+  m_originOffset = ngl::Vec3(_x, _y, _z) * m_meshScale;
+  m_centreLayers = _totalLayers;
+  // Per axis terms of every edge vertex, worked out once rather than for each vertex
+  std::array<unsigned int, 3> points = {m_pointsPerRow, m_columns, m_layers};
+  std::array<float, 3> centre = {m_imageWidth / 2.0f, m_imageHeight / 2.0f, m_centreLayers * (m_sampleResolution / 2.0f)};
+  std::array<float, 3> origin = {m_originOffset.m_x, m_originOffset.m_y, m_originOffset.m_z};
+  for (unsigned int axis = 0; axis < 3; ++axis)
+  {
+    m_pointCoordinates[axis].resize(points[axis]);
+    m_midpointCoordinates[axis].resize(points[axis]);
+    for (unsigned int i = 0; i < points[axis]; ++i)
+    {
+      m_pointCoordinates[axis][i] = (static_cast<float>(i * m_sampleResolution) - centre[axis]) * m_meshScale + origin[axis];
+      m_midpointCoordinates[axis][i] = (static_cast<float>((i * m_sampleResolution) + m_offset) - centre[axis]) * m_meshScale + origin[axis];
+    }
+  }
+  // Kept incremental meshes were made for other data or another placement
+  m_brickMeshes.clear();
+  m_brickSpans.clear();
+  m_chunkMeshes.clear();
+  m_chunkFirsts.clear();
+  m_chunkSpans.clear();
+}
+
+void Mesh::SetGradientNormals(bool _normals)
+{
+  if (_normals != m_gradientNormals)
+  {
+    m_brickMeshes.clear();
+    m_brickSpans.clear();
+    m_chunkMeshes.clear();
+    m_chunkFirsts.clear();
+    m_chunkSpans.clear();
+  }
+  m_gradientNormals = _normals;
 }
 
 void Mesh::SetSurfaceLevel(int _surfaceLevel)
 {
-  if (_surfaceLevel < 0)
+  if (_surfaceLevel < m_minSurfaceLevel)
   {
-    ErrorMessage("SURFACE LEVEL ERROR", "Surface level is too small.", "The minimum surface level is: 0");
+    ErrorMessage("SURFACE LEVEL ERROR", "Surface level is too small.", "The minimum surface level is: " + std::to_string(m_minSurfaceLevel));
   }
-  else if (_surfaceLevel > 255)
+  else if (_surfaceLevel > m_maxSurfaceLevel)
   {
-    ErrorMessage("SURFACE LEVEL ERROR", "Surface level is too large.", "The maximum surface level is: 255");
+    ErrorMessage("SURFACE LEVEL ERROR", "Surface level is too large.", "The maximum surface level is: " + std::to_string(m_maxSurfaceLevel));
   }
   else
   {
@@ -274,6 +1507,18 @@ void Mesh::SetSurfaceLevel(int _surfaceLevel)
   }
 }
 
+void Mesh::SetSurfaceLevelRange(int _minimum, int _maximum)
+{
+  m_minSurfaceLevel = _minimum;
+  m_maxSurfaceLevel = _maximum;
+  m_surfaceLevel = std::clamp(m_surfaceLevel, m_minSurfaceLevel, m_maxSurfaceLevel);
+}
+
+void Mesh::SetThreadCount(unsigned int _threads)
+{
+  m_pool.SetThreadCount(_threads);
+}
+
 void Mesh::ErrorMessage(std::string _type, std::string _line1, std::string _line2)
 {
   std::cout << "==============================================\n"
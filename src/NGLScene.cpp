@@ -8,10 +8,16 @@
 #include <ngl/NGLInit.h>
 #include <ngl/NGLStream.h>
 #include <ngl/ShaderLib.h>
+#include <ngl/SimpleIndexVAO.h>
 #include <ngl/SimpleVAO.h>
+#include <ngl/Util.h>
 #include <ngl/VAOFactory.h>
 #include <ngl/VAOPrimitives.h>
+#include <ngl/Vec4.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
 #include <fstream>
 #include <fmt/format.h>
 #include <iostream>
@@ -30,6 +36,11 @@ NGLScene::NGLScene(QWidget *_parent) : QOpenGLWidget(_parent)
   m_fpsCamera.Initialise(m_win.width, m_win.height, 1);
   m_staticCamera.Initialise(m_win.width, m_win.height, 0);
 
+  // Sampled images are reused between sessions
+  m_stack.SetCacheDirectory(VolumeCache::DefaultDirectory());
+  // Smooth normals come from the volume as the mesh is marched, ready for the VAO
+  m_mesh.SetGradientNormals(true);
+
   // Initialise update timers
   m_cameraTimer = startTimer(2);
   m_redrawTimer = startTimer(20);
@@ -42,6 +53,7 @@ NGLScene::~NGLScene()
   {
     m_vao->removeVAO();
   }
+  RemoveChunkVAOs();
 }
 
 void NGLScene::resizeGL(int _w , int _h)
@@ -175,9 +187,16 @@ void NGLScene::paintGL()
   if (m_builtVAO)
   {
     glFrontFace(GL_CW);   // Change winding order of m_vao to flip front face to point out
-    m_vao->bind();
-    m_vao->draw();
-    m_vao->unbind();
+    if (!m_chunkVAOs.empty())
+    {
+      DrawChunks();
+    }
+    else if (m_vao != nullptr)
+    {
+      m_vao->bind();
+      m_vao->draw();
+      m_vao->unbind();
+    }
   }
 }
 
@@ -277,34 +296,188 @@ void NGLScene::BuildVAO()
   {
     m_vao->removeVAO();
   }
-
-  std::cout << "Building VAO...\n";
-  int verticesEnd = m_vertexData.size();
-  std::cout << "Calculating Normals...\n";
-  for (int i = 0; i < m_vertexData.size() - 3; i += 3)
+  RemoveChunkVAOs();
+  if (!m_chunks.empty())
+  {
+    BuildChunkVAOs();
+    return;
+  }
+  if (!m_packedMesh.vertices.empty())
   {
-    ngl::Vec3 normal = ngl::calcNormal(m_vertexData[i], m_vertexData[i + 1], m_vertexData[i + 2]);
-    m_normals.push_back(normal);
-    m_normals.push_back(normal);
-    m_normals.push_back(normal);
+    std::cout << "Building VAO...\n";
+    LoadVertexFormatToShader(true, m_packedMesh.minimum, m_packedMesh.extent);
+    m_vao = PackedVAO(m_packedMesh);
+    std::cout << "VAO built!\n";
+    return;
   }
-  std::cout << "Normals calculated!\n";
-  std::cout << "Tranferring normals...\n";
-  for (int i = 0; i < m_normals.size(); ++i)
+  LoadVertexFormatToShader(false);
+  if (!m_indexedMesh.indices.empty())
   {
-    m_vertexData.push_back(m_normals[i]);
+    BuildIndexedVAO();
+    return;
   }
-  std::cout << "Normals transferred!\n";
+
+  std::cout << "Building VAO...\n";
+  // Marching put a normal per vertex after all the vertices, the layout the VAO reads
+  size_t verticesEnd = m_vertexData.size() / 2;
   m_vao = ngl::VAOFactory::createVAO(ngl::simpleVAO, GL_TRIANGLES);
   m_vao->bind();
   m_vao->setData(ngl::SimpleVAO::VertexData(m_vertexData.size() * sizeof(ngl::Vec3), m_vertexData[0].m_x));
   m_vao->setVertexAttributePointer(0, 3, GL_FLOAT, 0, 0);   // Vertices
   m_vao->setVertexAttributePointer(1, 3, GL_FLOAT, 0, verticesEnd * 3);   // Normals
-  m_vao->setNumIndices(m_vertexData.size() / 2);
+  m_vao->setNumIndices(verticesEnd);
   m_vao->unbind();
   std::cout << "VAO built!\n";
 }
 
+void NGLScene::BuildIndexedVAO()
+{
+  std::cout << "Building VAO...\n";
+  if (m_indexedMesh.normals.size() == m_indexedMesh.vertices.size())
+  {
+    m_vao = IndexedVAO(m_indexedMesh.vertices, m_indexedMesh.normals, m_indexedMesh.indices);
+  }
+  else
+  {
+    std::cout << "Calculating Normals...\n";
+    // Shared vertices average the normals of the triangles around them
+    m_normals = VertexNormals(m_indexedMesh, m_indexedMesh.indices.size());
+    std::cout << "Normals calculated!\n";
+    m_vao = IndexedVAO(m_indexedMesh.vertices, m_normals, m_indexedMesh.indices);
+  }
+  std::cout << "VAO built!\n";
+}
+
+void NGLScene::BuildChunkVAOs()
+{
+  std::cout << "Building chunk VAOs...\n";
+  // Every chunk is packed into the same box, so one set of uniforms serves them all
+  ngl::Vec3 minimum;
+  ngl::Vec3 maximum;
+  m_mesh.GetBounds(minimum, maximum);
+  LoadVertexFormatToShader(m_compactVertices, minimum, maximum - minimum);
+  m_chunkVAOs.resize(m_chunks.size() * Mesh::c_chunkLevels);
+  for (size_t i = 0; i < m_chunks.size(); ++i)
+  {
+    for (unsigned int level = 0; level < Mesh::c_chunkLevels; ++level)
+    {
+      const ChunkLevel &lod = m_chunks[i].levels[level];
+      if (!lod.mesh.indices.empty())
+      {
+        m_chunkVAOs[i * Mesh::c_chunkLevels + level] = m_compactVertices
+                                                       ? PackedVAO(PackMesh(lod.mesh.vertices, lod.normals, lod.mesh.indices, minimum, maximum))
+                                                       : IndexedVAO(lod.mesh.vertices, lod.normals, lod.mesh.indices);
+      }
+    }
+  }
+  std::cout << "Chunk VAOs built!\n";
+}
+
+void NGLScene::RemoveChunkVAOs()
+{
+  for (std::unique_ptr<ngl::AbstractVAO> &vao : m_chunkVAOs)
+  {
+    if (vao != nullptr)
+    {
+      vao->removeVAO();
+    }
+  }
+  m_chunkVAOs.clear();
+}
+
+// Largest error, in pixels, a chunk may be drawn with
+constexpr float c_maxPixelError = 1.0f;
+
+void NGLScene::DrawChunks()
+{
+  Camera &camera = m_camera == 1 ? m_fpsCamera : m_staticCamera;
+  // Pixels spanned by a length of one unit, one unit in front of the camera
+  float pixelsPerUnit = m_win.height / (2.0f * std::tan(ngl::radians(camera.GetFov()) * 0.5f));
+  float scale = std::max({m_scale.m_x, m_scale.m_y, m_scale.m_z});
+  ngl::Mat4 model = m_transform.getMatrix();
+  for (size_t i = 0; i < m_chunks.size(); ++i)
+  {
+    const MeshChunk &chunk = m_chunks[i];
+    ngl::Vec4 centre = model * ngl::Vec4(chunk.centre.m_x, chunk.centre.m_y, chunk.centre.m_z, 1.0f);
+    // Nearest the chunk can be, the camera being inside it leaves the finest level
+    float distance = (ngl::Vec3(centre.m_x, centre.m_y, centre.m_z) - m_eye).length() - chunk.radius * scale;
+    unsigned int level = 0;
+    while (level + 1 < Mesh::c_chunkLevels && chunk.levels[level + 1].error * scale * pixelsPerUnit <= c_maxPixelError * distance)
+    {
+      ++level;
+    }
+    const std::unique_ptr<ngl::AbstractVAO> &vao = m_chunkVAOs[i * Mesh::c_chunkLevels + level];
+    if (vao != nullptr)
+    {
+      vao->bind();
+      vao->draw();
+      vao->unbind();
+    }
+  }
+}
+
+std::unique_ptr<ngl::AbstractVAO> NGLScene::IndexedVAO(const std::vector<ngl::Vec3> &_vertices, const std::vector<ngl::Vec3> &_normals,
+                                                       const std::vector<uint32_t> &_indices)
+{
+  if (_vertices.empty() || _indices.empty())
+  {
+    return nullptr;
+  }
+  // Positions then normals, as for unindexed data, each copied straight from its own array
+  // The indices go up with an empty vertex buffer, which is then sized for both arrays
+  GLsizeiptr vertexBytes = static_cast<GLsizeiptr>(_vertices.size() * sizeof(ngl::Vec3));
+  GLsizeiptr normalBytes = static_cast<GLsizeiptr>(_normals.size() * sizeof(ngl::Vec3));
+  std::unique_ptr<ngl::AbstractVAO> vao = ngl::VAOFactory::createVAO(ngl::simpleIndexVAO, GL_TRIANGLES);
+  vao->bind();
+  vao->setData(ngl::SimpleIndexVAO::VertexData(0, _vertices[0].m_x,
+                                               static_cast<unsigned int>(_indices.size()), _indices.data(), GL_UNSIGNED_INT));
+  glBindBuffer(GL_ARRAY_BUFFER, vao->getBufferID(0));
+  glBufferData(GL_ARRAY_BUFFER, vertexBytes + normalBytes, nullptr, GL_STATIC_DRAW);
+  glBufferSubData(GL_ARRAY_BUFFER, 0, vertexBytes, _vertices.data());
+  glBufferSubData(GL_ARRAY_BUFFER, vertexBytes, normalBytes, _normals.data());
+  vao->setVertexAttributePointer(0, 3, GL_FLOAT, 0, 0);   // Vertices
+  vao->setVertexAttributePointer(1, 3, GL_FLOAT, 0, _vertices.size() * 3);   // Normals
+  vao->setNumIndices(_indices.size());
+  vao->unbind();
+  return vao;
+}
+
+std::unique_ptr<ngl::AbstractVAO> NGLScene::PackedVAO(const PackedMesh &_mesh)
+{
+  // Interleaved, positions as normalised unsigned shorts and normals as normalised shorts
+  GLsizei stride = sizeof(PackedVertex);
+  const float *data = reinterpret_cast<const float *>(_mesh.vertices.data());
+  std::unique_ptr<ngl::AbstractVAO> vao;
+  if (_mesh.indices.empty())
+  {
+    vao = ngl::VAOFactory::createVAO(ngl::simpleVAO, GL_TRIANGLES);
+    vao->bind();
+    vao->setData(ngl::SimpleVAO::VertexData(_mesh.vertices.size() * sizeof(PackedVertex), *data));
+    vao->setNumIndices(_mesh.vertices.size());
+  }
+  else
+  {
+    vao = ngl::VAOFactory::createVAO(ngl::simpleIndexVAO, GL_TRIANGLES);
+    vao->bind();
+    vao->setData(ngl::SimpleIndexVAO::VertexData(_mesh.vertices.size() * sizeof(PackedVertex), *data,
+                                                 static_cast<unsigned int>(_mesh.indices.size()), _mesh.indices.data(), GL_UNSIGNED_INT));
+    vao->setNumIndices(_mesh.indices.size());
+  }
+  // Offsets are counted in floats
+  vao->setVertexAttributePointer(0, 3, GL_UNSIGNED_SHORT, stride, 0, true);   // Vertices
+  vao->setVertexAttributePointer(1, 2, GL_SHORT, stride, offsetof(PackedVertex, normal) / sizeof(float), true);   // Normals
+  vao->unbind();
+  return vao;
+}
+
+void NGLScene::LoadVertexFormatToShader(bool _packed, const ngl::Vec3 &_minimum, const ngl::Vec3 &_extent)
+{
+  ngl::ShaderLib::use(shaderProgram);
+  ngl::ShaderLib::setUniform("packedVertices", _packed ? 1 : 0);
+  ngl::ShaderLib::setUniform("boundsMinimum", _minimum);
+  ngl::ShaderLib::setUniform("boundsExtent", _extent);
+}
+
 void NGLScene::ExportToOBJ(std::string _exportPath, std::string _fileName)
 {
   std::cout << "Exporting mesh to .obj file...\n";
@@ -312,12 +485,47 @@ void NGLScene::ExportToOBJ(std::string _exportPath, std::string _fileName)
   file.open(fmt::format(_exportPath + _fileName + ".obj"));
   std::stringstream ss;
 
-  for (int i = 0; i < (m_vertexData.size() / 2) - 3; i += 3)    // Don't want to write normals, only vertices
+  // Packed vertices are decoded, as close to the marched ones as the GPU draws them
+  if (!m_packedMesh.vertices.empty())
   {
-    ss << "v " << m_vertexData[i].m_x << " " << m_vertexData[i].m_y << " " << m_vertexData[i].m_z << " \n";
-    ss << "v " << m_vertexData[i + 1].m_x << " " << m_vertexData[i + 1].m_y << " " << m_vertexData[i + 1].m_z << " \n";
-    ss << "v " << m_vertexData[i + 2].m_x << " " << m_vertexData[i + 2].m_y << " " << m_vertexData[i + 2].m_z << " \n";
-    ss << "f -1 -2 -3\n\n";   // Reverse face order from "-3 -2 -1", to flip front face to point out
+    for (size_t i = 0; i < m_packedMesh.vertices.size(); ++i)
+    {
+      ngl::Vec3 vertex = m_packedMesh.Position(i);
+      ss << "v " << vertex.m_x << " " << vertex.m_y << " " << vertex.m_z << " \n";
+    }
+    const std::vector<uint32_t> &indices = m_packedMesh.indices;
+    for (size_t i = 0; i + 2 < (indices.empty() ? m_packedMesh.vertices.size() : indices.size()); i += 3)
+    {
+      // Reversed, to flip front face to point out
+      size_t a = indices.empty() ? i : indices[i];
+      size_t b = indices.empty() ? i + 1 : indices[i + 1];
+      size_t c = indices.empty() ? i + 2 : indices[i + 2];
+      ss << "f " << c + 1 << " " << b + 1 << " " << a + 1 << "\n";
+    }
+  }
+  // Shared vertices are written once, faces index them from 1
+  else if (!m_indexedMesh.indices.empty())
+  {
+    for (const ngl::Vec3 &vertex : m_indexedMesh.vertices)
+    {
+      ss << "v " << vertex.m_x << " " << vertex.m_y << " " << vertex.m_z << " \n";
+    }
+    const std::vector<uint32_t> &indices = m_indexedMesh.indices;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3)
+    {
+      // Reversed, to flip front face to point out
+      ss << "f " << indices[i + 2] + 1 << " " << indices[i + 1] + 1 << " " << indices[i] + 1 << "\n";
+    }
+  }
+  else
+  {
+    for (int i = 0; i < (m_vertexData.size() / 2) - 3; i += 3)    // Don't want to write normals, only vertices
+    {
+      ss << "v " << m_vertexData[i].m_x << " " << m_vertexData[i].m_y << " " << m_vertexData[i].m_z << " \n";
+      ss << "v " << m_vertexData[i + 1].m_x << " " << m_vertexData[i + 1].m_y << " " << m_vertexData[i + 1].m_z << " \n";
+      ss << "v " << m_vertexData[i + 2].m_x << " " << m_vertexData[i + 2].m_y << " " << m_vertexData[i + 2].m_z << " \n";
+      ss << "f -1 -2 -3\n\n";   // Reverse face order from "-3 -2 -1", to flip front face to point out
+    }
   }
 
   file << ss.rdbuf();
@@ -334,8 +542,48 @@ void NGLScene::ErrorMessage(std::string _type, std::string _line1, std::string _
             << "==============================================\n";
 }
 
+void NGLScene::DecimateMesh()
+{
+  if (m_decimation >= 100 || m_indexedMesh.indices.empty())
+  {
+    return;
+  }
+  size_t triangles = m_indexedMesh.indices.size() / 3;
+  std::cout << "Decimating " << triangles << " triangles to " << m_decimation << "%...\n";
+  m_indexedMesh = m_decimator.Simplify(m_indexedMesh, triangles * static_cast<size_t>(m_decimation) / 100);
+  std::cout << "Decimated to " << m_indexedMesh.indices.size() / 3 << " triangles\n";
+}
+
+void NGLScene::CompactMesh()
+{
+  m_packedMesh = PackedMesh();
+  if (!m_compactVertices || (m_indexedMesh.indices.empty() && m_vertexData.empty()))
+  {
+    return;
+  }
+  ngl::Vec3 minimum;
+  ngl::Vec3 maximum;
+  m_mesh.GetBounds(minimum, maximum);
+  if (!m_indexedMesh.indices.empty())
+  {
+    if (m_indexedMesh.normals.size() != m_indexedMesh.vertices.size())
+    {
+      m_indexedMesh.normals = VertexNormals(m_indexedMesh, m_indexedMesh.indices.size());
+    }
+    m_packedMesh = PackMesh(m_indexedMesh.vertices, m_indexedMesh.normals, m_indexedMesh.indices, minimum, maximum);
+  }
+  else
+  {
+    m_packedMesh = PackSoup(m_vertexData, minimum, maximum);
+  }
+  m_indexedMesh = IndexedMesh();
+  m_vertexData = std::vector<ngl::Vec3>();
+  std::cout << "Packed " << m_packedMesh.vertices.size() << " vertices into " << m_packedMesh.vertices.size() * sizeof(PackedVertex) << " bytes\n";
+}
+
 void NGLScene::readImages()
 {
+  m_canRemarch = false;
   m_stack.ReadImages(m_imagesPath);
 }
 
@@ -346,20 +594,68 @@ void NGLScene::checkImages()
 
 void NGLScene::sampleImages()
 {
+  // Voxels below the current surface level are background when cropping
+  m_stack.SetAutoCrop(m_autoCrop, m_mesh.GetSurfaceLevel());
+  m_cropped = m_autoCrop;
+  m_cropLevel = m_mesh.GetSurfaceLevel();
+  m_canRemarch = false;
   m_stack.SampleImages();
+  if (m_stack.CheckSampledImages())
+  {
+    // 16-bit data (such as CT in Hounsfield units) needs levels outside 0 to 255
+    std::pair<int, int> range = m_stack.GetValueRange();
+    m_mesh.SetSurfaceLevelRange(range.first, range.second);
+    emit surfaceLevelRangeChanged(range.first, range.second);
+  }
 }
 
 void NGLScene::marchCubes()
 {
-  if (m_stack.CheckSampledImages())
+  if (m_streaming && m_stack.CanStream())
+  {
+    m_vertexData.clear();   // Clear previous data
+    m_indexedMesh = IndexedMesh();
+    m_chunks.clear();
+    m_canRemarch = false;
+    // Streamed images are always 8-bit
+    m_mesh.SetSurfaceLevelRange(0, 255);
+    emit surfaceLevelRangeChanged(0, 255);
+    m_mesh.BeginStream(m_stack.GetSampledWidth(), m_stack.GetSampledHeight(), m_stack.GetSampledDepth(),
+                       m_stack.GetImageWidth(), m_stack.GetImageHeight(), m_stack.GetSampleResolution());
+    bool streamed = m_stack.StreamImages([this](const VolumeView<uint8_t> &_layer) { m_mesh.StreamLayer(_layer); });
+    m_vertexData = m_mesh.EndStream();
+    if (!streamed)
+    {
+      m_vertexData.clear();
+    }
+    CompactMesh();
+  }
+  else if (m_stack.CheckSampledImages())
   {
     m_vertexData.clear();   // Clear previous data
-    m_mesh.Initialise(m_stack.m_sampledPoints, m_stack.GetImageWidth(), m_stack.GetImageHeight(), m_stack.GetSampleResolution());
-    m_vertexData = m_mesh.MarchCubes();
+    if (const BrickVolume<uint8_t> *bricks = m_stack.GetBricks())
+    {
+      m_mesh.Initialise(*bricks, m_stack.GetImageWidth(), m_stack.GetImageHeight(), m_stack.GetSampleResolution());
+    }
+    else
+    {
+      m_mesh.Initialise(m_stack.GetVolume(), m_stack.GetImageWidth(), m_stack.GetImageHeight(), m_stack.GetSampleResolution());
+    }
+    VoxelBox box = m_stack.GetVolumeBox();
+    // Pyramid levels average blocks of points, so their points are centred within the blocks
+    float offset = m_stack.GetSampleOffset();
+    m_mesh.SetOrigin(static_cast<float>(box.x) + offset, static_cast<float>(box.y) + offset, static_cast<float>(box.z) + offset,
+                     m_stack.GetSampledDepth());
+    // Marching cubes keeps its mesh per brick, ready for the surface level to move
+    m_indexedMesh = m_mesh.GetEngine() == Mesh::Engine::MarchingCubes ? m_mesh.MarchCubesIncremental() : m_mesh.MarchCubesIndexed();
+    DecimateMesh();
+    m_chunks = m_chunked ? m_mesh.MarchChunks() : std::vector<MeshChunk>();
+    CompactMesh();
+    m_canRemarch = true;
   }
   else
   {
-    ErrorMessage("MARCHING CUBES ERROR", "Cannot run Marching Cubes algorithm.", "Images must first be read, checked and sampled.");
+    ErrorMessage("MARCHING CUBES ERROR", "Cannot run Marching Cubes algorithm.", "Images must first be read, checked and sampled (or only checked when streaming).");
   }
 }
 
@@ -367,7 +663,7 @@ void NGLScene::generateMesh()
 {
   if (!m_builtVAO)
   {
-    if (m_vertexData.size() > 0)
+    if (m_vertexData.size() > 0 || !m_indexedMesh.indices.empty() || !m_packedMesh.vertices.empty())
     {
       BuildVAO();
       m_builtVAO = true;
@@ -427,16 +723,48 @@ void NGLScene::setLightColour()
 
 void NGLScene::setSampleResolution(int _resolution)
 {
+  m_canRemarch = false;
   m_stack.SetSampleResolution(_resolution);
   update();
 }
 
 void NGLScene::setSurfaceLevel(int _level)
 {
+  int previousLevel = m_mesh.GetSurfaceLevel();
   m_mesh.SetSurfaceLevel(_level);
+  // Out of range levels are refused, and an unchanged level leaves nothing to march
+  if (m_mesh.GetSurfaceLevel() == previousLevel)
+  {
+    return;
+  }
+  // Below the auto-crop level the surface reaches past the cropped box, so only sampling again can show it
+  if (m_builtVAO && m_canRemarch && m_cropped && m_mesh.GetSurfaceLevel() < m_cropLevel)
+  {
+    std::cout << "Surface level is below the auto-crop level of " << m_cropLevel << ", sample the images again to march it.\n";
+  }
+  // A drawn mesh follows the level, only bricks with values between the old and new level are marched again
+  else if (m_builtVAO && m_canRemarch)
+  {
+    makeCurrent();
+    // Only marching cubes is kept per brick, the other engines march everything again
+    m_indexedMesh = m_mesh.GetEngine() == Mesh::Engine::MarchingCubes ? m_mesh.MarchCubesIncremental() : m_mesh.MarchCubesIndexed();
+    DecimateMesh();
+    m_chunks = m_chunked ? m_mesh.MarchChunks() : std::vector<MeshChunk>();
+    m_builtVAO = !m_indexedMesh.indices.empty();
+    CompactMesh();
+    if (m_builtVAO)
+    {
+      BuildVAO();
+    }
+  }
   update();
 }
 
+void NGLScene::setDecimation(int _percent)
+{
+  m_decimation = _percent;
+}
+
 void NGLScene::setMetallicness(double _metallicness)
 {
   ngl::ShaderLib::use(shaderProgram);
@@ -521,6 +849,11 @@ void NGLScene::setCamera(int _camera)
   update();
 }
 
+void NGLScene::setEngine(int _engine)
+{
+  m_mesh.SetEngine(static_cast<Mesh::Engine>(_engine));
+}
+
 void NGLScene::toggleWireframeMode(bool _mode)
 {
   m_wireframe = _mode;
@@ -531,4 +864,30 @@ void NGLScene::toggleBackFaceCull(bool _mode)
 {
   m_cull = _mode;
   update();
+}
+
+void NGLScene::toggleStreaming(bool _mode)
+{
+  m_streaming = _mode;
+}
+
+void NGLScene::toggleAutoCrop(bool _mode)
+{
+  m_autoCrop = _mode;
+}
+
+void NGLScene::toggleChunks(bool _mode)
+{
+  m_chunked = _mode;
+}
+
+void NGLScene::toggleCompactVertices(bool _mode)
+{
+  m_compactVertices = _mode;
+}
+
+void NGLScene::toggleSparseStorage(bool _mode)
+{
+  m_canRemarch = false;
+  m_stack.SetSparseStorage(_mode);
 }
\ No newline at end of file
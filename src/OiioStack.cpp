@@ -0,0 +1,186 @@
+///
+/// @file OiioStack.cpp
+/// @brief Reading tiled and multi-page TIFF or EXR stacks through an OpenImageIO ImageCache
+
+#include <OpenImageIO/imagecache.h>
+#include <OpenImageIO/imageio.h>
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+
+#include "OiioStack.h"
+
+OiioStack::~OiioStack() = default;
+
+void OiioStack::CacheDeleter::operator()(OIIO::ImageCache *_cache) const
+{
+  OIIO::ImageCache::destroy(_cache);
+}
+
+bool OiioStack::IsOiioFile(const std::string &_path)
+{
+  std::string extension = std::filesystem::path(_path).extension().string();
+  std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char _c) { return std::tolower(_c); });
+  return extension == ".tif" || extension == ".tiff" || extension == ".exr";
+}
+
+bool OiioStack::Open(const std::vector<std::string> &_files)
+{
+  Clear();
+
+  if (!m_cache)
+  {
+    // A private cache, so its memory cap is not shared with anything else in the process
+    m_cache.reset(OIIO::ImageCache::create(false));
+    m_cache->attribute("max_memory_MB", m_memoryCap);
+    // Untiled files are read in 64x64 tiles, so a sampled row only decodes the tiles it crosses
+    m_cache->attribute("autotile", 64);
+    m_cache->attribute("autoscanline", 1);
+  }
+  // Files may have changed since the last read
+  m_cache->invalidate_all(true);
+
+  for (const std::string &file : _files)
+  {
+    OIIO::ustring name(file);
+    int subimages = 0;
+    if (!m_cache->get_image_info(name, 0, 0, OIIO::ustring("subimages"), OIIO::TypeInt, &subimages))
+    {
+      return Fail(file + " could not be read: " + m_cache->geterror());
+    }
+
+    // Every page of a multi-page file is its own slice
+    for (int subimage = 0; subimage < subimages; ++subimage)
+    {
+      const OIIO::ImageSpec *spec = m_cache->imagespec(name, subimage, 0);
+      if (spec == nullptr || spec->depth > 1)
+      {
+        return Fail(file + " page " + std::to_string(subimage) + " is not a 2D image.");
+      }
+      if (m_slices.empty())
+      {
+        m_width = static_cast<size_t>(spec->width);
+        m_height = static_cast<size_t>(spec->height);
+        m_eightBit = spec->format.basetype == OIIO::TypeDesc::UINT8 || spec->format.basetype == OIIO::TypeDesc::INT8;
+      }
+      else if (static_cast<size_t>(spec->width) != m_width || static_cast<size_t>(spec->height) != m_height)
+      {
+        return Fail(file + " page " + std::to_string(subimage) + " has different dimensions!");
+      }
+      m_slices.push_back({file, subimage});
+    }
+  }
+
+  if (m_slices.size() < 2)
+  {
+    return Fail("At least 2 slices are required.");
+  }
+  return true;
+}
+
+bool OiioStack::LoadVoxels(ThreadPool &_pool, unsigned int _resolution)
+{
+  size_t width = (m_width + _resolution - 1) / _resolution;
+  size_t height = (m_height + _resolution - 1) / _resolution;
+  size_t layers = (m_slices.size() + _resolution - 1) / _resolution;
+
+  // Decoding is also spread over OIIO's own threads
+  OIIO::attribute("threads", static_cast<int>(_pool.GetThreadCount()));
+
+  if (m_eightBit)
+  {
+    m_volume = Volume<uint8_t>(width, height, layers);
+  }
+  else
+  {
+    m_volume = Volume<uint16_t>(width, height, layers);
+  }
+
+  std::vector<char> loaded(layers, 0);
+  std::visit([&](auto &_volume)
+  {
+    _pool.ParallelFor(layers, [&](size_t _layer, unsigned int)
+    {
+      loaded[_layer] = LoadSlice(m_slices[_layer * _resolution], _resolution, _volume.Slice(_layer), m_eightBit);
+    });
+  }, m_volume);
+
+  for (size_t i = 0; i < layers; ++i)
+  {
+    if (!loaded[i])
+    {
+      std::visit([](auto &_volume) { _volume.Clear(); }, m_volume);
+      return Fail(m_slices[i * _resolution].path + " could not be loaded: " + m_cache->geterror());
+    }
+  }
+  return true;
+}
+
+bool OiioStack::LoadSlice(const Slice &_slice, unsigned int _resolution, void *_voxels, bool _eightBit) const
+{
+  OIIO::ustring name(_slice.path);
+  OIIO::TypeDesc format = _eightBit ? OIIO::TypeDesc::UINT8 : OIIO::TypeDesc::UINT16;
+  int width = static_cast<int>(m_width);
+
+  // Only channel 0 is requested, so single channel data is never expanded to RGBA
+  if (_resolution == 1)
+  {
+    return m_cache->get_pixels(name, _slice.subimage, 0, 0, width, 0, static_cast<int>(m_height), 0, 1, 0, 1, format, _voxels);
+  }
+
+  // Only the sampled rows are read, then every _resolution'th voxel of each is kept
+  size_t voxelSize = _eightBit ? 1 : 2;
+  std::vector<uint8_t> row(m_width * voxelSize);
+  uint8_t *out = static_cast<uint8_t *>(_voxels);
+  for (size_t y = 0; y < m_height; y += _resolution)
+  {
+    int row0 = static_cast<int>(y);
+    if (!m_cache->get_pixels(name, _slice.subimage, 0, 0, width, row0, row0 + 1, 0, 1, 0, 1, format, row.data()))
+    {
+      return false;
+    }
+    for (size_t x = 0; x < m_width; x += _resolution)
+    {
+      std::copy_n(&row[x * voxelSize], voxelSize, out);
+      out += voxelSize;
+    }
+  }
+  return true;
+}
+
+void OiioStack::Clear()
+{
+  // Release open file handles, cached tiles are dropped on the next Open()
+  if (m_cache)
+  {
+    m_cache->close_all();
+  }
+  m_slices.clear();
+  m_width = 0;
+  m_height = 0;
+  m_eightBit = false;
+  m_volume = Volume<uint8_t>();
+  m_error.clear();
+}
+
+AnyVolumeView OiioStack::View() const
+{
+  return std::visit([](const auto &_volume) -> AnyVolumeView { return _volume.View(); }, m_volume);
+}
+
+void OiioStack::SetMemoryCap(float _megabytes)
+{
+  m_memoryCap = _megabytes;
+  if (m_cache)
+  {
+    m_cache->attribute("max_memory_MB", m_memoryCap);
+  }
+}
+
+bool OiioStack::Fail(const std::string &_error)
+{
+  m_error = _error;
+  m_slices.clear();
+  return false;
+}
@@ -0,0 +1,111 @@
+///
+/// @file PackedMesh.cpp
+/// @brief Quantised positions and octahedral normals
+
+#include <algorithm>
+#include <cmath>
+
+#include "PackedMesh.h"
+
+namespace
+{
+  constexpr float c_positionSteps = 65535.0f;
+  constexpr float c_normalSteps = 32767.0f;
+
+  // Either side of zero, counting zero as positive so the fold has no gap along the axes
+  float SignNotZero(float _value)
+  {
+    return _value < 0.0f ? -1.0f : 1.0f;
+  }
+
+  uint16_t Quantise(float _value, float _minimum, float _scale)
+  {
+    float steps = std::round((_value - _minimum) * _scale);
+    return static_cast<uint16_t>(std::clamp(steps, 0.0f, c_positionSteps));
+  }
+
+  // _count vertices from _vertices with their normals from _normals
+  PackedMesh PackVertices(const ngl::Vec3 *_vertices, const ngl::Vec3 *_normals, size_t _count,
+                          const ngl::Vec3 &_minimum, const ngl::Vec3 &_maximum)
+  {
+    PackedMesh packed;
+    packed.minimum = _minimum;
+    packed.extent = _maximum - _minimum;
+    // A flat box has one position along that axis
+    ngl::Vec3 scale(packed.extent.m_x > 0.0f ? c_positionSteps / packed.extent.m_x : 0.0f,
+                    packed.extent.m_y > 0.0f ? c_positionSteps / packed.extent.m_y : 0.0f,
+                    packed.extent.m_z > 0.0f ? c_positionSteps / packed.extent.m_z : 0.0f);
+    packed.vertices.resize(_count);
+    for (size_t i = 0; i < _count; ++i)
+    {
+      PackedVertex &vertex = packed.vertices[i];
+      vertex.position = {Quantise(_vertices[i].m_x, _minimum.m_x, scale.m_x),
+                         Quantise(_vertices[i].m_y, _minimum.m_y, scale.m_y),
+                         Quantise(_vertices[i].m_z, _minimum.m_z, scale.m_z), 0};
+      vertex.normal = EncodeNormal(_normals[i]);
+    }
+    return packed;
+  }
+}
+
+ngl::Vec3 PackedMesh::Position(size_t _vertex) const
+{
+  const std::array<uint16_t, 4> &position = vertices[_vertex].position;
+  return minimum + ngl::Vec3(position[0] * extent.m_x, position[1] * extent.m_y, position[2] * extent.m_z) / c_positionSteps;
+}
+
+ngl::Vec3 PackedMesh::Normal(size_t _vertex) const
+{
+  return DecodeNormal(vertices[_vertex].normal);
+}
+
+PackedMesh PackMesh(const std::vector<ngl::Vec3> &_vertices, const std::vector<ngl::Vec3> &_normals,
+                    const std::vector<uint32_t> &_indices, const ngl::Vec3 &_minimum, const ngl::Vec3 &_maximum)
+{
+  PackedMesh packed = PackVertices(_vertices.data(), _normals.data(), std::min(_vertices.size(), _normals.size()), _minimum, _maximum);
+  packed.indices = _indices;
+  return packed;
+}
+
+PackedMesh PackSoup(const std::vector<ngl::Vec3> &_soup, const ngl::Vec3 &_minimum, const ngl::Vec3 &_maximum)
+{
+  size_t count = _soup.size() / 2;
+  return PackVertices(_soup.data(), _soup.data() + count, count, _minimum, _maximum);
+}
+
+std::array<int16_t, 2> EncodeNormal(const ngl::Vec3 &_normal)
+{
+  // Project onto the octahedron |x| + |y| + |z| = 1, then fold the lower half out over the corners
+  float length = std::abs(_normal.m_x) + std::abs(_normal.m_y) + std::abs(_normal.m_z);
+  if (length == 0.0f)
+  {
+    return {0, 0};
+  }
+  float x = _normal.m_x / length;
+  float y = _normal.m_y / length;
+  if (_normal.m_z < 0.0f)
+  {
+    float foldedX = (1.0f - std::abs(y)) * SignNotZero(x);
+    y = (1.0f - std::abs(x)) * SignNotZero(y);
+    x = foldedX;
+  }
+  return {static_cast<int16_t>(std::round(std::clamp(x, -1.0f, 1.0f) * c_normalSteps)),
+          static_cast<int16_t>(std::round(std::clamp(y, -1.0f, 1.0f) * c_normalSteps))};
+}
+
+ngl::Vec3 DecodeNormal(const std::array<int16_t, 2> &_encoded)
+{
+  // As PBRVertex.glsl
+  float x = std::max(_encoded[0] / c_normalSteps, -1.0f);
+  float y = std::max(_encoded[1] / c_normalSteps, -1.0f);
+  float z = 1.0f - std::abs(x) - std::abs(y);
+  if (z < 0.0f)
+  {
+    float unfoldedX = (1.0f - std::abs(y)) * SignNotZero(x);
+    y = (1.0f - std::abs(x)) * SignNotZero(y);
+    x = unfoldedX;
+  }
+  ngl::Vec3 normal(x, y, z);
+  normal.normalize();
+  return normal;
+}
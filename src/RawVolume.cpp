@@ -0,0 +1,396 @@
+///
+/// @file RawVolume.cpp
+/// @brief Memory mapped raw volumes described by NRRD or MetaImage headers
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+#include "RawVolume.h"
+
+namespace
+{
+  std::string Trim(const std::string &_text)
+  {
+    size_t start = _text.find_first_not_of(" \t\r\n");
+    if (start == std::string::npos)
+    {
+      return "";
+    }
+    size_t end = _text.find_last_not_of(" \t\r\n");
+    return _text.substr(start, end - start + 1);
+  }
+
+  std::string ToLower(std::string _text)
+  {
+    std::transform(_text.begin(), _text.end(), _text.begin(), [](unsigned char _c) { return std::tolower(_c); });
+    return _text;
+  }
+
+  // Whole of _text as a whole number, false for anything else rather than throwing
+  bool ParseInteger(const std::string &_text, long long &_value)
+  {
+    const char *end = _text.data() + _text.size();
+    std::from_chars_result result = std::from_chars(_text.data(), end, _value);
+    return result.ec == std::errc() && result.ptr == end;
+  }
+
+  // Three sizes above zero
+  bool ParseSizes(const std::string &_text, size_t &_width, size_t &_height, size_t &_depth)
+  {
+    std::istringstream sizes(_text);
+    std::string values[3];
+    sizes >> values[0] >> values[1] >> values[2];
+    size_t *out[3] = {&_width, &_height, &_depth};
+    for (int i = 0; i < 3; ++i)
+    {
+      long long size = 0;
+      if (!ParseInteger(values[i], size) || size <= 0)
+      {
+        return false;
+      }
+      *out[i] = static_cast<size_t>(size);
+    }
+    return true;
+  }
+
+  // Bytes of voxel data the header describes, false when that does not fit in a size_t
+  bool DataSize(size_t _width, size_t _height, size_t _depth, size_t _bytesPerVoxel, size_t &_size)
+  {
+    _size = _bytesPerVoxel;
+    for (size_t factor : {_width, _height, _depth})
+    {
+      if (_size > std::numeric_limits<size_t>::max() / factor)
+      {
+        return false;
+      }
+      _size *= factor;
+    }
+    return true;
+  }
+
+  bool HostIsBigEndian()
+  {
+    const uint16_t one = 1;
+    uint8_t first;
+    std::memcpy(&first, &one, 1);
+    return first == 0;
+  }
+}
+
+bool RawVolume::IsVolumeFile(const std::string &_path)
+{
+  std::string extension = ToLower(std::filesystem::path(_path).extension().string());
+  return extension == ".nrrd" || extension == ".nhdr" || extension == ".mhd" || extension == ".mha";
+}
+
+bool RawVolume::Open(const std::string &_headerPath)
+{
+  Close();
+
+  std::ifstream file(_headerPath, std::ios::binary);
+  if (!file)
+  {
+    return Fail(_headerPath + " could not be opened.");
+  }
+
+  Header header;
+  std::string extension = ToLower(std::filesystem::path(_headerPath).extension().string());
+  bool parsed = (extension == ".nrrd" || extension == ".nhdr") ? ParseNRRD(file, header) : ParseMetaImage(file, header);
+  if (!parsed)
+  {
+    return false;
+  }
+  file.close();
+
+  // Detached data files are relative to the header
+  std::string dataPath = _headerPath;
+  if (!header.dataFile.empty())
+  {
+    std::filesystem::path path = header.dataFile;
+    dataPath = path.is_absolute() ? path.string() : (std::filesystem::path(_headerPath).parent_path() / path).string();
+  }
+
+  size_t dataSize = 0;
+  if (!DataSize(header.width, header.height, header.depth, header.bytesPerVoxel, dataSize))
+  {
+    return Fail(_headerPath + " describes more voxels than can be addressed.");
+  }
+  if (!m_file.Open(dataPath))
+  {
+    return Fail(dataPath + " could not be mapped.");
+  }
+
+  size_t offset = header.dataOffset < 0 ? m_file.Size() - std::min(m_file.Size(), dataSize) : static_cast<size_t>(header.dataOffset);
+  if (offset > m_file.Size() || dataSize > m_file.Size() - offset)
+  {
+    m_file.Close();
+    return Fail(dataPath + " is smaller than its header describes.");
+  }
+
+  m_header = header;
+  m_voxels = m_file.Data() + offset;
+
+  // 16-bit voxels are only viewed in place when they are aligned and in host byte order
+  bool swap = header.bytesPerVoxel == 2 && header.bigEndian != HostIsBigEndian();
+  bool misaligned = header.bytesPerVoxel == 2 && reinterpret_cast<uintptr_t>(m_voxels) % alignof(uint16_t) != 0;
+  if (swap || misaligned)
+  {
+    m_converted.Resize(header.width, header.height, header.depth);
+    uint16_t *voxels = m_converted.Data();
+    for (size_t i = 0; i < m_converted.GetVoxelCount(); ++i)
+    {
+      const uint8_t *bytes = m_voxels + i * 2;
+      voxels[i] = header.bigEndian ? static_cast<uint16_t>((bytes[0] << 8) | bytes[1])
+                                   : static_cast<uint16_t>(bytes[0] | (bytes[1] << 8));
+    }
+    m_file.Close();
+    m_voxels = nullptr;
+  }
+  else
+  {
+    // Pages fault in as the march sweeps through z
+    m_file.AdviseSequential();
+  }
+
+  m_open = true;
+  return true;
+}
+
+void RawVolume::Close()
+{
+  m_file.Close();
+  m_converted.Clear();
+  m_voxels = nullptr;
+  m_header = Header();
+  m_open = false;
+  m_error.clear();
+}
+
+AnyVolumeView RawVolume::View() const
+{
+  size_t w = m_header.width;
+  size_t h = m_header.height;
+  size_t d = m_header.depth;
+
+  if (!m_converted.Empty())
+  {
+    return m_converted.View();
+  }
+  if (m_header.bytesPerVoxel == 2)
+  {
+    return VolumeView<uint16_t>(reinterpret_cast<const uint16_t *>(m_voxels), w, h, d, 1, w, w * h);
+  }
+  return VolumeView<uint8_t>(m_voxels, w, h, d, 1, w, w * h);
+}
+
+bool RawVolume::ParseNRRD(std::istream &_file, Header &_header)
+{
+  std::string line;
+  std::getline(_file, line);
+  if (line.compare(0, 4, "NRRD") != 0)
+  {
+    return Fail("Missing NRRD magic line.");
+  }
+
+  bool haveSizes = false;
+  std::string encoding = "raw";
+  while (std::getline(_file, line))
+  {
+    line = Trim(line);
+    // A blank line ends the header, attached data starts straight after it
+    if (line.empty())
+    {
+      break;
+    }
+    if (line[0] == '#')
+    {
+      continue;
+    }
+
+    size_t colon = line.find(':');
+    if (colon == std::string::npos)
+    {
+      continue;
+    }
+    std::string key = ToLower(Trim(line.substr(0, colon)));
+    // Key/value pairs use ":=" and are not needed here
+    if (colon + 1 < line.size() && line[colon + 1] == '=')
+    {
+      continue;
+    }
+    std::string value = Trim(line.substr(colon + 1));
+
+    if (key == "type")
+    {
+      value = ToLower(value);
+      if (value == "uchar" || value == "unsigned char" || value == "uint8" || value == "uint8_t")
+      {
+        _header.bytesPerVoxel = 1;
+      }
+      else if (value == "ushort" || value == "unsigned short" || value == "unsigned short int" || value == "uint16" || value == "uint16_t")
+      {
+        _header.bytesPerVoxel = 2;
+      }
+      else
+      {
+        return Fail("Unsupported NRRD type: " + value);
+      }
+    }
+    else if (key == "dimension")
+    {
+      if (value != "3")
+      {
+        return Fail("Only 3 dimensional NRRD volumes are supported.");
+      }
+    }
+    else if (key == "sizes")
+    {
+      if (!ParseSizes(value, _header.width, _header.height, _header.depth))
+      {
+        return Fail("Invalid NRRD sizes: " + value);
+      }
+      haveSizes = true;
+    }
+    else if (key == "endian")
+    {
+      _header.bigEndian = ToLower(value) == "big";
+    }
+    else if (key == "encoding")
+    {
+      encoding = ToLower(value);
+    }
+    else if (key == "byte skip")
+    {
+      // -1 places the data at the end of the file
+      if (!ParseInteger(value, _header.dataOffset) || _header.dataOffset < -1)
+      {
+        return Fail("Invalid NRRD byte skip: " + value);
+      }
+    }
+    else if (key == "data file" || key == "datafile")
+    {
+      _header.dataFile = value;
+    }
+  }
+
+  if (encoding != "raw")
+  {
+    return Fail("Only raw NRRD encoding is supported, found: " + encoding);
+  }
+  if (!haveSizes || _header.bytesPerVoxel == 0)
+  {
+    return Fail("NRRD header is missing its sizes or type.");
+  }
+
+  // Attached data follows the header, any byte skip is on top of that
+  if (_header.dataFile.empty() && _header.dataOffset >= 0)
+  {
+    if (_header.dataOffset > std::numeric_limits<long long>::max() - static_cast<long long>(_file.tellg()))
+    {
+      return Fail("Invalid NRRD byte skip.");
+    }
+    _header.dataOffset += static_cast<long long>(_file.tellg());
+  }
+  return true;
+}
+
+bool RawVolume::ParseMetaImage(std::istream &_file, Header &_header)
+{
+  bool haveSizes = false;
+  std::string line;
+  while (std::getline(_file, line))
+  {
+    size_t equals = line.find('=');
+    if (equals == std::string::npos)
+    {
+      continue;
+    }
+    std::string key = ToLower(Trim(line.substr(0, equals)));
+    std::string value = Trim(line.substr(equals + 1));
+
+    if (key == "ndims")
+    {
+      if (value != "3")
+      {
+        return Fail("Only 3 dimensional MetaImage volumes are supported.");
+      }
+    }
+    else if (key == "dimsize")
+    {
+      if (!ParseSizes(value, _header.width, _header.height, _header.depth))
+      {
+        return Fail("Invalid MetaImage DimSize: " + value);
+      }
+      haveSizes = true;
+    }
+    else if (key == "elementtype")
+    {
+      if (value == "MET_UCHAR")
+      {
+        _header.bytesPerVoxel = 1;
+      }
+      else if (value == "MET_USHORT")
+      {
+        _header.bytesPerVoxel = 2;
+      }
+      else
+      {
+        return Fail("Unsupported MetaImage element type: " + value);
+      }
+    }
+    else if (key == "binarydatabyteordermsb" || key == "elementbyteordermsb")
+    {
+      _header.bigEndian = ToLower(value) == "true";
+    }
+    else if (key == "compresseddata")
+    {
+      if (ToLower(value) == "true")
+      {
+        return Fail("Compressed MetaImage data is not supported.");
+      }
+    }
+    else if (key == "headersize")
+    {
+      if (!ParseInteger(value, _header.dataOffset) || _header.dataOffset < -1)
+      {
+        return Fail("Invalid MetaImage HeaderSize: " + value);
+      }
+    }
+    // Always the last field, LOCAL data follows straight after it
+    else if (key == "elementdatafile")
+    {
+      if (value != "LOCAL")
+      {
+        _header.dataFile = value;
+      }
+      else if (_header.dataOffset >= 0)
+      {
+        if (_header.dataOffset > std::numeric_limits<long long>::max() - static_cast<long long>(_file.tellg()))
+        {
+          return Fail("Invalid MetaImage HeaderSize.");
+        }
+        _header.dataOffset += static_cast<long long>(_file.tellg());
+      }
+      break;
+    }
+  }
+
+  if (!haveSizes || _header.bytesPerVoxel == 0)
+  {
+    return Fail("MetaImage header is missing its DimSize or ElementType.");
+  }
+  return true;
+}
+
+bool RawVolume::Fail(const std::string &_error)
+{
+  m_error = _error;
+  m_open = false;
+  return false;
+}
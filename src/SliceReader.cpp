@@ -0,0 +1,128 @@
+///
+/// @file SliceReader.cpp
+/// @brief Decodes slices ahead of their consumer through a bounded queue
+
+#include <algorithm>
+
+#include "SliceReader.h"
+
+SliceReader::~SliceReader()
+{
+  Stop();
+}
+
+void SliceReader::Start(size_t _layers, size_t _width, size_t _height, size_t _queueDepth, Decoder _decoder)
+{
+  Stop();
+
+  size_t depth = std::max<size_t>(1, std::min(_queueDepth, _layers));
+  m_decoder = std::move(_decoder);
+  m_slots.Resize(_width, _height, depth);
+  m_ready.assign(depth, 0);
+  m_layers = _layers;
+  m_claimed = 0;
+  m_next = 0;
+  m_released = 0;
+  m_stopping = false;
+  m_failed = false;
+  m_failedLayer = 0;
+  m_running = true;
+
+  // Each worker keeps claiming the next layer, so the pool is free again once reading ends
+  unsigned int workers = std::min<size_t>(m_pool.GetThreadCount(), depth);
+  for (unsigned int i = 0; i < workers; ++i)
+  {
+    m_pool.Submit([this](unsigned int _worker) { Decode(_worker); });
+  }
+}
+
+bool SliceReader::Next(VolumeView<uint8_t> &_layer)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  if (!m_running)
+  {
+    return false;
+  }
+
+  // The previous layer's slot can now be decoded into again
+  if (m_released < m_next)
+  {
+    m_released = m_next;
+    m_slotReleased.notify_all();
+  }
+  if (m_next >= m_layers)
+  {
+    return false;
+  }
+
+  size_t slot = m_next % m_ready.size();
+  m_layerDecoded.wait(lock, [&] { return m_ready[slot] == m_next + 1 || (m_failed && m_failedLayer == m_next); });
+  if (m_ready[slot] != m_next + 1)
+  {
+    return false;
+  }
+
+  size_t width = m_slots.GetWidth();
+  _layer = VolumeView<uint8_t>(m_slots.Slice(slot), width, m_slots.GetHeight(), 1, 1, width, m_slots.GetStrideZ());
+  ++m_next;
+  return true;
+}
+
+void SliceReader::Stop()
+{
+  if (!m_running)
+  {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+  }
+  m_slotReleased.notify_all();
+  m_pool.Wait();
+
+  m_running = false;
+  m_slots.Clear();
+  m_ready.clear();
+}
+
+void SliceReader::Decode(unsigned int _worker)
+{
+  while (true)
+  {
+    size_t layer;
+    {
+      // Back-pressure, never run more than a ring's worth of layers ahead of the consumer
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_slotReleased.wait(lock, [this]
+      {
+        return m_stopping || m_claimed >= m_layers || m_claimed < m_released + m_ready.size();
+      });
+      if (m_stopping || m_claimed >= m_layers)
+      {
+        return;
+      }
+      layer = m_claimed++;
+    }
+
+    size_t slot = layer % m_ready.size();
+    bool decoded = m_decoder(layer, m_slots.Slice(slot), _worker);
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if (decoded)
+      {
+        m_ready[slot] = layer + 1;
+      }
+      else
+      {
+        // Layers are claimed in order, so everything before the first failure still arrives
+        m_failedLayer = m_failed ? std::min(m_failedLayer, layer) : layer;
+        m_failed = true;
+        m_stopping = true;
+      }
+    }
+    m_layerDecoded.notify_all();
+    m_slotReleased.notify_all();
+  }
+}
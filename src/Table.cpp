@@ -2,23 +2,16 @@
 /// @file Table.cpp
 /// @brief Store triangulation table and handle binary to base 10 number conversion
 
-#include <iostream>
-#include <math.h>
-
 #include "Table.h"
 
 std::vector<int> Table::Triangulate(std::string _binary)
 {
-  int power = 7;
-  size_t result = 0;
-
-  for (size_t i = 0; i < _binary.length(); i++)
+  // Most significant bit first, so each character shifts in below the last
+  unsigned int cubeIndex = 0;
+  for (char bit : _binary)
   {
-    if (_binary[i] == '1')
-    {
-      result += pow(2, power);
-    }
-    power--;
+    cubeIndex = (cubeIndex << 1) | (bit == '1' ? 1u : 0u);
   }
-  return m_triTable[result];
+  const std::array<int8_t, 16> &edges = Edges(cubeIndex & 0xFF);
+  return std::vector<int>(edges.begin(), edges.end());
 }
@@ -0,0 +1,130 @@
+///
+/// @file ThreadPool.cpp
+/// @brief Reusable pool of worker threads
+
+#include <algorithm>
+#include <atomic>
+
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(unsigned int _threads)
+{
+  Start(_threads);
+}
+
+ThreadPool::~ThreadPool()
+{
+  Stop();
+}
+
+void ThreadPool::SetThreadCount(unsigned int _threads)
+{
+  Stop();
+  Start(_threads);
+}
+
+void ThreadPool::Start(unsigned int _threads)
+{
+  if (_threads == 0)
+  {
+    _threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  m_stopping = false;
+  for (unsigned int i = 0; i < _threads; ++i)
+  {
+    m_workers.emplace_back(&ThreadPool::WorkerLoop, this, i);
+  }
+}
+
+void ThreadPool::Stop()
+{
+  // Let queued tasks finish before the workers are joined
+  Wait();
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stopping = true;
+  }
+  m_taskAvailable.notify_all();
+
+  for (std::thread &worker : m_workers)
+  {
+    worker.join();
+  }
+  m_workers.clear();
+}
+
+void ThreadPool::Submit(std::function<void(unsigned int)> _task)
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_tasks.push_back(std::move(_task));
+    ++m_pendingTasks;
+  }
+  m_taskAvailable.notify_one();
+}
+
+void ThreadPool::Wait()
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  m_tasksFinished.wait(lock, [this] { return m_pendingTasks == 0; });
+}
+
+void ThreadPool::ParallelFor(size_t _count, const std::function<void(size_t, unsigned int)> &_task)
+{
+  if (_count == 0)
+  {
+    return;
+  }
+
+  // Each runner keeps claiming the next index, so uneven tasks still balance out
+  std::atomic<size_t> next(0);
+  size_t runners = std::min(_count, m_workers.size());
+  size_t remaining = runners;
+  std::mutex doneMutex;
+  std::condition_variable done;
+
+  for (size_t r = 0; r < runners; ++r)
+  {
+    Submit([&](unsigned int _worker)
+    {
+      for (size_t i = next++; i < _count; i = next++)
+      {
+        _task(i, _worker);
+      }
+      // Notify while locked so the waiting caller cannot leave scope too early
+      std::lock_guard<std::mutex> lock(doneMutex);
+      --remaining;
+      done.notify_one();
+    });
+  }
+
+  std::unique_lock<std::mutex> lock(doneMutex);
+  done.wait(lock, [&] { return remaining == 0; });
+}
+
+void ThreadPool::WorkerLoop(unsigned int _worker)
+{
+  while (true)
+  {
+    std::function<void(unsigned int)> task;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_taskAvailable.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+      if (m_tasks.empty())
+      {
+        return;
+      }
+      task = std::move(m_tasks.front());
+      m_tasks.pop_front();
+    }
+
+    task(_worker);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (--m_pendingTasks == 0)
+    {
+      m_tasksFinished.notify_all();
+    }
+  }
+}
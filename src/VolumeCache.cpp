@@ -0,0 +1,186 @@
+///
+/// @file VolumeCache.cpp
+/// @brief On-disk cache of sampled volumes, memory mapped on a hit
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+#include "VolumeCache.h"
+
+namespace
+{
+  constexpr char c_magic[8] = {'M', 'C', 'V', 'O', 'L', '0', '0', '1'};
+
+  // FNV-1a, stable between runs and platforms unlike std::hash
+  void Hash(uint64_t &_hash, const void *_data, size_t _size)
+  {
+    const uint8_t *bytes = static_cast<const uint8_t *>(_data);
+    for (size_t i = 0; i < _size; ++i)
+    {
+      _hash ^= bytes[i];
+      _hash *= 1099511628211ull;
+    }
+  }
+
+  void Hash(uint64_t &_hash, const std::string &_text)
+  {
+    // Include the terminator so "ab" + "c" differs from "a" + "bc"
+    Hash(_hash, _text.c_str(), _text.size() + 1);
+  }
+
+  void Hash(uint64_t &_hash, uint64_t _value)
+  {
+    Hash(_hash, &_value, sizeof(_value));
+  }
+}
+
+std::string VolumeCache::DefaultDirectory()
+{
+  std::error_code error;
+  std::filesystem::path temp = std::filesystem::temp_directory_path(error);
+  if (error)
+  {
+    return "";
+  }
+  return (temp / "marching-cubes-cache").string();
+}
+
+uint64_t VolumeCache::Key(const std::string &_directory, const std::vector<std::string> &_files, unsigned int _sampleResolution)
+{
+  uint64_t hash = 14695981039346656037ull;
+  Hash(hash, std::filesystem::absolute(_directory).lexically_normal().string());
+  Hash(hash, static_cast<uint64_t>(_files.size()));
+  for (const std::string &file : _files)
+  {
+    // Only a stat per file, nothing is decoded
+    std::error_code error;
+    uint64_t size = std::filesystem::file_size(file, error);
+    uint64_t modified = static_cast<uint64_t>(std::filesystem::last_write_time(file, error).time_since_epoch().count());
+    Hash(hash, file);
+    Hash(hash, error ? 0 : size);
+    Hash(hash, error ? 0 : modified);
+  }
+  Hash(hash, static_cast<uint64_t>(_sampleResolution));
+  return hash;
+}
+
+bool VolumeCache::Load(uint64_t _key)
+{
+  Close();
+  if (!IsEnabled() || !m_file.Open(PathOf(_key)))
+  {
+    return false;
+  }
+
+  // Reject anything that is not exactly what Store() would have written for this key
+  Header header;
+  if (m_file.Size() < sizeof(Header))
+  {
+    Close();
+    return false;
+  }
+  std::memcpy(&header, m_file.Data(), sizeof(Header));
+  if (std::memcmp(header.magic, c_magic, sizeof(c_magic)) != 0 || header.key != _key ||
+      m_file.Size() != sizeof(Header) + header.width * header.height * header.depth)
+  {
+    Close();
+    return false;
+  }
+
+  m_header = header;
+  m_file.AdviseSequential();
+  return true;
+}
+
+bool VolumeCache::Store(uint64_t _key, const VolumeView<uint8_t> &_volume)
+{
+  if (!IsEnabled() || _volume.Empty())
+  {
+    return false;
+  }
+
+  std::error_code error;
+  std::filesystem::create_directories(m_directory, error);
+  if (error)
+  {
+    return false;
+  }
+
+  // Write beside the final file and rename, so a reader never maps a half written cache
+  std::string path = PathOf(_key);
+  std::string partial = path + ".part";
+  {
+    std::ofstream file(partial, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+      return false;
+    }
+
+    Header header;
+    std::memcpy(header.magic, c_magic, sizeof(c_magic));
+    header.key = _key;
+    header.width = _volume.GetWidth();
+    header.height = _volume.GetHeight();
+    header.depth = _volume.GetDepth();
+    file.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+
+    std::vector<char> row(_volume.GetWidth());
+    for (size_t z = 0; z < _volume.GetDepth(); ++z)
+    {
+      for (size_t y = 0; y < _volume.GetHeight(); ++y)
+      {
+        for (size_t x = 0; x < _volume.GetWidth(); ++x)
+        {
+          row[x] = static_cast<char>(_volume.At(x, y, z));
+        }
+        file.write(row.data(), static_cast<std::streamsize>(row.size()));
+      }
+    }
+    if (!file)
+    {
+      file.close();
+      std::filesystem::remove(partial, error);
+      return false;
+    }
+  }
+
+  std::filesystem::rename(partial, path, error);
+  if (error)
+  {
+    std::filesystem::remove(partial, error);
+    return false;
+  }
+  return true;
+}
+
+void VolumeCache::Close()
+{
+  m_file.Close();
+  m_header = Header();
+}
+
+VolumeView<uint8_t> VolumeCache::View() const
+{
+  if (!IsOpen())
+  {
+    return VolumeView<uint8_t>();
+  }
+  size_t w = m_header.width;
+  size_t h = m_header.height;
+  return VolumeView<uint8_t>(m_file.Data() + sizeof(Header), w, h, m_header.depth, 1, w, w * h);
+}
+
+void VolumeCache::SetDirectory(const std::string &_directory)
+{
+  Close();
+  m_directory = _directory;
+}
+
+std::string VolumeCache::PathOf(uint64_t _key) const
+{
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.vol", static_cast<unsigned long long>(_key));
+  return (std::filesystem::path(m_directory) / name).string();
+}
@@ -0,0 +1,133 @@
+///
+/// @file VolumePyramid.cpp
+/// @brief Box filtered mip levels of a sampled volume
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VOLUME_PYRAMID_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "VolumePyramid.h"
+
+void VolumePyramid::Build(const VolumeView<uint8_t> &_base, ThreadPool &_pool, unsigned int _levels)
+{
+  Clear();
+  m_base = _base;
+  _levels = std::min(_levels, c_maxLevels);
+
+  for (unsigned int level = 1; level < _levels; ++level)
+  {
+    VolumeView<uint8_t> source = Level(level - 1);
+    size_t width = (source.GetWidth() + 1) / 2;
+    size_t height = (source.GetHeight() + 1) / 2;
+    size_t depth = (source.GetDepth() + 1) / 2;
+    // A single voxel along any axis leaves no cubes to march
+    if (width < 2 || height < 2 || depth < 2)
+    {
+      break;
+    }
+
+    m_levels.emplace_back(width, height, depth);
+    Volume<uint8_t> &filtered = m_levels.back();
+    _pool.ParallelFor(depth, [&](size_t _z, unsigned int)
+    {
+      DownsampleLayer(source, _z, filtered.Slice(_z));
+    });
+  }
+}
+
+void VolumePyramid::Clear()
+{
+  m_base = VolumeView<uint8_t>();
+  m_levels.clear();
+}
+
+VolumeView<uint8_t> VolumePyramid::Level(unsigned int _level) const
+{
+  if (_level == 0)
+  {
+    return m_base;
+  }
+  if (_level > m_levels.size())
+  {
+    return VolumeView<uint8_t>();
+  }
+  return m_levels[_level - 1].View();
+}
+
+int VolumePyramid::LevelForFactor(unsigned int _factor) const
+{
+  for (unsigned int level = 0; level < GetLevelCount(); ++level)
+  {
+    if (_factor == 1u << level)
+    {
+      return static_cast<int>(level);
+    }
+  }
+  return -1;
+}
+
+void VolumePyramid::DownsampleLayer(const VolumeView<uint8_t> &_source, size_t _z, uint8_t *_out)
+{
+  size_t width = (_source.GetWidth() + 1) / 2;
+  size_t height = (_source.GetHeight() + 1) / 2;
+  size_t z0 = _z * 2;
+  size_t z1 = std::min(z0 + 1, _source.GetDepth() - 1);
+
+  for (size_t y = 0; y < height; ++y)
+  {
+    size_t y0 = y * 2;
+    size_t y1 = std::min(y0 + 1, _source.GetHeight() - 1);
+    // The four input rows that fold into this output row
+    const uint8_t *rows[4] = {&_source.Slice(z0)[y0 * _source.GetStrideY()], &_source.Slice(z0)[y1 * _source.GetStrideY()],
+                              &_source.Slice(z1)[y0 * _source.GetStrideY()], &_source.Slice(z1)[y1 * _source.GetStrideY()]};
+    size_t x = 0;
+
+#ifdef VOLUME_PYRAMID_SSE2
+    // 32 input voxels per row make 16 output voxels, only while every pair is inside the row
+    if (_source.GetStrideX() == 1)
+    {
+      const __m128i zero = _mm_setzero_si128();
+      const __m128i lowHalves = _mm_set1_epi32(0xFFFF);
+      const __m128i rounding = _mm_set1_epi32(4);
+      for (; x * 2 + 32 <= _source.GetWidth(); x += 16)
+      {
+        __m128i sums[4] = {zero, zero, zero, zero};
+        for (const uint8_t *row : rows)
+        {
+          __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + x * 2));
+          __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + x * 2 + 16));
+          // Widen to 16 bits, four rows of 255 still fit
+          sums[0] = _mm_add_epi16(sums[0], _mm_unpacklo_epi8(a, zero));
+          sums[1] = _mm_add_epi16(sums[1], _mm_unpackhi_epi8(a, zero));
+          sums[2] = _mm_add_epi16(sums[2], _mm_unpacklo_epi8(b, zero));
+          sums[3] = _mm_add_epi16(sums[3], _mm_unpackhi_epi8(b, zero));
+        }
+        // Add each horizontal pair into one 32-bit lane, then round and divide by 8
+        __m128i averages[4];
+        for (int i = 0; i < 4; ++i)
+        {
+          __m128i pairs = _mm_add_epi32(_mm_and_si128(sums[i], lowHalves), _mm_srli_epi32(sums[i], 16));
+          averages[i] = _mm_srli_epi32(_mm_add_epi32(pairs, rounding), 3);
+        }
+        __m128i packed = _mm_packus_epi16(_mm_packs_epi32(averages[0], averages[1]), _mm_packs_epi32(averages[2], averages[3]));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(_out + y * width + x), packed);
+      }
+    }
+#endif
+
+    for (; x < width; ++x)
+    {
+      size_t x0 = x * 2 * _source.GetStrideX();
+      size_t x1 = std::min(x * 2 + 1, _source.GetWidth() - 1) * _source.GetStrideX();
+      unsigned int sum = 4;
+      for (const uint8_t *row : rows)
+      {
+        sum += row[x0] + row[x1];
+      }
+      _out[y * width + x] = static_cast<uint8_t>(sum >> 3);
+    }
+  }
+}
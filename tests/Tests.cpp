@@ -4,12 +4,33 @@
 
 #include <gtest/gtest.h>
 
+#include <OpenImageIO/imageio.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
 #include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <tuple>
 
+#include "BrickVolume.h"
 #include "Camera.h"
+#include "CubeClassifier.h"
+#include "Decimator.h"
+#include "DicomSeries.h"
 #include "ImageStack.h"
 #include "Mesh.h"
+#include "OiioStack.h"
+#include "PackedMesh.h"
+#include "RawVolume.h"
+#include "SliceReader.h"
 #include "Table.h"
+#include "ThreadPool.h"
+#include "Volume.h"
+#include "VolumeCache.h"
+#include "VolumePyramid.h"
 
 // TABLE TESTS
 TEST(TABLE, Constructor)
@@ -27,6 +48,17 @@ TEST(TABLE, Triangulate)
   ASSERT_EQ(t.Triangulate("00001000"), test);
 }
 
+TEST(TABLE, CompileTimeTables)
+{
+  // Counts and crossed edges are derived from the triangle table
+  static_assert(c_triCount[0] == 0 && c_triCount[255] == 0, "Uniform cubes have no triangles");
+  ASSERT_EQ(Table::TriangleCount(1), 1);
+  ASSERT_EQ(Table::TriangleCount(0b00001000), 1);
+  ASSERT_EQ(Table::Edges(0b00001000)[0], 3);
+  ASSERT_EQ(Table::CutEdges(1), 0x109);
+  ASSERT_EQ(Table::CutEdges(0b11111110), 0x109);
+}
+
 //CAMERA TESTS
 TEST(CAMERA, Constructor)
 {
@@ -57,6 +89,79 @@ TEST(CAMERA, GetEye)
   ASSERT_EQ(c.GetEye(), eye);
 }
 
+// THREAD POOL TESTS
+TEST(THREAD_POOL, SetGetThreadCount)
+{
+  ThreadPool pool(3);
+  ASSERT_EQ(pool.GetThreadCount(), 3);
+  pool.SetThreadCount(5);
+  ASSERT_EQ(pool.GetThreadCount(), 5);
+}
+
+TEST(THREAD_POOL, ParallelFor)
+{
+  ThreadPool pool(4);
+  std::vector<std::atomic<int>> visits(1000);
+  pool.ParallelFor(visits.size(), [&](size_t _index, unsigned int _worker)
+  {
+    ASSERT_LT(_worker, 4);
+    visits[_index]++;
+  });
+  for (size_t i = 0; i < visits.size(); ++i)
+  {
+    ASSERT_EQ(visits[i], 1);
+  }
+}
+
+// SLICE READER TESTS
+TEST(SLICE_READER, InOrderWithBackPressure)
+{
+  ThreadPool pool(3);
+  SliceReader reader(pool);
+  std::atomic<size_t> consumed(0);
+  std::atomic<bool> tooFarAhead(false);
+  const size_t depth = 4;
+
+  reader.Start(50, 3, 2, depth, [&](size_t _layer, uint8_t *_points, unsigned int)
+  {
+    // Slots are only reused once the consumer has released them
+    if (_layer >= consumed + depth)
+    {
+      tooFarAhead = true;
+    }
+    std::fill(_points, _points + 6, static_cast<uint8_t>(_layer));
+    return true;
+  });
+
+  VolumeView<uint8_t> layer;
+  while (reader.Next(layer))
+  {
+    ASSERT_EQ(layer.At(2, 1, 0), consumed);
+    ++consumed;
+  }
+  ASSERT_EQ(consumed, 50);
+  ASSERT_FALSE(reader.Failed());
+  ASSERT_FALSE(tooFarAhead);
+}
+
+TEST(SLICE_READER, StopsAtFailedLayer)
+{
+  ThreadPool pool(2);
+  SliceReader reader(pool);
+  reader.Start(20, 2, 2, 3, [](size_t _layer, uint8_t *, unsigned int) { return _layer != 7; });
+
+  size_t consumed = 0;
+  VolumeView<uint8_t> layer;
+  while (reader.Next(layer))
+  {
+    ++consumed;
+  }
+  reader.Stop();
+  ASSERT_EQ(consumed, 7);
+  ASSERT_TRUE(reader.Failed());
+  ASSERT_EQ(reader.GetFailedLayer(), 7);
+}
+
 // IMAGE STACK TESTS
 TEST(IMAGE_STACK, ctor)
 {
@@ -80,11 +185,11 @@ TEST(IMAGE_STACK, SampleImagesBlack)
   stack.SetSampleResolution(1);
   stack.SampleImages();
   // black.png
-  for (size_t i = 0; i < stack.m_sampledPoints.size(); ++i)
+  for (size_t i = 0; i < stack.m_sampledPoints.GetDepth(); ++i)
   {
-    for (size_t j = 0; j < stack.m_sampledPoints[i].size(); ++j)
+    for (size_t j = 0; j < stack.m_sampledPoints.GetStrideZ(); ++j)
     {
-      ASSERT_EQ(stack.m_sampledPoints[i][j], 0);
+      ASSERT_EQ(stack.m_sampledPoints.Slice(i)[j], 0);
     }
   }
 }
@@ -98,31 +203,49 @@ TEST(IMAGE_STACK, SampleImagesRGBW)
   stack.SampleImages();
 
   // RGBW.png
-  for (size_t i = 0; i < stack.m_sampledPoints.size(); ++i)
+  for (size_t i = 0; i < stack.m_sampledPoints.GetDepth(); ++i)
   {
+    const uint8_t *layer = stack.m_sampledPoints.Slice(i);
     // Red
     for (int r = 0; r < 40000; ++r)
     {
-      ASSERT_EQ(stack.m_sampledPoints[i][r], 255);
+      ASSERT_EQ(layer[r], 255);
     }
     // Green
     for (int g = 40000; g < 80000; ++g)
     {
-      ASSERT_EQ(stack.m_sampledPoints[i][g], 0);
+      ASSERT_EQ(layer[g], 0);
     }
     // Blue
     for (int b = 80000; b < 120000; ++b)
     {
-      ASSERT_EQ(stack.m_sampledPoints[i][b], 0);
+      ASSERT_EQ(layer[b], 0);
     }
     // White
     for (int w = 120000; w < 160000; ++w)
     {
-      ASSERT_EQ(stack.m_sampledPoints[i][w], 255);
+      ASSERT_EQ(layer[w], 255);
     }
   }
 }
 
+TEST(IMAGE_STACK, SampleImagesThreadCount)
+{
+  ImageStack serial;
+  serial.SetThreadCount(1);
+  serial.ReadImages("..\\..\\tests\\images\\RGBW");
+  serial.CheckDimensions();
+  serial.SampleImages();
+
+  ImageStack parallel;
+  parallel.SetThreadCount(4);
+  parallel.ReadImages("..\\..\\tests\\images\\RGBW");
+  parallel.CheckDimensions();
+  parallel.SampleImages();
+
+  ASSERT_EQ(serial.m_sampledPoints, parallel.m_sampledPoints);
+}
+
 TEST(IMAGE_STACK, SampleImagesWhite)
 {
   ImageStack stack;
@@ -131,11 +254,11 @@ TEST(IMAGE_STACK, SampleImagesWhite)
   stack.SetSampleResolution(1);
   stack.SampleImages();
   // black.png
-  for (size_t i = 0; i < stack.m_sampledPoints.size(); ++i)
+  for (size_t i = 0; i < stack.m_sampledPoints.GetDepth(); ++i)
   {
-    for (size_t j = 0; j < stack.m_sampledPoints[i].size(); ++j)
+    for (size_t j = 0; j < stack.m_sampledPoints.GetStrideZ(); ++j)
     {
-      ASSERT_EQ(stack.m_sampledPoints[i][j], 255);
+      ASSERT_EQ(stack.m_sampledPoints.Slice(i)[j], 255);
     }
   }
 }
@@ -165,6 +288,622 @@ TEST(IMAGE_STACK, GetImageHeight)
   ASSERT_EQ(stack.GetImageHeight(), 200);
 }
 
+TEST(IMAGE_STACK, CheckDimensionsCached)
+{
+  std::filesystem::path directory = std::filesystem::temp_directory_path() / "image_stack_header_test";
+  std::filesystem::remove_all(directory);
+  std::filesystem::copy("..\\..\\tests\\images\\white", directory);
+
+  ImageStack stack;
+  stack.ReadImages(directory.string());
+  stack.CheckDimensions();
+  ASSERT_EQ(stack.GetImageWidth(), 400);
+
+  // Blank every image, keeping its size and modified time, so only the cached headers are readable
+  std::vector<std::filesystem::path> images;
+  for (const std::filesystem::directory_entry &entry : std::filesystem::directory_iterator(directory))
+  {
+    std::filesystem::file_time_type modified = entry.last_write_time();
+    std::ofstream(entry.path(), std::ios::binary) << std::string(entry.file_size(), '\0');
+    std::filesystem::last_write_time(entry.path(), modified);
+    images.push_back(entry.path());
+  }
+  stack.ReadImages(directory.string());
+  stack.CheckDimensions();
+  ASSERT_EQ(stack.GetImageWidth(), 400);
+  ASSERT_EQ(stack.GetImageHeight(), 200);
+
+  // Once modified the blank images are read again, and fail
+  for (const std::filesystem::path &image : images)
+  {
+    std::filesystem::last_write_time(image, std::filesystem::last_write_time(image) + std::chrono::hours(1));
+  }
+  stack.ReadImages(directory.string());
+  stack.CheckDimensions();
+  ASSERT_EQ(stack.GetImageWidth(), 0);
+  std::filesystem::remove_all(directory);
+}
+
+TEST(IMAGE_STACK, SampleRegionOfInterest)
+{
+  ImageStack stack;
+  stack.ReadImages("..\\..\\tests\\images\\RGBW");
+  stack.CheckDimensions();
+  stack.SetSampleResolution(1);
+  // Inside the green and blue quarters only
+  VoxelBox region;
+  region.x = 10;
+  region.y = 150;
+  region.z = 1;
+  region.width = 20;
+  region.height = 100;
+  region.depth = 3;
+  stack.SetRegionOfInterest(region);
+  stack.SampleImages();
+
+  ASSERT_EQ(stack.m_sampledPoints.GetWidth(), 20);
+  ASSERT_EQ(stack.m_sampledPoints.GetHeight(), 100);
+  ASSERT_EQ(stack.m_sampledPoints.GetDepth(), 3);
+  ASSERT_EQ(stack.GetVolumeBox().y, 150);
+  ASSERT_EQ(stack.GetVolumeBox().z, 1);
+  for (size_t i = 0; i < stack.m_sampledPoints.GetVoxelCount(); ++i)
+  {
+    ASSERT_EQ(stack.m_sampledPoints.Data()[i], 0);
+  }
+}
+
+TEST(IMAGE_STACK, AutoCrop)
+{
+  ImageStack stack;
+  stack.ReadImages("..\\..\\tests\\images\\RGBW");
+  stack.CheckDimensions();
+  stack.SetSampleResolution(1);
+  // Red and green quarters, only the red rows (plus a border row) are kept
+  VoxelBox region;
+  region.width = 400;
+  region.height = 200;
+  region.depth = 1000;
+  stack.SetRegionOfInterest(region);
+  stack.SetAutoCrop(true, 255);
+  stack.SampleImages();
+
+  ASSERT_EQ(stack.m_sampledPoints.GetWidth(), 400);
+  ASSERT_EQ(stack.m_sampledPoints.GetHeight(), 101);
+  ASSERT_EQ(stack.GetVolumeBox().y, 0);
+}
+
+TEST(IMAGE_STACK, SampleImagesFromCache)
+{
+  std::filesystem::path cache = std::filesystem::temp_directory_path() / "image_stack_cache_test";
+  std::filesystem::remove_all(cache);
+
+  ImageStack decoded;
+  decoded.SetCacheDirectory(cache.string());
+  decoded.ReadImages("..\\..\\tests\\images\\RGBW");
+  decoded.CheckDimensions();
+  decoded.SampleImages();
+
+  // Second stack maps the cache written by the first
+  ImageStack mapped;
+  mapped.SetCacheDirectory(cache.string());
+  mapped.ReadImages("..\\..\\tests\\images\\RGBW");
+  mapped.CheckDimensions();
+  mapped.SampleImages();
+  ASSERT_TRUE(mapped.m_sampledPoints.Empty());
+
+  VolumeView<uint8_t> view = std::get<VolumeView<uint8_t>>(mapped.GetVolume());
+  ASSERT_EQ(view.GetWidth(), decoded.m_sampledPoints.GetWidth());
+  ASSERT_EQ(view.GetDepth(), decoded.m_sampledPoints.GetDepth());
+  for (size_t z = 0; z < view.GetDepth(); ++z)
+  {
+    for (size_t y = 0; y < view.GetHeight(); ++y)
+    {
+      for (size_t x = 0; x < view.GetWidth(); ++x)
+      {
+        ASSERT_EQ(view.At(x, y, z), decoded.m_sampledPoints.At(x, y, z));
+      }
+    }
+  }
+  // Reading again releases the mapping, so the cache can be removed
+  mapped.ReadImages("..\\..\\tests\\images\\RGBW");
+  std::filesystem::remove_all(cache);
+}
+
+// VOLUME TESTS
+TEST(VOLUME, ResizeAt)
+{
+  Volume<uint8_t> v(4, 3, 2);
+  ASSERT_EQ(v.GetVoxelCount(), 24);
+  ASSERT_EQ(v.GetStrideY(), 4);
+  ASSERT_EQ(v.GetStrideZ(), 12);
+  v.At(3, 2, 1) = 7;
+  ASSERT_EQ(v.Data()[23], 7);
+  ASSERT_EQ(v.Slice(1)[11], 7);
+}
+
+TEST(VOLUME, SubView)
+{
+  Volume<uint8_t> test(4, 3, 2);
+  test.At(2, 1, 1) = 9;
+  VoxelBox box;
+  box.x = 1;
+  box.y = 1;
+  box.z = 1;
+  box.width = 2;
+  box.height = 2;
+  box.depth = 1;
+  VolumeView<uint8_t> inside = test.View().SubView(box);
+  ASSERT_EQ(inside.GetWidth(), 2);
+  ASSERT_EQ(inside.At(1, 0, 0), 9);
+  ASSERT_TRUE(VoxelBox().Empty());
+}
+
+TEST(VOLUME, View)
+{
+  Volume<uint16_t> v(4, 4, 4);
+  v.At(2, 2, 2) = 1000;
+  VolumeView<uint16_t> view = v.View();
+  ASSERT_EQ(view.Data(), v.Data());
+  ASSERT_EQ(view.At(2, 2, 2), 1000);
+  // Every second voxel, without copying
+  VolumeView<uint16_t> strided(v.Data(), 2, 2, 2, 2, 8, 32);
+  ASSERT_EQ(strided.At(1, 1, 1), 1000);
+}
+
+// RAW VOLUME TESTS
+TEST(RAW_VOLUME, AttachedNRRD)
+{
+  std::filesystem::path path = std::filesystem::temp_directory_path() / "raw_volume_test.nrrd";
+  {
+    std::ofstream file(path, std::ios::binary);
+    file << "NRRD0004\ntype: uchar\ndimension: 3\nsizes: 4 3 2\nencoding: raw\n\n";
+    for (int i = 0; i < 24; ++i)
+    {
+      file.put(static_cast<char>(i));
+    }
+  }
+  RawVolume volume;
+  ASSERT_TRUE(volume.Open(path.string()));
+  VolumeView<uint8_t> view = std::get<VolumeView<uint8_t>>(volume.View());
+  ASSERT_EQ(view.GetWidth(), 4);
+  ASSERT_EQ(view.GetDepth(), 2);
+  ASSERT_EQ(view.At(3, 2, 1), 23);
+  ASSERT_EQ(view.Strided(2).At(1, 1, 0), 10);
+  volume.Close();
+  std::filesystem::remove(path);
+}
+
+TEST(RAW_VOLUME, DetachedBigEndianMetaImage)
+{
+  std::filesystem::path header = std::filesystem::temp_directory_path() / "raw_volume_test.mhd";
+  std::filesystem::path data = std::filesystem::temp_directory_path() / "raw_volume_test.raw";
+  {
+    std::ofstream file(header);
+    file << "ObjectType = Image\nNDims = 3\nDimSize = 2 2 2\nElementType = MET_USHORT\n"
+         << "BinaryDataByteOrderMSB = True\nElementDataFile = raw_volume_test.raw\n";
+    std::ofstream raw(data, std::ios::binary);
+    for (int i = 0; i < 8; ++i)
+    {
+      raw.put(static_cast<char>(i));
+      raw.put(static_cast<char>(1));
+    }
+  }
+  RawVolume volume;
+  ASSERT_TRUE(volume.Open(header.string()));
+  VolumeView<uint16_t> view = std::get<VolumeView<uint16_t>>(volume.View());
+  ASSERT_EQ(view.At(1, 1, 1), (7 << 8) | 1);
+  volume.Close();
+  std::filesystem::remove(header);
+  std::filesystem::remove(data);
+}
+
+TEST(RAW_VOLUME, MalformedHeaders)
+{
+  // Bad numbers and sizes too large to address are refused rather than thrown or read past the file
+  std::filesystem::path path = std::filesystem::temp_directory_path() / "raw_volume_test.mha";
+  RawVolume volume;
+  for (const std::string &fields : {std::string("DimSize = 2 2 2\nHeaderSize = many\n"),
+                                    std::string("DimSize = 2 2 -2\n"),
+                                    std::string("DimSize = 4294967296 4294967296 4294967296\n"),
+                                    std::string("DimSize = 2 2 2\nHeaderSize = 9223372036854775807\n")})
+  {
+    {
+      std::ofstream file(path, std::ios::binary);
+      file << "NDims = 3\n" << fields << "ElementType = MET_UCHAR\nElementDataFile = LOCAL\n" << std::string(8, '\0');
+    }
+    ASSERT_FALSE(volume.Open(path.string()));
+    ASSERT_FALSE(volume.GetError().empty());
+  }
+  path = std::filesystem::temp_directory_path() / "raw_volume_test.nrrd";
+  {
+    std::ofstream file(path, std::ios::binary);
+    file << "NRRD0004\ntype: uchar\ndimension: 3\nsizes: 2 2 2\nbyte skip: 1x\nencoding: raw\n\n" << std::string(8, '\0');
+  }
+  ASSERT_FALSE(volume.Open(path.string()));
+  std::filesystem::remove(path);
+  std::filesystem::remove(std::filesystem::temp_directory_path() / "raw_volume_test.mha");
+}
+
+// VOLUME CACHE TESTS
+TEST(VOLUME_CACHE, StoreLoad)
+{
+  std::filesystem::path directory = std::filesystem::temp_directory_path() / "volume_cache_test";
+  Volume<uint8_t> volume(3, 2, 2);
+  for (size_t i = 0; i < volume.GetVoxelCount(); ++i)
+  {
+    volume.Data()[i] = static_cast<uint8_t>(i * 10);
+  }
+
+  VolumeCache cache;
+  ASSERT_FALSE(cache.Store(1, volume.View()));
+  cache.SetDirectory(directory.string());
+  ASSERT_TRUE(cache.Store(1, volume.View()));
+  ASSERT_FALSE(cache.Load(2));
+  ASSERT_TRUE(cache.Load(1));
+  VolumeView<uint8_t> view = cache.View();
+  ASSERT_EQ(view.GetWidth(), 3);
+  ASSERT_EQ(view.GetHeight(), 2);
+  ASSERT_EQ(view.GetDepth(), 2);
+  ASSERT_EQ(view.At(2, 1, 1), 110);
+  cache.Close();
+  std::filesystem::remove_all(directory);
+}
+
+TEST(VOLUME_CACHE, Key)
+{
+  std::vector<std::string> files = {"a.png", "b.png"};
+  ASSERT_EQ(VolumeCache::Key("images", files, 1), VolumeCache::Key("images", files, 1));
+  ASSERT_NE(VolumeCache::Key("images", files, 1), VolumeCache::Key("images", files, 2));
+  ASSERT_NE(VolumeCache::Key("images", files, 1), VolumeCache::Key("other", files, 1));
+  ASSERT_NE(VolumeCache::Key("images", files, 1), VolumeCache::Key("images", {"a.png"}, 1));
+}
+
+// VOLUME PYRAMID TESTS
+TEST(VOLUME_PYRAMID, Build)
+{
+  // Odd sizes repeat their last voxel, a level of 1 voxel along an axis is never built
+  Volume<uint8_t> base(5, 4, 8);
+  for (size_t i = 0; i < base.GetVoxelCount(); ++i)
+  {
+    base.Data()[i] = static_cast<uint8_t>(i % 7 * 30);
+  }
+  ThreadPool pool(2);
+  VolumePyramid pyramid;
+  pyramid.Build(base.View(), pool);
+  ASSERT_EQ(pyramid.GetLevelCount(), 2);
+  ASSERT_EQ(pyramid.LevelForFactor(2), 1);
+  ASSERT_EQ(pyramid.LevelForFactor(3), -1);
+
+  VolumeView<uint8_t> level = pyramid.Level(1);
+  ASSERT_EQ(level.GetWidth(), 3);
+  ASSERT_EQ(level.GetHeight(), 2);
+  ASSERT_EQ(level.GetDepth(), 4);
+  unsigned int sum = 4;
+  for (size_t z = 2; z < 4; ++z)
+  {
+    for (size_t y = 0; y < 2; ++y)
+    {
+      sum += base.At(4, y, z) * 2;
+    }
+  }
+  ASSERT_EQ(level.At(2, 0, 1), sum / 8);
+}
+
+TEST(VOLUME_PYRAMID, WideRowsMatchScalar)
+{
+  // Rows wide enough for the vectorised path must give the same averages as one voxel at a time
+  Volume<uint8_t> base(83, 3, 2);
+  for (size_t i = 0; i < base.GetVoxelCount(); ++i)
+  {
+    base.Data()[i] = static_cast<uint8_t>((i * 131) % 256);
+  }
+  std::vector<uint8_t> filtered(42 * 2);
+  VolumePyramid::DownsampleLayer(base.View(), 0, filtered.data());
+  for (size_t y = 0; y < 2; ++y)
+  {
+    for (size_t x = 0; x < 42; ++x)
+    {
+      unsigned int sum = 4;
+      size_t x1 = std::min<size_t>(x * 2 + 1, 82);
+      size_t y1 = std::min<size_t>(y * 2 + 1, 2);
+      for (size_t z = 0; z < 2; ++z)
+      {
+        sum += base.At(x * 2, y * 2, z) + base.At(x1, y * 2, z) + base.At(x * 2, y1, z) + base.At(x1, y1, z);
+      }
+      ASSERT_EQ(filtered[y * 42 + x], sum / 8);
+    }
+  }
+}
+
+TEST(VOLUME_PYRAMID, LevelsStayCentred)
+{
+  // A ball marched from each level, placed by its sample offset, keeps its centre
+  Volume<uint8_t> base(96, 96, 96);
+  for (size_t z = 0; z < base.GetDepth(); ++z)
+  {
+    for (size_t y = 0; y < base.GetHeight(); ++y)
+    {
+      for (size_t x = 0; x < base.GetWidth(); ++x)
+      {
+        float dx = x - 45.3f;
+        float dy = y - 47.1f;
+        float dz = z - 49.7f;
+        base.At(x, y, z) = static_cast<uint8_t>(std::clamp(128.0f + 8.0f * (30.0f - std::sqrt(dx * dx + dy * dy + dz * dz)), 0.0f, 255.0f));
+      }
+    }
+  }
+  ThreadPool pool(2);
+  VolumePyramid pyramid;
+  pyramid.Build(base.View(), pool);
+  ASSERT_EQ(pyramid.GetLevelCount(), 4);
+
+  // Area weighted, so the spacing of the vertices does not pull it about
+  auto centre = [](const IndexedMesh &_mesh)
+  {
+    ngl::Vec3 sum(0.0f, 0.0f, 0.0f);
+    float area = 0.0f;
+    for (size_t i = 0; i + 2 < _mesh.indices.size(); i += 3)
+    {
+      const ngl::Vec3 &a = _mesh.vertices[_mesh.indices[i]];
+      const ngl::Vec3 &b = _mesh.vertices[_mesh.indices[i + 1]];
+      const ngl::Vec3 &c = _mesh.vertices[_mesh.indices[i + 2]];
+      float triangle = (b - a).cross(c - a).length();
+      sum += (a + b + c) * triangle;
+      area += triangle;
+    }
+    return sum / (3.0f * area);
+  };
+  Mesh m;
+  m.SetSurfaceLevel(128);
+  m.Initialise(pyramid.Level(0), 96, 96, 1);
+  ngl::Vec3 expected = centre(m.MarchCubesIndexed());
+  for (unsigned int level = 1; level < pyramid.GetLevelCount(); ++level)
+  {
+    VolumeView<uint8_t> view = pyramid.Level(level);
+    m.Initialise(view, 96, 96, 1u << level);
+    float offset = VolumePyramid::SampleOffset(level);
+    m.SetOrigin(offset, offset, offset, static_cast<unsigned int>(view.GetDepth()));
+    ngl::Vec3 found = centre(m.MarchCubesIndexed());
+    // Well within the shift left by placing the level's points on the block corners, at 0.1 units per pixel
+    float tolerance = 0.4f * offset * 0.1f;
+    ASSERT_NEAR(found.m_x, expected.m_x, tolerance);
+    ASSERT_NEAR(found.m_y, expected.m_y, tolerance);
+    ASSERT_NEAR(found.m_z, expected.m_z, tolerance);
+  }
+}
+
+// BRICK VOLUME TESTS
+TEST(BRICK_VOLUME, Build)
+{
+  // Only bricks holding more than one value are allocated, edge bricks are cut short
+  Volume<uint8_t> dense(19, 10, 9);
+  dense.At(17, 9, 8) = 200;
+  dense.At(3, 2, 1) = 50;
+  ThreadPool pool(2);
+  BrickVolume<uint8_t> bricks;
+  bricks.Build(dense.View(), pool);
+  ASSERT_EQ(bricks.GetBricksX(), 3);
+  ASSERT_EQ(bricks.GetBricksY(), 2);
+  ASSERT_EQ(bricks.GetBricksZ(), 2);
+  ASSERT_EQ(bricks.GetAllocatedBricks(), 2);
+  ASSERT_EQ(bricks.GetRanges()[0].first, 0);
+  ASSERT_EQ(bricks.GetRanges()[0].second, 50);
+
+  std::vector<uint8_t> layer(19 * 10);
+  for (size_t z = 0; z < dense.GetDepth(); ++z)
+  {
+    bricks.CopyLayer(z, layer.data());
+    for (size_t y = 0; y < dense.GetHeight(); ++y)
+    {
+      for (size_t x = 0; x < dense.GetWidth(); ++x)
+      {
+        ASSERT_EQ(bricks.At(x, y, z), dense.At(x, y, z));
+        ASSERT_EQ(layer[y * 19 + x], dense.At(x, y, z));
+      }
+    }
+  }
+}
+
+TEST(BRICK_VOLUME, AddBricks)
+{
+  // Bricking a layer of bricks at a time from slabs of the volume matches bricking it whole
+  Volume<uint8_t> dense(19, 10, 21);
+  for (size_t i = 0; i < dense.GetVoxelCount(); ++i)
+  {
+    dense.Data()[i] = static_cast<uint8_t>(i % 7 == 0 ? i : 0);
+  }
+  ThreadPool pool(2);
+  BrickVolume<uint8_t> whole;
+  whole.Build(dense.View(), pool);
+
+  BrickVolume<uint8_t> slabs;
+  slabs.Reset(19, 10, 21);
+  for (size_t bz = 0; bz < slabs.GetBricksZ(); ++bz)
+  {
+    Volume<uint8_t> slab(19, 10, std::min(c_brickSize, 21 - bz * c_brickSize));
+    for (size_t z = 0; z < slab.GetDepth(); ++z)
+    {
+      std::copy_n(dense.Slice(bz * c_brickSize + z), dense.GetStrideZ(), slab.Slice(z));
+    }
+    slabs.AddBricks(slab.View(), bz, pool);
+  }
+  ASSERT_EQ(slabs.GetRanges(), whole.GetRanges());
+  ASSERT_EQ(slabs.GetAllocatedBricks(), whole.GetAllocatedBricks());
+  for (size_t z = 0; z < dense.GetDepth(); ++z)
+  {
+    for (size_t y = 0; y < dense.GetHeight(); ++y)
+    {
+      for (size_t x = 0; x < dense.GetWidth(); ++x)
+      {
+        ASSERT_EQ(slabs.At(x, y, z), dense.At(x, y, z));
+      }
+    }
+  }
+}
+
+TEST(BRICK_VOLUME, ActiveBricks)
+{
+  // A brick is active when it or a neighbour it shares cubes with crosses the level
+  std::vector<std::pair<uint8_t, uint8_t>> ranges = {{0, 0}, {0, 0}, {0, 0}, {200, 200}};
+  std::vector<char> active = ActiveBricks(ranges, 2, 2, 1, 100);
+  ASSERT_EQ(active, std::vector<char>({1, 1, 1, 0}));
+}
+
+// CUBE CLASSIFIER TESTS
+TEST(CUBE_CLASSIFIER, PathsAgree)
+{
+  // Every supported path must keep the same cubes with the same indices as the scalar path
+  const size_t width = 77;
+  std::vector<uint8_t> voxels(width * 4);
+  for (size_t i = 0; i < voxels.size(); ++i)
+  {
+    voxels[i] = static_cast<uint8_t>((i * 2654435761u) >> 24);
+  }
+  const uint8_t *rows[4] = {&voxels[0], &voxels[width], &voxels[width * 2], &voxels[width * 3]};
+
+  for (int level : {0, 1, 100, 128, 255, 256})
+  {
+    std::vector<uint32_t> scalarX(width);
+    std::vector<uint8_t> scalarIndex(width);
+    size_t scalarCount = CubeClassifier::ClassifyRow(rows, width, level, scalarX.data(), scalarIndex.data(), CubeClassifier::Path::Scalar);
+    for (CubeClassifier::Path path : {CubeClassifier::Path::SSE2, CubeClassifier::Path::AVX2})
+    {
+      if (!CubeClassifier::Supported(path))
+      {
+        continue;
+      }
+      std::vector<uint32_t> x(width);
+      std::vector<uint8_t> index(width);
+      ASSERT_EQ(CubeClassifier::ClassifyRow(rows, width, level, x.data(), index.data(), path), scalarCount);
+      ASSERT_EQ(x, scalarX);
+      ASSERT_EQ(index, scalarIndex);
+    }
+  }
+
+  // Corner 0 of cube 5 alone is inside
+  std::vector<uint8_t> single(width * 4, 0);
+  single[5] = 200;
+  const uint8_t *singleRows[4] = {&single[0], &single[width], &single[width * 2], &single[width * 3]};
+  std::vector<uint32_t> x(width);
+  std::vector<uint8_t> index(width);
+  ASSERT_EQ(CubeClassifier::ClassifyRow(singleRows, width, 100, x.data(), index.data()), 2);
+  ASSERT_EQ(x[0], 4);
+  ASSERT_EQ(index[0], 2);
+  ASSERT_EQ(x[1], 5);
+  ASSERT_EQ(index[1], 1);
+}
+
+// OIIO STACK TESTS
+TEST(OIIO_STACK, MultiPageTiff)
+{
+  // Two pages of 16-bit RGB, only the first channel is read
+  std::filesystem::path path = std::filesystem::temp_directory_path() / "oiio_stack_test.tif";
+  {
+    OIIO::ImageSpec spec(4, 3, 3, OIIO::TypeDesc::UINT16);
+    auto out = OIIO::ImageOutput::create(path.string());
+    ASSERT_TRUE(out);
+    for (uint16_t page = 0; page < 2; ++page)
+    {
+      std::vector<uint16_t> pixels(4 * 3 * 3);
+      for (size_t i = 0; i < pixels.size(); ++i)
+      {
+        pixels[i] = i % 3 == 0 ? static_cast<uint16_t>(1000 * (page + 1) + i / 3) : 7;
+      }
+      ASSERT_TRUE(out->open(path.string(), spec, page == 0 ? OIIO::ImageOutput::Create : OIIO::ImageOutput::AppendSubimage));
+      ASSERT_TRUE(out->write_image(OIIO::TypeDesc::UINT16, pixels.data()));
+    }
+    out->close();
+  }
+
+  ThreadPool pool(2);
+  OiioStack stack;
+  ASSERT_TRUE(stack.Open({path.string()}));
+  ASSERT_EQ(stack.GetWidth(), 4);
+  ASSERT_EQ(stack.GetHeight(), 3);
+  ASSERT_EQ(stack.GetDepth(), 2);
+  ASSERT_TRUE(stack.LoadVoxels(pool, 1));
+  VolumeView<uint16_t> view = std::get<VolumeView<uint16_t>>(stack.View());
+  ASSERT_EQ(view.At(3, 2, 0), 1011);
+  ASSERT_EQ(view.At(1, 0, 1), 2001);
+
+  // Every second row, column and page
+  ASSERT_TRUE(stack.LoadVoxels(pool, 2));
+  view = std::get<VolumeView<uint16_t>>(stack.View());
+  ASSERT_EQ(view.GetWidth(), 2);
+  ASSERT_EQ(view.GetDepth(), 1);
+  ASSERT_EQ(view.At(1, 1, 0), 1010);
+  stack.Clear();
+  std::filesystem::remove(path);
+}
+
+// DICOM SERIES TESTS
+namespace
+{
+  // Write a 2x2 explicit VR little endian CT slice at height _z, every pixel _hounsfield
+  void WriteDicomSlice(const std::filesystem::path &_path, const std::string &_z, int16_t _hounsfield)
+  {
+    std::ofstream file(_path, std::ios::binary);
+    auto element = [&](uint16_t _group, uint16_t _element, const char *_vr, const std::string &_value)
+    {
+      file.write(reinterpret_cast<const char *>(&_group), 2);
+      file.write(reinterpret_cast<const char *>(&_element), 2);
+      file.write(_vr, 2);
+      if (std::string(_vr) == "OW")
+      {
+        uint32_t length = static_cast<uint32_t>(_value.size());
+        file.write("\0\0", 2);
+        file.write(reinterpret_cast<const char *>(&length), 4);
+      }
+      else
+      {
+        uint16_t length = static_cast<uint16_t>(_value.size());
+        file.write(reinterpret_cast<const char *>(&length), 2);
+      }
+      file << _value;
+    };
+    auto us = [](uint16_t _value) { return std::string(reinterpret_cast<const char *>(&_value), 2); };
+
+    file << std::string(128, '\0') << "DICM";
+    element(0x0002, 0x0010, "UI", std::string("1.2.840.10008.1.2.1") + '\0');
+    element(0x0020, 0x0032, "DS", "0\\0\\" + _z);
+    element(0x0028, 0x0002, "US", us(1));
+    element(0x0028, 0x0010, "US", us(2));
+    element(0x0028, 0x0011, "US", us(2));
+    element(0x0028, 0x0100, "US", us(16));
+    element(0x0028, 0x0103, "US", us(0));
+    element(0x0028, 0x1052, "DS", "-1024 ");
+    element(0x0028, 0x1053, "DS", "1 ");
+    std::string pixels;
+    for (int i = 0; i < 4; ++i)
+    {
+      pixels += us(static_cast<uint16_t>(_hounsfield + 1024));
+    }
+    element(0x7FE0, 0x0010, "OW", pixels);
+  }
+}
+
+TEST(DICOM_SERIES, ReadOrderedHounsfield)
+{
+  std::filesystem::path directory = std::filesystem::temp_directory_path() / "dicom_series_test";
+  std::filesystem::create_directories(directory);
+  // File names are deliberately out of patient order
+  WriteDicomSlice(directory / "a.dcm", "20", 1000);
+  WriteDicomSlice(directory / "b.dcm", "10", -1000);
+  WriteDicomSlice(directory / "c.dcm", "30", 3000);
+
+  ThreadPool pool(2);
+  DicomSeries series;
+  ASSERT_TRUE(series.ReadHeaders({(directory / "a.dcm").string(), (directory / "b.dcm").string(), (directory / "c.dcm").string()}, pool));
+  ASSERT_TRUE(series.LoadVoxels(pool));
+  const Volume<int16_t> &volume = series.GetVolume();
+  ASSERT_EQ(volume.GetWidth(), 2);
+  ASSERT_EQ(volume.GetDepth(), 3);
+  ASSERT_EQ(volume.At(1, 1, 0), -1000);
+  ASSERT_EQ(volume.At(1, 1, 1), 1000);
+  ASSERT_EQ(volume.At(1, 1, 2), 3000);
+  std::filesystem::remove_all(directory);
+}
+
 // MESH TESTS
 TEST(MESH, Constructor)
 {
@@ -173,16 +912,1008 @@ TEST(MESH, Constructor)
 
 TEST(MESH, Initialise)
 {
-  std::vector<std::vector<int>> test;
+  Volume<uint8_t> test;
   Mesh m;
-  m.Initialise(test, 100, 200, 20);
+  m.Initialise(test.View(), 100, 200, 20);
 }
 
 TEST(MESH, SetGetSurfaceLevel)
 {
-  std::vector<std::vector<int>> test;
+  Volume<uint8_t> test;
   Mesh m;
-  m.Initialise(test, 100, 200, 20);
+  m.Initialise(test.View(), 100, 200, 20);
   m.SetSurfaceLevel(100);
   ASSERT_EQ(m.GetSurfaceLevel(), 100);
-}
\ No newline at end of file
+}
+
+TEST(MESH, SetSurfaceLevelRange)
+{
+  Mesh m;
+  m.SetSurfaceLevel(-500);
+  ASSERT_EQ(m.GetSurfaceLevel(), 0);
+  m.SetSurfaceLevelRange(-1024, 3071);
+  m.SetSurfaceLevel(-500);
+  ASSERT_EQ(m.GetSurfaceLevel(), -500);
+}
+
+TEST(MESH, MarchCubes)
+{
+  // A single voxel above the surface level is enclosed by 8 triangles
+  Volume<uint8_t> test(3, 3, 3);
+  test.At(1, 1, 1) = 255;
+  Mesh m;
+  m.SetSurfaceLevel(100);
+  m.Initialise(test.View(), 3, 3, 1);
+  ASSERT_EQ(m.MarchCubes().size(), 8 * 3);
+}
+
+TEST(MESH, MarchCubesExactSize)
+{
+  // Slabs are counted before they are filled, so the buffer is allocated once at its final size
+  Volume<uint8_t> test(12, 11, 10);
+  for (size_t i = 0; i < test.GetVoxelCount(); ++i)
+  {
+    test.Data()[i] = static_cast<uint8_t>((i * 2654435761u) >> 24);
+  }
+  Mesh m;
+  m.SetSurfaceLevel(128);
+  m.Initialise(test.View(), 12, 11, 1);
+  std::vector<ngl::Vec3> vertices = m.MarchCubes();
+  ASSERT_FALSE(vertices.empty());
+  ASSERT_EQ(vertices.capacity(), vertices.size());
+  ASSERT_EQ(m.MarchCubes(), vertices);
+}
+TEST(MESH, SetOrigin)
+{
+  // Marching a crop placed at its origin gives the same surface as marching everything
+  Volume<uint8_t> test(7, 7, 7);
+  test.At(3, 4, 3) = 255;
+  Mesh m;
+  m.SetSurfaceLevel(100);
+  m.Initialise(test.View(), 7, 7, 1);
+  std::vector<ngl::Vec3> whole = m.MarchCubes();
+
+  VoxelBox box;
+  box.x = 2;
+  box.y = 3;
+  box.z = 2;
+  box.width = 3;
+  box.height = 3;
+  box.depth = 3;
+  m.Initialise(test.View().SubView(box), 7, 7, 1);
+  m.SetOrigin(2, 3, 2, 7);
+  std::vector<ngl::Vec3> cropped = m.MarchCubes();
+  ASSERT_EQ(cropped.size(), whole.size());
+  for (size_t i = 0; i < whole.size(); ++i)
+  {
+    ASSERT_NEAR(cropped[i].m_x, whole[i].m_x, 1e-4f);
+    ASSERT_NEAR(cropped[i].m_y, whole[i].m_y, 1e-4f);
+    ASSERT_NEAR(cropped[i].m_z, whole[i].m_z, 1e-4f);
+  }
+}
+
+TEST(MESH, StreamLayers)
+{
+  // Streaming one layer at a time must give the same mesh as marching the whole volume
+  Volume<uint8_t> test(4, 3, 5);
+  for (size_t z = 0; z < test.GetDepth(); ++z)
+  {
+    for (size_t y = 0; y < test.GetHeight(); ++y)
+    {
+      for (size_t x = 0; x < test.GetWidth(); ++x)
+      {
+        test.At(x, y, z) = static_cast<uint8_t>((x * 37 + y * 91 + z * 53) % 256);
+      }
+    }
+  }
+  Mesh m;
+  m.SetSurfaceLevel(128);
+  m.Initialise(test.View(), 4, 3, 1);
+  std::vector<ngl::Vec3> marched = m.MarchCubes();
+
+  m.BeginStream(4, 3, 5, 4, 3, 1);
+  for (size_t z = 0; z < test.GetDepth(); ++z)
+  {
+    m.StreamLayer(test.View().Layer(z));
+  }
+  std::vector<ngl::Vec3> streamed = m.EndStream();
+  ASSERT_FALSE(marched.empty());
+  ASSERT_EQ(streamed, marched);
+}
+
+TEST(MESH, SkipEmptyBricks)
+{
+  // Skipping bricks away from the surface must not change the mesh, whether dense or bricked
+  Volume<uint8_t> test(30, 21, 19);
+  for (size_t z = 0; z < test.GetDepth(); ++z)
+  {
+    for (size_t y = 0; y < test.GetHeight(); ++y)
+    {
+      for (size_t x = 0; x < test.GetWidth(); ++x)
+      {
+        float dx = x - 8.0f;
+        float dy = y - 9.0f;
+        float dz = z - 8.0f;
+        test.At(x, y, z) = dx * dx + dy * dy + dz * dz < 30.0f ? 255 : 0;
+      }
+    }
+  }
+  Mesh m;
+  m.SetSurfaceLevel(128);
+
+  // Streamed layers are never skipped
+  m.BeginStream(30, 21, 19, 30, 21, 1);
+  for (size_t z = 0; z < test.GetDepth(); ++z)
+  {
+    m.StreamLayer(test.View().Layer(z));
+  }
+  std::vector<ngl::Vec3> everyCube = m.EndStream();
+
+  m.Initialise(test.View(), 30, 21, 1);
+  std::vector<ngl::Vec3> dense = m.MarchCubes();
+
+  ThreadPool pool(2);
+  BrickVolume<uint8_t> bricks;
+  bricks.Build(test.View(), pool);
+  ASSERT_LT(bricks.GetAllocatedBricks(), bricks.GetBrickCount());
+  m.Initialise(bricks, 30, 21, 1);
+  std::vector<ngl::Vec3> sparse = m.MarchCubes();
+
+  ASSERT_FALSE(everyCube.empty());
+  ASSERT_EQ(dense, everyCube);
+  ASSERT_EQ(sparse, everyCube);
+}
+
+TEST(MESH, SameMeshForAnyThreadCount)
+{
+  // Slabs are gathered in z order, so more threads must not reorder the vertices
+  Volume<uint8_t> test(23, 17, 29);
+  for (size_t i = 0; i < test.GetVoxelCount(); ++i)
+  {
+    test.Data()[i] = static_cast<uint8_t>((i * 2654435761u) >> 24);
+  }
+  Mesh m;
+  m.SetSurfaceLevel(128);
+  m.SetThreadCount(1);
+  m.Initialise(test.View(), 23, 17, 1);
+  std::vector<ngl::Vec3> serial = m.MarchCubes();
+  m.SetThreadCount(4);
+  std::vector<ngl::Vec3> parallel = m.MarchCubes();
+  ASSERT_FALSE(serial.empty());
+  ASSERT_EQ(parallel, serial);
+}
+
+TEST(MESH, ClassifiedRowsMatchScalar)
+{
+  // 8-bit rows go through CubeClassifier, the same values as 16-bit voxels are classified one cube at a time
+  Volume<uint8_t> bytes(70, 9, 6);
+  Volume<uint16_t> words(70, 9, 6);
+  for (size_t i = 0; i < bytes.GetVoxelCount(); ++i)
+  {
+    bytes.Data()[i] = static_cast<uint8_t>((i * 2654435761u) >> 24);
+    words.Data()[i] = bytes.Data()[i];
+  }
+  Mesh m;
+  m.SetSurfaceLevel(90);
+  m.Initialise(bytes.View(), 70, 9, 1);
+  std::vector<ngl::Vec3> classified = m.MarchCubes();
+  m.Initialise(words.View(), 70, 9, 1);
+  std::vector<ngl::Vec3> scalar = m.MarchCubes();
+  ASSERT_FALSE(scalar.empty());
+  ASSERT_EQ(classified, scalar);
+
+  // Floats and voxels that are not adjacent along x take the other kernels
+  Volume<float> floats(70, 9, 6);
+  Volume<uint8_t> spaced(140, 9, 6);
+  for (size_t i = 0; i < bytes.GetVoxelCount(); ++i)
+  {
+    floats.Data()[i] = bytes.Data()[i];
+    spaced.Data()[i * 2] = bytes.Data()[i];
+  }
+  m.Initialise(floats.View(), 70, 9, 1);
+  ASSERT_EQ(m.MarchCubes(), classified);
+  m.Initialise(VolumeView<uint8_t>(spaced.Data(), 70, 9, 6, 2, 140, 140 * 9), 70, 9, 1);
+  ASSERT_EQ(m.MarchCubes(), classified);
+}
+
+TEST(MESH, MarchCubesIndexed)
+{
+  // Expanding the indices gives the triangle soup back, with every vertex stored once
+  // Deep enough for the slabs to be marched in several chunks that are welded together
+  Volume<uint8_t> test(21, 18, 40);
+  for (size_t z = 0; z < test.GetDepth(); ++z)
+  {
+    for (size_t y = 0; y < test.GetHeight(); ++y)
+    {
+      for (size_t x = 0; x < test.GetWidth(); ++x)
+      {
+        float dx = x - 10.0f;
+        float dy = y - 9.0f;
+        float dz = z - 20.0f;
+        test.At(x, y, z) = static_cast<uint8_t>(std::min(255.0f, 40.0f * std::sqrt(dx * dx + dy * dy + dz * dz * 0.2f)));
+      }
+    }
+  }
+  Mesh m;
+  m.SetSurfaceLevel(200);
+  m.Initialise(test.View(), 21, 18, 1);
+  std::vector<ngl::Vec3> soup = m.MarchCubes();
+  m.SetThreadCount(3);
+  IndexedMesh indexed = m.MarchCubesIndexed();
+  ASSERT_EQ(indexed.indices.size(), soup.size());
+  for (size_t i = 0; i < soup.size(); ++i)
+  {
+    ASSERT_EQ(indexed.vertices[indexed.indices[i]], soup[i]);
+  }
+  std::vector<std::tuple<float, float, float>> unique;
+  for (const ngl::Vec3 &vertex : indexed.vertices)
+  {
+    unique.emplace_back(vertex.m_x, vertex.m_y, vertex.m_z);
+  }
+  std::sort(unique.begin(), unique.end());
+  ASSERT_EQ(std::unique(unique.begin(), unique.end()), unique.end());
+  ASSERT_LT(indexed.vertices.size() * 4, soup.size());
+
+  m.SetThreadCount(1);
+  IndexedMesh serial = m.MarchCubesIndexed();
+  ASSERT_EQ(serial.vertices, indexed.vertices);
+  ASSERT_EQ(serial.indices, indexed.indices);
+}
+
+TEST(MESH, MarchCubesIncremental)
+{
+  // Moving the level re-marches only some bricks, yet gives the same mesh as starting again at that level
+  Volume<uint8_t> test(30, 27, 25);
+  for (size_t z = 0; z < test.GetDepth(); ++z)
+  {
+    for (size_t y = 0; y < test.GetHeight(); ++y)
+    {
+      for (size_t x = 0; x < test.GetWidth(); ++x)
+      {
+        float dx = x - 12.0f;
+        float dy = y - 13.0f;
+        float dz = z - 11.0f;
+        test.At(x, y, z) = static_cast<uint8_t>(std::min(255.0f, 25.0f * std::sqrt(dx * dx + dy * dy + dz * dz)));
+      }
+    }
+  }
+  auto triangles = [](const std::vector<ngl::Vec3> &_soup)
+  {
+    std::vector<std::tuple<float, float, float, float, float, float, float, float, float>> sorted;
+    for (size_t i = 0; i + 2 < _soup.size(); i += 3)
+    {
+      sorted.emplace_back(_soup[i].m_x, _soup[i].m_y, _soup[i].m_z, _soup[i + 1].m_x, _soup[i + 1].m_y, _soup[i + 1].m_z,
+                          _soup[i + 2].m_x, _soup[i + 2].m_y, _soup[i + 2].m_z);
+    }
+    std::sort(sorted.begin(), sorted.end());
+    return sorted;
+  };
+  auto expand = [](const IndexedMesh &_mesh)
+  {
+    std::vector<ngl::Vec3> soup;
+    for (uint32_t index : _mesh.indices)
+    {
+      soup.push_back(_mesh.vertices[index]);
+    }
+    return soup;
+  };
+
+  Mesh m;
+  m.SetThreadCount(3);
+  m.SetSurfaceLevel(150);
+  m.Initialise(test.View(), 30, 27, 1);
+  IndexedMesh first = m.MarchCubesIncremental();
+  ASSERT_EQ(triangles(expand(first)), triangles(m.MarchCubes()));
+
+  ThreadPool pool(2);
+  BrickVolume<uint8_t> bricks;
+  bricks.Build(test.View(), pool);
+  for (int level : {100, 220, 30})
+  {
+    m.SetSurfaceLevel(level);
+    IndexedMesh moved = m.MarchCubesIncremental();
+    Mesh fresh;
+    fresh.SetSurfaceLevel(level);
+    fresh.Initialise(test.View(), 30, 27, 1);
+    IndexedMesh again = fresh.MarchCubesIncremental();
+    ASSERT_EQ(moved.vertices, again.vertices);
+    ASSERT_EQ(moved.indices, again.indices);
+    ASSERT_EQ(triangles(expand(moved)), triangles(fresh.MarchCubes()));
+
+    fresh.Initialise(bricks, 30, 27, 1);
+    IndexedMesh sparse = fresh.MarchCubesIncremental();
+    ASSERT_EQ(sparse.vertices, again.vertices);
+    ASSERT_EQ(sparse.indices, again.indices);
+  }
+}
+
+TEST(MESH, MarchCubesIncrementalWelded)
+{
+  // Vertices on brick faces are shared across bricks, giving the indexed mesh's vertices and a closed surface
+  Volume<uint8_t> test(64, 64, 64);
+  for (size_t z = 0; z < test.GetDepth(); ++z)
+  {
+    for (size_t y = 0; y < test.GetHeight(); ++y)
+    {
+      for (size_t x = 0; x < test.GetWidth(); ++x)
+      {
+        float dx = x - 31.5f;
+        float dy = y - 30.2f;
+        float dz = z - 32.7f;
+        test.At(x, y, z) = static_cast<uint8_t>(std::min(255.0f, 6.0f * std::sqrt(dx * dx + dy * dy + dz * dz)));
+      }
+    }
+  }
+  auto sortedVertices = [](const IndexedMesh &_mesh)
+  {
+    std::vector<std::tuple<float, float, float>> sorted;
+    for (const ngl::Vec3 &vertex : _mesh.vertices)
+    {
+      sorted.emplace_back(vertex.m_x, vertex.m_y, vertex.m_z);
+    }
+    std::sort(sorted.begin(), sorted.end());
+    return sorted;
+  };
+  auto openEdges = [](const IndexedMesh &_mesh)
+  {
+    std::vector<std::pair<uint32_t, uint32_t>> edges;
+    for (size_t i = 0; i + 2 < _mesh.indices.size(); i += 3)
+    {
+      for (size_t corner = 0; corner < 3; ++corner)
+      {
+        edges.emplace_back(_mesh.indices[i + corner], _mesh.indices[i + (corner + 1) % 3]);
+      }
+    }
+    std::sort(edges.begin(), edges.end());
+    return std::count_if(edges.begin(), edges.end(), [&](const std::pair<uint32_t, uint32_t> &_edge)
+    {
+      return !std::binary_search(edges.begin(), edges.end(), std::make_pair(_edge.second, _edge.first));
+    });
+  };
+
+  Mesh m;
+  m.SetThreadCount(3);
+  m.SetSurfaceLevel(100);
+  m.Initialise(test.View(), 64, 64, 1);
+  for (int level : {100, 60, 140})
+  {
+    m.SetSurfaceLevel(level);
+    IndexedMesh incremental = m.MarchCubesIncremental();
+    IndexedMesh indexed = m.MarchCubesIndexed();
+    ASSERT_EQ(incremental.vertices.size(), indexed.vertices.size());
+    ASSERT_EQ(incremental.indices.size(), indexed.indices.size());
+    ASSERT_EQ(sortedVertices(incremental), sortedVertices(indexed));
+    ASSERT_EQ(openEdges(indexed), 0);
+    ASSERT_EQ(openEdges(incremental), 0);
+  }
+}
+
+TEST(MESH, FlyingEdges)
+{
+  // Same triangles as the classic marcher, each vertex made once, for a blob, noise and
+  // a plane the rows never cross along x (only their trimmed ends tell the rows apart)
+  Volume<uint8_t> blob(23, 19, 21);
+  Volume<uint8_t> noise(17, 14, 12);
+  Volume<uint8_t> plane(12, 10, 9);
+  uint32_t seed = 12345;
+  for (Volume<uint8_t> *test : {&blob, &noise, &plane})
+  {
+    for (size_t z = 0; z < test->GetDepth(); ++z)
+    {
+      for (size_t y = 0; y < test->GetHeight(); ++y)
+      {
+        for (size_t x = 0; x < test->GetWidth(); ++x)
+        {
+          float dx = x - 11.0f;
+          float dy = y - 8.0f;
+          float dz = z - 10.0f;
+          seed = seed * 1664525u + 1013904223u;
+          test->At(x, y, z) = test == &blob ? static_cast<uint8_t>(std::min(255.0f, 25.0f * std::sqrt(dx * dx + dy * dy + dz * dz)))
+                            : test == &noise ? static_cast<uint8_t>(seed >> 24)
+                            : static_cast<uint8_t>(y >= 4 ? 200 : 10);
+        }
+      }
+    }
+  }
+  auto triangles = [](const std::vector<ngl::Vec3> &_soup)
+  {
+    std::vector<std::tuple<float, float, float, float, float, float, float, float, float>> sorted;
+    for (size_t i = 0; i + 2 < _soup.size(); i += 3)
+    {
+      sorted.emplace_back(_soup[i].m_x, _soup[i].m_y, _soup[i].m_z, _soup[i + 1].m_x, _soup[i + 1].m_y, _soup[i + 1].m_z,
+                          _soup[i + 2].m_x, _soup[i + 2].m_y, _soup[i + 2].m_z);
+    }
+    std::sort(sorted.begin(), sorted.end());
+    return sorted;
+  };
+
+  ThreadPool pool(2);
+  for (Volume<uint8_t> *test : {&blob, &noise, &plane})
+  {
+    Mesh m;
+    m.SetSurfaceLevel(128);
+    m.Initialise(test->View(), static_cast<unsigned int>(test->GetWidth()), static_cast<unsigned int>(test->GetHeight()), 1);
+    std::vector<ngl::Vec3> classic = m.MarchCubes();
+    ASSERT_FALSE(classic.empty());
+
+    m.SetEngine(Mesh::Engine::FlyingEdges);
+    m.SetThreadCount(3);
+    IndexedMesh flying = m.MarchCubesIndexed();
+    std::vector<std::tuple<float, float, float>> unique;
+    for (const ngl::Vec3 &vertex : flying.vertices)
+    {
+      unique.emplace_back(vertex.m_x, vertex.m_y, vertex.m_z);
+    }
+    std::sort(unique.begin(), unique.end());
+    ASSERT_EQ(std::unique(unique.begin(), unique.end()), unique.end());
+    ASSERT_EQ(triangles(m.MarchCubes()), triangles(classic));
+
+    m.SetThreadCount(1);
+    IndexedMesh serial = m.MarchCubesIndexed();
+    ASSERT_EQ(serial.vertices, flying.vertices);
+    ASSERT_EQ(serial.indices, flying.indices);
+
+    BrickVolume<uint8_t> bricks;
+    bricks.Build(test->View(), pool);
+    m.Initialise(bricks, static_cast<unsigned int>(test->GetWidth()), static_cast<unsigned int>(test->GetHeight()), 1);
+    IndexedMesh sparse = m.MarchCubesIndexed();
+    ASSERT_EQ(sparse.vertices, flying.vertices);
+    ASSERT_EQ(sparse.indices, flying.indices);
+  }
+}
+
+TEST(MESH, SurfaceNets)
+{
+  // A closed blob gives a closed, consistently wound net enclosing about the same volume as marching cubes
+  Volume<uint8_t> test(26, 22, 24);
+  for (size_t z = 0; z < test.GetDepth(); ++z)
+  {
+    for (size_t y = 0; y < test.GetHeight(); ++y)
+    {
+      for (size_t x = 0; x < test.GetWidth(); ++x)
+      {
+        float dx = x - 12.0f;
+        float dy = y - 10.0f;
+        float dz = z - 11.5f;
+        test.At(x, y, z) = static_cast<uint8_t>(std::max(0.0f, 255.0f - 28.0f * std::sqrt(dx * dx + dy * dy * 1.5f + dz * dz)));
+      }
+    }
+  }
+  auto volume = [](const IndexedMesh &_mesh)
+  {
+    double sum = 0.0;
+    for (size_t i = 0; i + 2 < _mesh.indices.size(); i += 3)
+    {
+      ngl::Vec3 a = _mesh.vertices[_mesh.indices[i]];
+      ngl::Vec3 b = _mesh.vertices[_mesh.indices[i + 1]];
+      ngl::Vec3 c = _mesh.vertices[_mesh.indices[i + 2]];
+      sum += a.dot(b.cross(c)) / 6.0;
+    }
+    return sum;
+  };
+
+  Mesh m;
+  m.SetSurfaceLevel(100);
+  m.Initialise(test.View(), 26, 22, 1);
+  IndexedMesh cubes = m.MarchCubesIndexed();
+  m.SetEngine(Mesh::Engine::SurfaceNets);
+  m.SetThreadCount(3);
+  IndexedMesh net = m.MarchCubesIndexed();
+  ASSERT_FALSE(net.indices.empty());
+  // One vertex per crossed cell and two triangles per crossed edge, close to the shared marching cubes counts
+  ASSERT_LT(net.vertices.size() * 10, cubes.vertices.size() * 11);
+  ASSERT_LT(net.indices.size() * 10, cubes.indices.size() * 11);
+  double cubesVolume = volume(cubes);
+  double netVolume = volume(net);
+  ASSERT_GT(netVolume * cubesVolume, 0.0);
+  ASSERT_NEAR(netVolume / cubesVolume, 1.0, 0.1);
+
+  // Every edge is shared by exactly two triangles, running opposite ways
+  std::vector<std::pair<uint32_t, uint32_t>> edges;
+  for (size_t i = 0; i < net.indices.size(); i += 3)
+  {
+    for (size_t j = 0; j < 3; ++j)
+    {
+      edges.emplace_back(net.indices[i + j], net.indices[i + (j + 1) % 3]);
+    }
+  }
+  std::sort(edges.begin(), edges.end());
+  ASSERT_EQ(std::adjacent_find(edges.begin(), edges.end()), edges.end());
+  for (const std::pair<uint32_t, uint32_t> &edge : edges)
+  {
+    ASSERT_TRUE(std::binary_search(edges.begin(), edges.end(), std::make_pair(edge.second, edge.first)));
+  }
+
+  m.SetThreadCount(1);
+  IndexedMesh serial = m.MarchCubesIndexed();
+  ASSERT_EQ(serial.vertices, net.vertices);
+  ASSERT_EQ(serial.indices, net.indices);
+  ThreadPool pool(2);
+  BrickVolume<uint8_t> bricks;
+  bricks.Build(test.View(), pool);
+  m.Initialise(bricks, 26, 22, 1);
+  IndexedMesh sparse = m.MarchCubesIndexed();
+  ASSERT_EQ(sparse.vertices, net.vertices);
+  ASSERT_EQ(sparse.indices, net.indices);
+  ASSERT_EQ(m.MarchCubes().size(), net.indices.size());
+}
+
+TEST(MESH, MarchChunks)
+{
+  // The finest level of every chunk together is the whole mesh, coarser levels are smaller
+  // and every open edge of a chunk's surface has a skirt hanging from it
+  Volume<uint8_t> test(70, 40, 44);
+  for (size_t z = 0; z < test.GetDepth(); ++z)
+  {
+    for (size_t y = 0; y < test.GetHeight(); ++y)
+    {
+      for (size_t x = 0; x < test.GetWidth(); ++x)
+      {
+        float dx = x - 34.0f;
+        float dy = y - 20.0f;
+        float dz = z - 22.0f;
+        test.At(x, y, z) = static_cast<uint8_t>(std::max(0.0f, 255.0f - 8.0f * std::sqrt(dx * dx + dy * dy + dz * dz)));
+      }
+    }
+  }
+  auto triangles = [](const IndexedMesh &_mesh, size_t _indexCount)
+  {
+    std::vector<std::tuple<float, float, float, float, float, float, float, float, float>> sorted;
+    for (size_t i = 0; i + 2 < _indexCount; i += 3)
+    {
+      const ngl::Vec3 &a = _mesh.vertices[_mesh.indices[i]];
+      const ngl::Vec3 &b = _mesh.vertices[_mesh.indices[i + 1]];
+      const ngl::Vec3 &c = _mesh.vertices[_mesh.indices[i + 2]];
+      sorted.emplace_back(a.m_x, a.m_y, a.m_z, b.m_x, b.m_y, b.m_z, c.m_x, c.m_y, c.m_z);
+    }
+    return sorted;
+  };
+
+  Mesh m;
+  m.SetThreadCount(3);
+  m.SetSurfaceLevel(100);
+  m.Initialise(test.View(), 70, 40, 1);
+  IndexedMesh whole = m.MarchCubesIndexed();
+  std::vector<MeshChunk> chunks = m.MarchChunks();
+  // The blob reaches the first two of the 3 x 2 x 2 chunks along x
+  ASSERT_EQ(chunks.size(), 8u);
+
+  std::array<size_t, Mesh::c_chunkLevels> levelTriangles = {};
+  auto joined = triangles(IndexedMesh(), 0);
+  for (const MeshChunk &chunk : chunks)
+  {
+    ASSERT_EQ(chunk.levels.size(), Mesh::c_chunkLevels);
+    auto surface = triangles(chunk.levels[0].mesh, chunk.levels[0].surfaceIndices);
+    joined.insert(joined.end(), surface.begin(), surface.end());
+    for (unsigned int level = 0; level < Mesh::c_chunkLevels; ++level)
+    {
+      const ChunkLevel &lod = chunk.levels[level];
+      levelTriangles[level] += lod.surfaceIndices / 3;
+      ASSERT_EQ(lod.normals.size(), lod.mesh.vertices.size());
+      // Half of each step past the first point, in 0.1 unit voxels
+      ASSERT_FLOAT_EQ(lod.error, ((1u << level) - 1) * 0.05f);
+      if (lod.surfaceIndices == 0)
+      {
+        continue;
+      }
+
+      // Surface vertices come first, in the order the surface uses them
+      uint32_t surfaceVertices = *std::max_element(lod.mesh.indices.begin(), lod.mesh.indices.begin() + lod.surfaceIndices) + 1;
+      ASSERT_GT(lod.mesh.indices.size(), lod.surfaceIndices);
+      std::vector<std::pair<uint32_t, uint32_t>> edges;
+      for (size_t i = 0; i < lod.mesh.indices.size(); i += 3)
+      {
+        for (size_t j = 0; j < 3; ++j)
+        {
+          edges.emplace_back(lod.mesh.indices[i + j], lod.mesh.indices[i + (j + 1) % 3]);
+        }
+      }
+      std::sort(edges.begin(), edges.end());
+      for (const std::pair<uint32_t, uint32_t> &edge : edges)
+      {
+        if (!std::binary_search(edges.begin(), edges.end(), std::make_pair(edge.second, edge.first)))
+        {
+          ASSERT_GE(edge.first, surfaceVertices);
+          ASSERT_GE(edge.second, surfaceVertices);
+        }
+      }
+      for (uint32_t i = 0; i < surfaceVertices; ++i)
+      {
+        ASSERT_LE((lod.mesh.vertices[i] - chunk.centre).length(), chunk.radius * 1.001f);
+      }
+    }
+  }
+  std::sort(joined.begin(), joined.end());
+  auto expected = triangles(whole, whole.indices.size());
+  std::sort(expected.begin(), expected.end());
+  ASSERT_EQ(joined, expected);
+  for (unsigned int level = 1; level < Mesh::c_chunkLevels; ++level)
+  {
+    ASSERT_GT(levelTriangles[level], 0u);
+    ASSERT_LT(levelTriangles[level] * 2, levelTriangles[level - 1]);
+  }
+
+  ThreadPool pool(2);
+  BrickVolume<uint8_t> bricks;
+  bricks.Build(test.View(), pool);
+  m.Initialise(bricks, 70, 40, 1);
+  std::vector<MeshChunk> sparse = m.MarchChunks();
+  ASSERT_EQ(sparse.size(), chunks.size());
+  for (size_t i = 0; i < chunks.size(); ++i)
+  {
+    for (unsigned int level = 0; level < Mesh::c_chunkLevels; ++level)
+    {
+      ASSERT_EQ(sparse[i].levels[level].mesh.vertices, chunks[i].levels[level].mesh.vertices);
+      ASSERT_EQ(sparse[i].levels[level].mesh.indices, chunks[i].levels[level].mesh.indices);
+    }
+  }
+}
+
+TEST(MESH, MarchChunksIncremental)
+{
+  // Chunks kept from another level give the same chunks as starting again at the new level
+  Volume<uint8_t> test(70, 40, 44);
+  for (size_t z = 0; z < test.GetDepth(); ++z)
+  {
+    for (size_t y = 0; y < test.GetHeight(); ++y)
+    {
+      for (size_t x = 0; x < test.GetWidth(); ++x)
+      {
+        float dx = x - 20.0f;
+        float dy = y - 20.0f;
+        float dz = z - 22.0f;
+        test.At(x, y, z) = static_cast<uint8_t>(std::max(0.0f, 255.0f - 8.0f * std::sqrt(dx * dx + dy * dy + dz * dz)));
+      }
+    }
+  }
+  Mesh m;
+  m.SetThreadCount(3);
+  m.SetSurfaceLevel(100);
+  m.Initialise(test.View(), 70, 40, 1);
+  m.MarchChunks();
+  for (int level : {200, 40, 255, 120})
+  {
+    m.SetSurfaceLevel(level);
+    std::vector<MeshChunk> moved = m.MarchChunks();
+    Mesh fresh;
+    fresh.SetSurfaceLevel(level);
+    fresh.Initialise(test.View(), 70, 40, 1);
+    std::vector<MeshChunk> again = fresh.MarchChunks();
+    ASSERT_EQ(moved.size(), again.size());
+    for (size_t i = 0; i < moved.size(); ++i)
+    {
+      ASSERT_EQ(moved[i].centre, again[i].centre);
+      for (unsigned int lod = 0; lod < Mesh::c_chunkLevels; ++lod)
+      {
+        ASSERT_EQ(moved[i].levels[lod].mesh.vertices, again[i].levels[lod].mesh.vertices);
+        ASSERT_EQ(moved[i].levels[lod].mesh.indices, again[i].levels[lod].mesh.indices);
+      }
+    }
+  }
+}
+
+TEST(MESH, GradientNormals)
+{
+  // Normals of a ball point out from its centre, whichever engine, source or path made them
+  Volume<uint8_t> test(22, 20, 23);
+  for (size_t z = 0; z < test.GetDepth(); ++z)
+  {
+    for (size_t y = 0; y < test.GetHeight(); ++y)
+    {
+      for (size_t x = 0; x < test.GetWidth(); ++x)
+      {
+        float dx = x - 10.0f;
+        float dy = y - 9.0f;
+        float dz = z - 11.0f;
+        test.At(x, y, z) = static_cast<uint8_t>(std::max(0.0f, 255.0f - 20.0f * std::sqrt(dx * dx + dy * dy + dz * dz)));
+      }
+    }
+  }
+  auto outwards = [](const std::vector<ngl::Vec3> &_vertices, const std::vector<ngl::Vec3> &_normals, float _minimum)
+  {
+    ASSERT_FALSE(_vertices.empty());
+    ASSERT_EQ(_normals.size(), _vertices.size());
+    ngl::Vec3 centre(0.0f, 0.0f, 0.0f);
+    for (const ngl::Vec3 &vertex : _vertices)
+    {
+      centre += vertex;
+    }
+    centre = centre / static_cast<float>(_vertices.size());
+    for (size_t i = 0; i < _vertices.size(); ++i)
+    {
+      ngl::Vec3 radial = _vertices[i] - centre;
+      radial.normalize();
+      ASSERT_NEAR(_normals[i].length(), 1.0f, 1e-4f);
+      ASSERT_GT(_normals[i].dot(radial), _minimum);
+    }
+  };
+
+  Mesh m;
+  m.SetSurfaceLevel(128);
+  m.SetThreadCount(3);
+  m.Initialise(test.View(), 22, 20, 1);
+  std::vector<ngl::Vec3> plain = m.MarchCubes();
+  IndexedMesh plainIndexed = m.MarchCubesIndexed();
+  ASSERT_TRUE(plainIndexed.normals.empty());
+
+  // The soup keeps its vertices, with a normal for each after them
+  m.SetGradientNormals(true);
+  std::vector<ngl::Vec3> soup = m.MarchCubes();
+  ASSERT_EQ(soup.size(), plain.size() * 2);
+  std::vector<ngl::Vec3> soupNormals(soup.begin() + plain.size(), soup.end());
+  soup.resize(plain.size());
+  ASSERT_EQ(soup, plain);
+  outwards(soup, soupNormals, 0.95f);
+
+  m.BeginStream(22, 20, 23, 22, 20, 1);
+  for (size_t z = 0; z < test.GetDepth(); ++z)
+  {
+    m.StreamLayer(test.View().Layer(z));
+  }
+  std::vector<ngl::Vec3> streamed = m.EndStream();
+  soup.insert(soup.end(), soupNormals.begin(), soupNormals.end());
+  ASSERT_EQ(streamed, soup);
+
+  ThreadPool pool(2);
+  BrickVolume<uint8_t> bricks;
+  bricks.Build(test.View(), pool);
+  for (Mesh::Engine engine : {Mesh::Engine::MarchingCubes, Mesh::Engine::FlyingEdges, Mesh::Engine::SurfaceNets})
+  {
+    m.SetEngine(engine);
+    m.Initialise(test.View(), 22, 20, 1);
+    IndexedMesh dense = m.MarchCubesIndexed();
+    outwards(dense.vertices, dense.normals, engine == Mesh::Engine::SurfaceNets ? 0.9f : 0.95f);
+    m.Initialise(bricks, 22, 20, 1);
+    IndexedMesh sparse = m.MarchCubesIndexed();
+    ASSERT_EQ(sparse.normals, dense.normals);
+  }
+  m.SetEngine(Mesh::Engine::MarchingCubes);
+  // Unpacked slabs and copied out bricks give the same normals as reading the whole volume
+  ASSERT_EQ(m.MarchCubes(), soup);
+  IndexedMesh incremental = m.MarchCubesIncremental();
+  outwards(incremental.vertices, incremental.normals, 0.95f);
+  Mesh whole;
+  whole.SetSurfaceLevel(128);
+  whole.SetGradientNormals(true);
+  whole.Initialise(test.View(), 22, 20, 1);
+  ASSERT_EQ(whole.MarchCubesIncremental().normals, incremental.normals);
+  // Bricks kept without normals are marched again once normals are turned on
+  m.SetGradientNormals(false);
+  ASSERT_TRUE(m.MarchCubesIncremental().normals.empty());
+  m.SetGradientNormals(true);
+  incremental = m.MarchCubesIncremental();
+  outwards(incremental.vertices, incremental.normals, 0.95f);
+  std::vector<MeshChunk> chunks = m.MarchChunks();
+  ASSERT_EQ(chunks.size(), 1u);
+  for (const ChunkLevel &level : chunks[0].levels)
+  {
+    ASSERT_EQ(level.normals.size(), level.mesh.vertices.size());
+  }
+  const IndexedMesh &finest = chunks[0].levels[0].mesh;
+  uint32_t surfaceVertices = *std::max_element(finest.indices.begin(), finest.indices.begin() + chunks[0].levels[0].surfaceIndices) + 1;
+  outwards(std::vector<ngl::Vec3>(finest.vertices.begin(), finest.vertices.begin() + surfaceVertices),
+           std::vector<ngl::Vec3>(chunks[0].levels[0].normals.begin(), chunks[0].levels[0].normals.begin() + surfaceVertices), 0.95f);
+}
+
+// DECIMATOR TESTS
+TEST(DECIMATOR, Simplify)
+{
+  // A closed blob stays closed and consistently wound, and keeps about its volume at a quarter of its triangles
+  Volume<uint8_t> test(30, 26, 28);
+  for (size_t z = 0; z < test.GetDepth(); ++z)
+  {
+    for (size_t y = 0; y < test.GetHeight(); ++y)
+    {
+      for (size_t x = 0; x < test.GetWidth(); ++x)
+      {
+        float dx = x - 14.0f;
+        float dy = y - 12.5f;
+        float dz = z - 13.0f;
+        test.At(x, y, z) = static_cast<uint8_t>(std::max(0.0f, 255.0f - 18.0f * std::sqrt(dx * dx + dy * dy * 1.5f + dz * dz)));
+      }
+    }
+  }
+  auto volume = [](const IndexedMesh &_mesh)
+  {
+    double sum = 0.0;
+    for (size_t i = 0; i + 2 < _mesh.indices.size(); i += 3)
+    {
+      ngl::Vec3 a = _mesh.vertices[_mesh.indices[i]];
+      ngl::Vec3 b = _mesh.vertices[_mesh.indices[i + 1]];
+      ngl::Vec3 c = _mesh.vertices[_mesh.indices[i + 2]];
+      sum += a.dot(b.cross(c)) / 6.0;
+    }
+    return sum;
+  };
+
+  Mesh m;
+  m.SetSurfaceLevel(100);
+  m.Initialise(test.View(), 30, 26, 1);
+  IndexedMesh dense = m.MarchCubesIndexed();
+  size_t target = dense.indices.size() / 12;
+  Decimator decimator;
+  IndexedMesh coarse = decimator.Simplify(dense, target);
+  ASSERT_LE(coarse.indices.size() / 3, target);
+  ASSERT_GE(coarse.indices.size() / 3 + 1, target);
+  ASSERT_LT(coarse.vertices.size(), dense.vertices.size() / 3);
+  ASSERT_GT(decimator.GetCollapseCount(), 0);
+  ASSERT_NEAR(volume(coarse) / volume(dense), 1.0, 0.05);
+
+  std::vector<std::pair<uint32_t, uint32_t>> edges;
+  for (size_t i = 0; i < coarse.indices.size(); i += 3)
+  {
+    ASSERT_LT(coarse.indices[i], coarse.vertices.size());
+    for (size_t j = 0; j < 3; ++j)
+    {
+      edges.emplace_back(coarse.indices[i + j], coarse.indices[i + (j + 1) % 3]);
+    }
+  }
+  std::sort(edges.begin(), edges.end());
+  ASSERT_EQ(std::adjacent_find(edges.begin(), edges.end()), edges.end());
+  for (const std::pair<uint32_t, uint32_t> &edge : edges)
+  {
+    ASSERT_TRUE(std::binary_search(edges.begin(), edges.end(), std::make_pair(edge.second, edge.first)));
+  }
+
+  // Already small enough
+  IndexedMesh same = decimator.Simplify(coarse, coarse.indices.size());
+  ASSERT_EQ(same.indices, coarse.indices);
+  ASSERT_EQ(decimator.GetCollapseCount(), 0);
+}
+
+TEST(DECIMATOR, ErrorBudget)
+{
+  // A flat sheet costs nothing to simplify, but its boundary must stay where it is
+  Volume<uint8_t> test(16, 14, 6);
+  for (size_t z = 0; z < test.GetDepth(); ++z)
+  {
+    for (size_t y = 0; y < test.GetHeight(); ++y)
+    {
+      for (size_t x = 0; x < test.GetWidth(); ++x)
+      {
+        test.At(x, y, z) = z < 3 ? 255 : 0;
+      }
+    }
+  }
+  Mesh m;
+  m.SetSurfaceLevel(128);
+  m.Initialise(test.View(), 16, 14, 1);
+  IndexedMesh sheet = m.MarchCubesIndexed();
+  auto bounds = [](const IndexedMesh &_mesh)
+  {
+    ngl::Vec3 low = _mesh.vertices[0];
+    ngl::Vec3 high = _mesh.vertices[0];
+    for (const ngl::Vec3 &vertex : _mesh.vertices)
+    {
+      low = ngl::Vec3(std::min(low.m_x, vertex.m_x), std::min(low.m_y, vertex.m_y), std::min(low.m_z, vertex.m_z));
+      high = ngl::Vec3(std::max(high.m_x, vertex.m_x), std::max(high.m_y, vertex.m_y), std::max(high.m_z, vertex.m_z));
+    }
+    return std::make_pair(low, high);
+  };
+
+  Decimator decimator;
+  IndexedMesh flat = decimator.Simplify(sheet, 0, 1e-3f);
+  ASSERT_FALSE(flat.indices.empty());
+  ASSERT_LT(flat.indices.size() * 4, sheet.indices.size());
+  // Positions pass through the unit cube, so allow for rounding
+  std::pair<ngl::Vec3, ngl::Vec3> flatBounds = bounds(flat);
+  std::pair<ngl::Vec3, ngl::Vec3> sheetBounds = bounds(sheet);
+  ASSERT_NEAR(flatBounds.first.m_x, sheetBounds.first.m_x, 1e-5f);
+  ASSERT_NEAR(flatBounds.first.m_y, sheetBounds.first.m_y, 1e-5f);
+  ASSERT_NEAR(flatBounds.second.m_x, sheetBounds.second.m_x, 1e-5f);
+  ASSERT_NEAR(flatBounds.second.m_y, sheetBounds.second.m_y, 1e-5f);
+  for (const ngl::Vec3 &vertex : flat.vertices)
+  {
+    ASSERT_NEAR(vertex.m_z, sheet.vertices[0].m_z, 1e-5f);
+  }
+
+  // On a curved surface, a larger budget allows more collapses
+  Volume<uint8_t> ramp(12, 12, 12);
+  for (size_t i = 0; i < ramp.GetVoxelCount(); ++i)
+  {
+    size_t x = i % 12;
+    size_t y = i / 12 % 12;
+    size_t z = i / 144;
+    ramp.Data()[i] = static_cast<uint8_t>(std::min<size_t>(255, (x - 6) * (x - 6) * 4 + (y - 6) * (y - 6) * 4 + z * 8));
+  }
+  m.Initialise(ramp.View(), 12, 12, 1);
+  IndexedMesh bowl = m.MarchCubesIndexed();
+  size_t exact = decimator.Simplify(bowl, 0, 0.0f).indices.size();
+  size_t close = decimator.Simplify(bowl, 0, 0.05f).indices.size();
+  size_t loose = decimator.Simplify(bowl, 0, 0.5f).indices.size();
+  ASSERT_LT(exact, bowl.indices.size());
+  ASSERT_LT(close, exact);
+  ASSERT_LT(loose, close);
+}
+
+// PACKED MESH TESTS
+TEST(PACKED_MESH, NormalRoundTrip)
+{
+  // Every octant, the axes and the fold along z = 0
+  std::vector<ngl::Vec3> normals = {{1.0f, 0.0f, 0.0f}, {-1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, -1.0f, 0.0f},
+                                    {0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, -1.0f}, {0.6f, -0.8f, 0.0f}};
+  for (int i = 0; i < 24; ++i)
+  {
+    for (int j = 0; j < 48; ++j)
+    {
+      float theta = 3.14159265f * (i + 0.5f) / 24.0f;
+      float phi = 2.0f * 3.14159265f * j / 48.0f;
+      normals.push_back(ngl::Vec3(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta)));
+    }
+  }
+  for (const ngl::Vec3 &normal : normals)
+  {
+    ngl::Vec3 decoded = DecodeNormal(EncodeNormal(normal));
+    ASSERT_NEAR(decoded.length(), 1.0f, 1e-5f);
+    ASSERT_GT(decoded.dot(normal), 0.99999f);
+  }
+}
+
+TEST(PACKED_MESH, MarchedMesh)
+{
+  Volume<uint8_t> test(37, 30, 41);
+  for (size_t z = 0; z < test.GetDepth(); ++z)
+  {
+    for (size_t y = 0; y < test.GetHeight(); ++y)
+    {
+      for (size_t x = 0; x < test.GetWidth(); ++x)
+      {
+        float dx = x - 18.0f;
+        float dy = y - 13.0f;
+        float dz = z - 20.0f;
+        test.At(x, y, z) = static_cast<uint8_t>(std::max(0.0f, 255.0f - 12.0f * std::sqrt(dx * dx + dy * dy + dz * dz)));
+      }
+    }
+  }
+  Mesh m;
+  m.SetSurfaceLevel(100);
+  m.SetGradientNormals(true);
+  m.Initialise(test.View(), 74, 60, 2);
+  m.SetOrigin(3, 5, 7, 50);
+  ngl::Vec3 minimum;
+  ngl::Vec3 maximum;
+  m.GetBounds(minimum, maximum);
+  auto inside = [&](const ngl::Vec3 &_vertex)
+  {
+    return _vertex.m_x >= minimum.m_x && _vertex.m_y >= minimum.m_y && _vertex.m_z >= minimum.m_z &&
+           _vertex.m_x <= maximum.m_x && _vertex.m_y <= maximum.m_y && _vertex.m_z <= maximum.m_z;
+  };
+
+  // Positions land within half a step of the box's 65535 steps along each axis
+  IndexedMesh mesh = m.MarchCubesIndexed();
+  PackedMesh packed = PackMesh(mesh.vertices, mesh.normals, mesh.indices, minimum, maximum);
+  ASSERT_EQ(packed.vertices.size(), mesh.vertices.size());
+  ASSERT_EQ(packed.indices, mesh.indices);
+  ngl::Vec3 step = (maximum - minimum) / 65535.0f;
+  for (size_t i = 0; i < mesh.vertices.size(); ++i)
+  {
+    ASSERT_TRUE(inside(mesh.vertices[i]));
+    ngl::Vec3 position = packed.Position(i);
+    ASSERT_NEAR(position.m_x, mesh.vertices[i].m_x, step.m_x * 0.5f + 1e-4f);
+    ASSERT_NEAR(position.m_y, mesh.vertices[i].m_y, step.m_y * 0.5f + 1e-4f);
+    ASSERT_NEAR(position.m_z, mesh.vertices[i].m_z, step.m_z * 0.5f + 1e-4f);
+    ASSERT_GT(packed.Normal(i).dot(mesh.normals[i]), 0.99999f);
+  }
+
+  // A soup packs its vertices with the normals that follow them
+  std::vector<ngl::Vec3> soup = m.MarchCubes();
+  PackedMesh packedSoup = PackSoup(soup, minimum, maximum);
+  ASSERT_EQ(packedSoup.vertices.size(), soup.size() / 2);
+  ASSERT_TRUE(packedSoup.indices.empty());
+  for (size_t i = 0; i < packedSoup.vertices.size(); ++i)
+  {
+    ASSERT_GT(packedSoup.Normal(i).dot(soup[soup.size() / 2 + i]), 0.99999f);
+  }
+
+  // Skirts of every chunk level stay in the box too
+  for (const MeshChunk &chunk : m.MarchChunks())
+  {
+    for (const ChunkLevel &level : chunk.levels)
+    {
+      for (const ngl::Vec3 &vertex : level.mesh.vertices)
+      {
+        ASSERT_TRUE(inside(vertex));
+      }
+    }
+  }
+}